@@ -3,17 +3,22 @@
 #define G4_BREMS_ACTION_INIT_H 1
 
 #include "G4VUserActionInitialization.hh"
+#include "globals.hh"
 
 
 namespace G4_BREMS {
 	class ActionInit : public G4VUserActionInitialization {
 	public:
-		ActionInit() = default;
+		ActionInit(G4bool subEventMode = false) : fSubEventMode(subEventMode) {}
 		~ActionInit() override = default;
 
 		void Build() const override;
 		void BuildForMaster() const override;
 
+	private:
+		// Sub-event parallel mode: the master tracks the primary part of each event itself
+		// and therefore gets the full set of user actions
+		G4bool fSubEventMode;
 	};
 }
 #endif // !G4_BREMS_ACTION_INIT_H
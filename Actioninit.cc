@@ -2,23 +2,40 @@
 #include "ActionInit.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "SteppingAction.hh"
+#include "EventAction.hh"
+#include "StackingAction.hh"
+#include "TrackingAction.hh"
 #include "RunAction.hh"
 
 namespace G4_BREMS {
 	void ActionInit::Build() const {
-		SetUserAction(new PrimaryGeneratorAction);
+		PrimaryGeneratorAction* generator = new PrimaryGeneratorAction;
+		SetUserAction(generator);
 
 		SteppingAction* steppingAction = new SteppingAction(nullptr);
 
 		// Create run action with the stepping action pointer
 		RunAction* runAction = new RunAction(steppingAction);
+		runAction->SetSubEventMode(fSubEventMode);
 
 		// Now update the stepping action with the run action pointer
 		steppingAction->SetRunAction(runAction);
 
+		// Per-event SiPM hit buffer
+		EventAction* eventAction = new EventAction(fSubEventMode);
+		steppingAction->SetEventAction(eventAction);
+		eventAction->SetRunAction(runAction);
+		eventAction->SetPrimaryGenerator(generator);
+
 		// Set user actions
 		SetUserAction(runAction);
+		SetUserAction(eventAction);
 		SetUserAction(steppingAction);
+		// Per-photon summaries of the optical photon analysis
+		SetUserAction(new TrackingAction(steppingAction));
+
+		// Region vetoes of the optical profile, and the photon sub-events in sub-event mode
+		SetUserAction(new StackingAction(fSubEventMode));
 
 
 		//RunAction* runAction = new RunAction();
@@ -28,6 +45,11 @@ namespace G4_BREMS {
 	}
 
 	void ActionInit::BuildForMaster() const {
+		if (fSubEventMode) {
+			Build();
+			return;
+		}
+
 		//SetUserAction(new RunAction());
 		SetUserAction(new RunAction(nullptr));
 
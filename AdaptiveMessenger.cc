@@ -0,0 +1,104 @@
+
+#include "AdaptiveMessenger.hh"
+#include "AdaptiveStopping.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+namespace G4_BREMS {
+
+    AdaptiveMessenger::AdaptiveMessenger()
+        : G4UImessenger()
+    {
+        fAdaptiveDirectory = new G4UIdirectory("/snf/adaptive/", false);
+        fAdaptiveDirectory->SetGuidance("Adaptive runs: stop /run/beamOn once the precision targets are met.");
+
+        fEnableCmd = new G4UIcmdWithABool("/snf/adaptive/enable", this);
+        fEnableCmd->SetGuidance("Enable adaptive stopping; /run/beamOn N then gives the maximum number of events.");
+        fEnableCmd->SetParameterName("enable", true);
+        fEnableCmd->SetDefaultValue(true);
+        fEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fEnableCmd->SetToBeBroadcasted(false);
+
+        fTrappingErrorCmd = new G4UIcmdWithADouble("/snf/adaptive/trappingError", this);
+        fTrappingErrorCmd->SetGuidance("Target relative error of the trapping efficiency (0 disables).");
+        fTrappingErrorCmd->SetParameterName("error", false);
+        fTrappingErrorCmd->SetRange("error >= 0");
+        fTrappingErrorCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fTrappingErrorCmd->SetToBeBroadcasted(false);
+
+        fHitsErrorCmd = new G4UIcmdWithADouble("/snf/adaptive/hitsError", this);
+        fHitsErrorCmd->SetGuidance("Target relative error of the SiPM hits per event (0 disables).");
+        fHitsErrorCmd->SetParameterName("error", false);
+        fHitsErrorCmd->SetRange("error >= 0");
+        fHitsErrorCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fHitsErrorCmd->SetToBeBroadcasted(false);
+
+        fChannelErrorCmd = new G4UIcmdWithADouble("/snf/adaptive/channelError", this);
+        fChannelErrorCmd->SetGuidance("Target relative error of the light yield of every lit channel (0 disables).");
+        fChannelErrorCmd->SetParameterName("error", false);
+        fChannelErrorCmd->SetRange("error >= 0");
+        fChannelErrorCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fChannelErrorCmd->SetToBeBroadcasted(false);
+
+        fChannelMinYieldCmd = new G4UIcmdWithADouble("/snf/adaptive/channelMinYield", this);
+        fChannelMinYieldCmd->SetGuidance("Channels with fewer hits per event are exempt from channelError (default 0.05).");
+        fChannelMinYieldCmd->SetParameterName("yield", false);
+        fChannelMinYieldCmd->SetRange("yield >= 0");
+        fChannelMinYieldCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fChannelMinYieldCmd->SetToBeBroadcasted(false);
+
+        fMinEventsCmd = new G4UIcmdWithAnInteger("/snf/adaptive/minEvents", this);
+        fMinEventsCmd->SetGuidance("Events simulated before the targets are tested (default 1000).");
+        fMinEventsCmd->SetParameterName("events", false);
+        fMinEventsCmd->SetRange("events > 1");
+        fMinEventsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fMinEventsCmd->SetToBeBroadcasted(false);
+
+        fCheckIntervalCmd = new G4UIcmdWithAnInteger("/snf/adaptive/checkInterval", this);
+        fCheckIntervalCmd->SetGuidance("Events per thread between merges into the shared estimate (default 200).");
+        fCheckIntervalCmd->SetParameterName("events", false);
+        fCheckIntervalCmd->SetRange("events > 0");
+        fCheckIntervalCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fCheckIntervalCmd->SetToBeBroadcasted(false);
+    }
+
+    AdaptiveMessenger::~AdaptiveMessenger()
+    {
+        delete fEnableCmd;
+        delete fTrappingErrorCmd;
+        delete fHitsErrorCmd;
+        delete fChannelErrorCmd;
+        delete fChannelMinYieldCmd;
+        delete fMinEventsCmd;
+        delete fCheckIntervalCmd;
+        delete fAdaptiveDirectory;
+    }
+
+    void AdaptiveMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        auto& targets = AdaptiveStopping::Targets();
+        if (command == fEnableCmd) {
+            targets.enabled = fEnableCmd->GetNewBoolValue(newValue);
+        }
+        else if (command == fTrappingErrorCmd) {
+            targets.trappingError = fTrappingErrorCmd->GetNewDoubleValue(newValue);
+        }
+        else if (command == fHitsErrorCmd) {
+            targets.hitsError = fHitsErrorCmd->GetNewDoubleValue(newValue);
+        }
+        else if (command == fChannelErrorCmd) {
+            targets.channelError = fChannelErrorCmd->GetNewDoubleValue(newValue);
+        }
+        else if (command == fChannelMinYieldCmd) {
+            targets.channelMinYield = fChannelMinYieldCmd->GetNewDoubleValue(newValue);
+        }
+        else if (command == fMinEventsCmd) {
+            targets.minEvents = fMinEventsCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fCheckIntervalCmd) {
+            targets.checkInterval = fCheckIntervalCmd->GetNewIntValue(newValue);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+
+#ifndef G4_BREMS_ADAPTIVE_MESSENGER_H
+#define G4_BREMS_ADAPTIVE_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithADouble;
+class G4UIcmdWithAnInteger;
+
+namespace G4_BREMS {
+
+    // /snf/adaptive/: precision targets of the adaptive run mode (master only, see AdaptiveStopping)
+    class AdaptiveMessenger : public G4UImessenger
+    {
+    public:
+        AdaptiveMessenger();
+        ~AdaptiveMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fAdaptiveDirectory;
+        G4UIcmdWithABool* fEnableCmd;
+        G4UIcmdWithADouble* fTrappingErrorCmd;
+        G4UIcmdWithADouble* fHitsErrorCmd;
+        G4UIcmdWithADouble* fChannelErrorCmd;
+        G4UIcmdWithADouble* fChannelMinYieldCmd;
+        G4UIcmdWithAnInteger* fMinEventsCmd;
+        G4UIcmdWithAnInteger* fCheckIntervalCmd;
+    };
+}
+
+#endif
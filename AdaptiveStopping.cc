@@ -0,0 +1,172 @@
+
+#include "AdaptiveStopping.hh"
+#include "G4RunManager.hh"
+#include "G4AutoLock.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace G4_BREMS {
+
+    namespace {
+        G4Mutex adaptiveMutex = G4MUTEX_INITIALIZER;
+    }
+
+    AdaptiveTargets AdaptiveStopping::fTargets;
+    AdaptiveStopping::Estimators AdaptiveStopping::fShared;
+    std::atomic<G4bool> AdaptiveStopping::fStop(false);
+
+    void RunningStat::Add(G4double x)
+    {
+        n += 1.;
+        G4double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    void RunningStat::Merge(const RunningStat& other)
+    {
+        if (other.n <= 0.) return;
+        G4double total = n + other.n;
+        G4double delta = other.mean - mean;
+        mean += delta * other.n / total;
+        m2 += other.m2 + delta * delta * n * other.n / total;
+        n = total;
+    }
+
+    G4double RunningStat::RelativeError() const
+    {
+        if (n < 2. || mean == 0.) return 0.;
+        return std::sqrt(Variance() / n) / std::abs(mean);
+    }
+
+    void RunningCovariance::Add(G4double xValue, G4double yValue)
+    {
+        G4double dx = xValue - x.mean;
+        x.Add(xValue);
+        y.Add(yValue);
+        c += dx * (yValue - y.mean);
+    }
+
+    void RunningCovariance::Merge(const RunningCovariance& other)
+    {
+        if (other.x.n <= 0.) return;
+        G4double total = x.n + other.x.n;
+        c += other.c + (other.x.mean - x.mean) * (other.y.mean - y.mean) * x.n * other.x.n / total;
+        x.Merge(other.x);
+        y.Merge(other.y);
+    }
+
+    G4double RunningCovariance::RatioRelativeError() const
+    {
+        if (x.n < 2. || x.mean <= 0. || y.mean <= 0.) return 0.;
+        G4double covariance = c / (x.n - 1.);
+        G4double relative = x.Variance() / (x.mean * x.mean) + y.Variance() / (y.mean * y.mean)
+            - 2. * covariance / (x.mean * y.mean);
+        return std::sqrt(std::max(0., relative) / x.n);
+    }
+
+    void AdaptiveStopping::Estimators::Merge(const Estimators& other)
+    {
+        trapping.Merge(other.trapping);
+        hits.Merge(other.hits);
+        for (std::size_t i = 0; i < channels.size(); i++) channels[i].Merge(other.channels[i]);
+    }
+
+    void AdaptiveStopping::ResetShared()
+    {
+        G4AutoLock lock(&adaptiveMutex);
+        fShared = Estimators();
+        fStop = false;
+    }
+
+    void AdaptiveStopping::BeginOfRun()
+    {
+        fLocal = Estimators();
+        fSinceFlush = 0;
+    }
+
+    void AdaptiveStopping::AddEvent(G4double entered, G4double absorbed, const std::vector<SipmHit>& hits)
+    {
+        if (!fTargets.enabled) return;
+
+        // Events still finishing after the stop are left out, the estimate is already final
+        if (StopRequested()) {
+            G4RunManager::GetRunManager()->AbortRun(true);
+            return;
+        }
+
+        std::array<G4int, SipmChannel::kChannels> perChannel{};
+        for (const auto& hit : hits) {
+            if (hit.sipmID >= 0 && hit.sipmID < SipmChannel::kChannels) perChannel[hit.sipmID]++;
+        }
+
+        fLocal.trapping.Add(absorbed, entered);
+        fLocal.hits.Add(static_cast<G4double>(hits.size()));
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            fLocal.channels[channel].Add(perChannel[channel]);
+        }
+
+        if (++fSinceFlush >= fTargets.checkInterval) {
+            Flush();
+            if (StopRequested()) G4RunManager::GetRunManager()->AbortRun(true);
+        }
+    }
+
+    void AdaptiveStopping::Flush()
+    {
+        if (!fTargets.enabled || fSinceFlush == 0) return;
+
+        G4AutoLock lock(&adaptiveMutex);
+        fShared.Merge(fLocal);
+        fLocal = Estimators();
+        fSinceFlush = 0;
+
+        if (!fStop && fShared.hits.n >= fTargets.minEvents && TargetsMet(fShared)) {
+            fStop = true;
+            G4cout << "Adaptive stopping: targets reached after " << static_cast<G4long>(fShared.hits.n)
+                << " events" << G4endl;
+        }
+    }
+
+    G4bool AdaptiveStopping::TargetsMet(const Estimators& estimators)
+    {
+        if (fTargets.trappingError > 0.) {
+            G4double error = estimators.trapping.RatioRelativeError();
+            if (error <= 0. || error > fTargets.trappingError) return false;
+        }
+        if (fTargets.hitsError > 0.) {
+            G4double error = estimators.hits.RelativeError();
+            if (error <= 0. || error > fTargets.hitsError) return false;
+        }
+        if (fTargets.channelError > 0.) {
+            for (const auto& channel : estimators.channels) {
+                if (channel.mean < fTargets.channelMinYield) continue;
+                if (channel.RelativeError() > fTargets.channelError) return false;
+            }
+        }
+        return true;
+    }
+
+    void AdaptiveStopping::PrintSummary()
+    {
+        if (!fTargets.enabled) return;
+
+        G4AutoLock lock(&adaptiveMutex);
+        G4double worstChannel = 0.;
+        G4int litChannels = 0;
+        for (const auto& channel : fShared.channels) {
+            if (channel.mean < fTargets.channelMinYield) continue;
+            litChannels++;
+            worstChannel = std::max(worstChannel, channel.RelativeError());
+        }
+
+        G4cout << "\n=== Adaptive run: " << static_cast<G4long>(fShared.hits.n) << " events"
+            << (fStop ? ", targets reached" : ", targets NOT reached") << " ===" << G4endl;
+        G4cout << "Trapping efficiency: " << fShared.trapping.Ratio() * 100.0 << "% +- "
+            << fShared.trapping.RatioRelativeError() * 100.0 << "% (relative)" << G4endl;
+        G4cout << "SiPM hits per event: " << fShared.hits.mean << " +- "
+            << fShared.hits.RelativeError() * 100.0 << "% (relative)" << G4endl;
+        G4cout << "Channels above " << fTargets.channelMinYield << " hits/event: " << litChannels
+            << ", worst relative error " << worstChannel * 100.0 << "%" << G4endl;
+    }
+}
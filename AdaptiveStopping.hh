@@ -0,0 +1,93 @@
+
+#ifndef G4_BREMS_ADAPTIVE_STOPPING_H
+#define G4_BREMS_ADAPTIVE_STOPPING_H 1
+
+#include "SipmChannel.hh"
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Streaming mean and variance (Welford), merged across threads with Chan's update
+    struct RunningStat {
+        G4double n = 0.;
+        G4double mean = 0.;
+        G4double m2 = 0.;
+
+        void Add(G4double x);
+        void Merge(const RunningStat& other);
+        G4double Variance() const { return (n > 1.) ? m2 / (n - 1.) : 0.; }
+        // Relative standard error of the mean, 0 when undefined
+        G4double RelativeError() const;
+    };
+
+    // Streaming co-moment of two per-event quantities, for the ratio estimator
+    struct RunningCovariance {
+        RunningStat x;
+        RunningStat y;
+        G4double c = 0.;
+
+        void Add(G4double xValue, G4double yValue);
+        void Merge(const RunningCovariance& other);
+        // Ratio sum(x)/sum(y) and its relative standard error (delta method)
+        G4double Ratio() const { return (y.mean > 0.) ? x.mean / y.mean : 0.; }
+        G4double RatioRelativeError() const;
+    };
+
+    // Target precision of the adaptive run mode; zero disables a target
+    struct AdaptiveTargets {
+        G4bool enabled = false;
+        G4double trappingError = 0.;     // relative error of the trapping efficiency
+        G4double hitsError = 0.;         // relative error of SiPM hits per event
+        G4double channelError = 0.;      // relative error of every lit channel's hits per event
+        G4double channelMinYield = 0.05; // channels below this mean yield are not required to converge
+        G4int minEvents = 1000;
+        G4int checkInterval = 200;       // events per thread between merges into the shared estimate
+    };
+
+    // Per-thread estimators, owned by RunAction. Every checkInterval events a thread merges
+    // its estimators into the shared ones and tests the targets; once all are met every
+    // thread aborts its event loop with G4RunManager::AbortRun(true).
+    class AdaptiveStopping
+    {
+    public:
+        AdaptiveStopping() = default;
+        ~AdaptiveStopping() = default;
+
+        static AdaptiveTargets& Targets() { return fTargets; }
+        static G4bool IsEnabled() { return fTargets.enabled; }
+        static G4bool StopRequested() { return fStop.load(std::memory_order_relaxed); }
+
+        // Master, before the workers start
+        static void ResetShared();
+        // Master, after all threads flushed
+        static void PrintSummary();
+
+        void BeginOfRun();
+        void AddEvent(G4double entered, G4double absorbed, const std::vector<SipmHit>& hits);
+        void Flush();
+
+    private:
+        struct Estimators {
+            RunningCovariance trapping;   // x = absorbed, y = entered
+            RunningStat hits;
+            std::array<RunningStat, SipmChannel::kChannels> channels;
+
+            void Merge(const Estimators& other);
+        };
+
+        static G4bool TargetsMet(const Estimators& estimators);
+
+        static AdaptiveTargets fTargets;
+        static Estimators fShared;
+        static std::atomic<G4bool> fStop;
+
+        Estimators fLocal;
+        G4int fSinceFlush = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+
+#include "AliasTable.hh"
+
+namespace G4_BREMS {
+
+    void AliasTable::Build(const std::vector<G4double>& edges, const std::vector<G4double>& weights)
+    {
+        fEdges.clear();
+        fProbability.clear();
+        fAlias.clear();
+
+        const std::size_t n = weights.size();
+        G4double total = 0.;
+        for (auto w : weights) total += (w > 0.) ? w : 0.;
+        if (n == 0 || edges.size() != n + 1 || total <= 0.) {
+            G4Exception("AliasTable::Build()", "Alias_W001", JustWarning,
+                "Empty or inconsistent distribution, table not built");
+            return;
+        }
+
+        fEdges = edges;
+        fProbability.resize(n);
+        fAlias.resize(n);
+
+        // Scaled so that the mean bin weight is one
+        std::vector<G4double> scaled(n);
+        std::vector<std::size_t> small;
+        std::vector<std::size_t> large;
+        for (std::size_t i = 0; i < n; i++) {
+            scaled[i] = ((weights[i] > 0.) ? weights[i] : 0.) * n / total;
+            (scaled[i] < 1. ? small : large).push_back(i);
+        }
+
+        while (!small.empty() && !large.empty()) {
+            std::size_t s = small.back();
+            small.pop_back();
+            std::size_t l = large.back();
+
+            fProbability[s] = scaled[s];
+            fAlias[s] = l;
+            scaled[l] -= 1. - scaled[s];
+            if (scaled[l] < 1.) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // Left-overs are one up to rounding
+        for (auto i : large) { fProbability[i] = 1.; fAlias[i] = i; }
+        for (auto i : small) { fProbability[i] = 1.; fAlias[i] = i; }
+    }
+
+    std::size_t AliasTable::SampleBin(G4double u) const
+    {
+        const std::size_t n = fProbability.size();
+        G4double x = u * n;
+        std::size_t column = static_cast<std::size_t>(x);
+        if (column >= n) column = n - 1;
+        return (x - column < fProbability[column]) ? column : fAlias[column];
+    }
+
+    G4double AliasTable::Sample(G4double u) const
+    {
+        const std::size_t n = fProbability.size();
+        G4double x = u * n;
+        std::size_t column = static_cast<std::size_t>(x);
+        if (column >= n) column = n - 1;
+        G4double fraction = x - column;
+
+        // The part of u not used to pick the bin is uniform again and places the value in the bin
+        std::size_t bin = column;
+        G4double p = fProbability[column];
+        if (fraction < p) {
+            fraction = fraction / p;
+        }
+        else {
+            bin = fAlias[column];
+            fraction = (fraction - p) / (1. - p);
+        }
+        return fEdges[bin] + fraction * (fEdges[bin + 1] - fEdges[bin]);
+    }
+}
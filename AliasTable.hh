@@ -0,0 +1,35 @@
+
+#ifndef G4_BREMS_ALIAS_TABLE_H
+#define G4_BREMS_ALIAS_TABLE_H 1
+
+#include "globals.hh"
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Walker/Vose alias table over a binned distribution: one uniform number selects a bin in
+    // O(1) and, rescaled, the position inside the (flat) bin.
+    class AliasTable
+    {
+    public:
+        AliasTable() = default;
+        ~AliasTable() = default;
+
+        // edges.size() == weights.size() + 1; weights need not be normalised
+        void Build(const std::vector<G4double>& edges, const std::vector<G4double>& weights);
+
+        G4bool IsEmpty() const { return fProbability.empty(); }
+        std::size_t GetNumberOfBins() const { return fProbability.size(); }
+
+        // u in [0,1)
+        std::size_t SampleBin(G4double u) const;
+        G4double Sample(G4double u) const;
+
+    private:
+        std::vector<G4double> fEdges;
+        std::vector<G4double> fProbability;
+        std::vector<std::size_t> fAlias;
+    };
+}
+
+#endif
@@ -0,0 +1,44 @@
+
+#ifndef G4_BREMS_ARRAY_ACCUMULABLE_H
+#define G4_BREMS_ARRAY_ACCUMULABLE_H 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+#include <algorithm>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Dense array merged element by element at the end of a run. Every thread resizes it the
+    // same way before the run (Resize keeps nothing); the master adds the workers' arrays.
+    template <typename T>
+    class ArrayAccumulable : public G4VAccumulable
+    {
+    public:
+        explicit ArrayAccumulable(const G4String& name, std::size_t size = 0)
+            : G4VAccumulable(name), fValues(size, T(0)) {}
+        ~ArrayAccumulable() override = default;
+
+        void Merge(const G4VAccumulable& other) override
+        {
+            const auto& values = static_cast<const ArrayAccumulable<T>&>(other).fValues;
+            if (values.size() > fValues.size()) fValues.resize(values.size(), T(0));
+            for (std::size_t i = 0; i < values.size(); i++) fValues[i] += values[i];
+        }
+
+        void Reset() override { std::fill(fValues.begin(), fValues.end(), T(0)); }
+
+        void Resize(std::size_t size) { fValues.assign(size, T(0)); }
+
+        T& operator[](std::size_t i) { return fValues[i]; }
+        const T& operator[](std::size_t i) const { return fValues[i]; }
+        std::size_t size() const { return fValues.size(); }
+        T* data() { return fValues.data(); }
+        const T* data() const { return fValues.data(); }
+
+    private:
+        std::vector<T> fValues;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+
+#include "BackgroundMixer.hh"
+#include "G4AccumulableManager.hh"
+#include "G4Poisson.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include <algorithm>
+
+namespace G4_BREMS {
+
+    MixingParameters BackgroundMixer::fParameters;
+
+    BackgroundMixer::BackgroundMixer()
+        : fAccEvents("MixedEvents", 0.), fAccOverlaid("MixedBackgroundEvents", 0.),
+        fAccHits("MixedBackgroundHits", 0.), fAccDarkHits("MixedDarkHits", 0.)
+    {
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) fNames[channel] = SipmChannel::Name(channel);
+
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(fAccEvents);
+        accumulableManager->RegisterAccumulable(fAccOverlaid);
+        accumulableManager->RegisterAccumulable(fAccHits);
+        accumulableManager->RegisterAccumulable(fAccDarkHits);
+    }
+
+    void BackgroundMixer::Record(G4int eventID, const std::vector<SipmHit>& hits)
+    {
+        HitLibrary::Serialize(eventID, hits, fBuffer);
+        HitLibrary::Write(fBuffer);
+    }
+
+    void BackgroundMixer::Overlay(std::vector<SipmHit>& hits)
+    {
+        const G4double start = fParameters.windowStart;
+        const G4double end = fParameters.windowEnd;
+        if (end <= start) return;
+        fAccEvents += 1.;
+
+        for (const auto& source : fParameters.sources) {
+            const HitLibrary& library = *source.library;
+            if (library.GetEventCount() == 0) continue;
+            const G4double first = start - library.GetMaxTime();
+            const G4long arrivals = G4Poisson(source.rate * (end - first) * 1.e-9);
+            for (G4long arrival = 0; arrival < arrivals; arrival++) {
+                const G4double offset = first + G4UniformRand() * (end - first);
+                const std::size_t event = std::min(library.GetEventCount() - 1,
+                    static_cast<std::size_t>(G4UniformRand() * library.GetEventCount()));
+                const auto range = library.GetEvent(event);
+                for (const HitLibrary::Hit* hit = range.first; hit != range.second; hit++) {
+                    const G4double time = offset + hit->time;
+                    if (time < start || time >= end || hit->channel < 0 || hit->channel >= SipmChannel::kChannels) continue;
+                    hits.push_back({ hit->channel, fNames[hit->channel], time * ns,
+                        G4ThreeVector(hit->x, hit->y, hit->z) * mm, hit->energy * eV, hit->wavelength });
+                    fAccHits += 1.;
+                }
+                fAccOverlaid += 1.;
+            }
+        }
+
+        if (fParameters.darkRate <= 0.) return;
+        const G4double darkMean = fParameters.darkRate * (end - start) * 1.e-9;
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            const G4long counts = G4Poisson(darkMean);
+            for (G4long count = 0; count < counts; count++) {
+                // A thermal avalanche has no photon: no position, energy or wavelength
+                hits.push_back({ channel, fNames[channel], (start + G4UniformRand() * (end - start)) * ns,
+                    G4ThreeVector(), 0., 0. });
+                fAccDarkHits += 1.;
+            }
+        }
+    }
+
+    void BackgroundMixer::PrintSummary() const
+    {
+        if (!IsMixing()) return;
+
+        const G4double events = fAccEvents.GetValue();
+        G4cout << "Background mixing over [" << fParameters.windowStart << ", " << fParameters.windowEnd << "] ns: "
+            << static_cast<long long>(fAccOverlaid.GetValue()) << " library events and "
+            << static_cast<long long>(fAccHits.GetValue() + fAccDarkHits.GetValue()) << " hits ("
+            << static_cast<long long>(fAccDarkHits.GetValue()) << " dark) into " << static_cast<long long>(events)
+            << " events";
+        if (events > 0.) G4cout << ", " << (fAccHits.GetValue() + fAccDarkHits.GetValue()) / events << " hits/event";
+        G4cout << G4endl;
+        for (const auto& source : fParameters.sources) {
+            G4cout << "  " << source.name << ": " << source.rate << " Hz from " << source.library->GetPath() << " ("
+                << source.library->GetEventCount() << " events)" << G4endl;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+
+#ifndef G4_BREMS_BACKGROUND_MIXER_H
+#define G4_BREMS_BACKGROUND_MIXER_H 1
+
+#include "G4Accumulable.hh"
+#include "HitLibrary.hh"
+#include "SipmChannel.hh"
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Background whose events are replayed from a hit library at a fixed rate
+    struct BackgroundSource {
+        G4String name;
+        G4double rate;                              // Hz
+        std::shared_ptr<const HitLibrary> library;
+    };
+
+    // Configured on the master by MixingMessenger between runs
+    struct MixingParameters {
+        G4bool record = false;                      // every event's own hits to hitlib_run<N>.bin
+        std::vector<BackgroundSource> sources;
+        G4double darkRate = 0.;                     // Hz per channel, single photoelectrons
+        G4double windowStart = -1000.;              // ns, time line mixed around each event
+        G4double windowEnd = 1000.;                 // ns
+    };
+
+    // Per-thread pile-up stage, owned by RunAction and run at end of event before the trigger:
+    // records the event's own hits to the library being written, then overlays background
+    // events drawn from the libraries as Poisson arrivals over the time line, each shifted by
+    // its arrival time, and dark counts. Background events arriving up to the library's longest
+    // hit time before the window still contribute their late hits.
+    class BackgroundMixer
+    {
+    public:
+        BackgroundMixer();
+        ~BackgroundMixer() = default;
+
+        static MixingParameters& Parameters() { return fParameters; }
+        static G4bool IsMixing() { return !fParameters.sources.empty() || fParameters.darkRate > 0.; }
+        static G4bool IsRecording() { return fParameters.record; }
+
+        void Record(G4int eventID, const std::vector<SipmHit>& hits);
+        void Overlay(std::vector<SipmHit>& hits);
+
+        // Master only, after the accumulables are merged
+        void PrintSummary() const;
+
+    private:
+        static MixingParameters fParameters;
+
+        std::array<G4String, SipmChannel::kChannels> fNames;
+        std::vector<char> fBuffer;
+
+        G4Accumulable<G4double> fAccEvents;          // events mixed into
+        G4Accumulable<G4double> fAccOverlaid;        // background events overlaid
+        G4Accumulable<G4double> fAccHits;            // background hits kept in the window
+        G4Accumulable<G4double> fAccDarkHits;
+    };
+}
+
+#endif
@@ -0,0 +1,76 @@
+
+#include "ChannelHistograms.hh"
+#include "G4AccumulableManager.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    ChannelHistogramParameters ChannelHistograms::fParameters;
+    G4double ChannelHistograms::fRunHits = 0.;
+
+    ChannelHistograms::ChannelHistograms()
+        : fTimeHist("ChannelTimeHist"), fPeHist("ChannelPeHist")
+    {
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(&fTimeHist);
+        accumulableManager->RegisterAccumulable(&fPeHist);
+    }
+
+    void ChannelHistograms::BeginOfRun()
+    {
+        // Outside histogram mode the arrays stay empty and cost nothing
+        const std::size_t channels = fParameters.enabled ? SipmChannel::kChannels : 0;
+        fTimeHist.Resize(channels * (fParameters.timeBins + 1));
+        fPeHist.Resize(channels * fParameters.peBins);
+        fBinsPerTime = fParameters.timeBins / (fParameters.timeMax * ns);
+        fEventCounts.fill(0);
+    }
+
+    void ChannelHistograms::EndOfEvent()
+    {
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            const std::uint32_t peBin = std::min<std::uint32_t>(fEventCounts[channel], fParameters.peBins - 1);
+            fPeHist[channel * fParameters.peBins + peBin]++;
+        }
+        fEventCounts.fill(0);
+    }
+
+    G4bool ChannelHistograms::Write(const G4String& path) const
+    {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return false;
+        }
+
+        const G4int timeBins = fParameters.timeBins;
+        const G4int peBins = fParameters.peBins;
+        const G4double width = fParameters.timeMax / timeBins;
+        std::uint64_t hits = 0;
+        out << "Channel,Histogram,Bin,Low,High,Count\n";
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            const std::uint64_t* time = fTimeHist.data() + channel * (timeBins + 1);
+            for (G4int bin = 0; bin <= timeBins; bin++) {
+                out << channel << ",time," << bin << "," << bin * width << ",";
+                if (bin < timeBins) out << (bin + 1) * width;
+                else out << "inf";
+                out << "," << time[bin] << "\n";
+                hits += time[bin];
+            }
+            const std::uint64_t* pe = fPeHist.data() + channel * peBins;
+            for (G4int bin = 0; bin < peBins; bin++) {
+                out << channel << ",pe," << bin << "," << bin << ",";
+                if (bin < peBins - 1) out << bin + 1;
+                else out << "inf";
+                out << "," << pe[bin] << "\n";
+            }
+        }
+        fRunHits = static_cast<G4double>(hits);
+
+        G4cout << "Channel histograms: " << hits << " hits on " << SipmChannel::kChannels << " channels written to "
+            << path << G4endl;
+        return true;
+    }
+}
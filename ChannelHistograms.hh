@@ -0,0 +1,67 @@
+
+#ifndef G4_BREMS_CHANNEL_HISTOGRAMS_H
+#define G4_BREMS_CHANNEL_HISTOGRAMS_H 1
+
+#include "ArrayAccumulable.hh"
+#include "SipmChannel.hh"
+#include "globals.hh"
+#include <array>
+#include <cstdint>
+
+namespace G4_BREMS {
+
+    // Configured on the master by HitsMessenger between runs
+    struct ChannelHistogramParameters {
+        G4bool enabled = false;      // histogram mode: no hit list, no sipm hits csv
+        G4int timeBins = 200;        // arrival time in [0, timeMax), plus an overflow bin
+        G4double timeMax = 200.0;    // ns
+        G4int peBins = 64;           // photoelectrons per event 0 .. peBins-2, last bin overflow
+    };
+
+    // Per-channel SiPM hit distributions filled at detection time, for runs that need no
+    // individual hits. Per-thread, owned by RunAction: the arrival time of every hit and the
+    // photoelectrons per channel and event go to dense arrays that are merged once at the end
+    // of the run, so memory is channels x bins whatever the number of events.
+    //
+    // Output csv in long format, one row per bin:
+    //   Channel,Histogram,Bin,Low,High,Count
+    // Histogram "time" bins arrival times in ns (High of the overflow bin is inf), "pe" bins
+    // photoelectrons per event (the last bin holds peBins-1 and more, High is inf).
+    class ChannelHistograms
+    {
+    public:
+        ChannelHistograms();
+        ~ChannelHistograms() = default;
+
+        static ChannelHistogramParameters& Parameters() { return fParameters; }
+        static G4bool IsEnabled() { return fParameters.enabled; }
+        // Hits of the last run, on the master after Write
+        static G4double GetRunHits() { return fRunHits; }
+
+        void BeginOfRun();
+        void BeginOfEvent() { fEventCounts.fill(0); }
+        void AddHit(G4int channel, G4double time)
+        {
+            if (channel < 0 || channel >= SipmChannel::kChannels) return;
+            G4double bin = time * fBinsPerTime;
+            std::size_t timeBin = (bin >= 0. && bin < fParameters.timeBins) ? static_cast<std::size_t>(bin) : fParameters.timeBins;
+            fTimeHist[channel * (fParameters.timeBins + 1) + timeBin]++;
+            fEventCounts[channel]++;
+        }
+        void EndOfEvent();
+
+        // Master only, after the accumulables are merged
+        G4bool Write(const G4String& path) const;
+
+    private:
+        static ChannelHistogramParameters fParameters;
+        static G4double fRunHits;
+
+        ArrayAccumulable<std::uint64_t> fTimeHist;   // [channel][timeBins + 1]
+        ArrayAccumulable<std::uint64_t> fPeHist;     // [channel][peBins]
+        std::array<std::uint32_t, SipmChannel::kChannels> fEventCounts{};
+        G4double fBinsPerTime = 0.;
+    };
+}
+
+#endif
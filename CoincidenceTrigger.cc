@@ -0,0 +1,100 @@
+
+#include "CoincidenceTrigger.hh"
+#include "G4AccumulableManager.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+
+namespace G4_BREMS {
+
+    TriggerParameters CoincidenceTrigger::fParameters;
+
+    CoincidenceTrigger::CoincidenceTrigger()
+        : fAccEvents("TriggerEvents", 0), fAccAccepted("TriggerAccepted", 0),
+        fAccRawHits("TriggerRawHits", 0.), fAccKeptHits("TriggerKeptHits", 0.)
+    {
+        fFired.fill(false);
+
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(fAccEvents);
+        accumulableManager->RegisterAccumulable(fAccAccepted);
+        accumulableManager->RegisterAccumulable(fAccRawHits);
+        accumulableManager->RegisterAccumulable(fAccKeptHits);
+    }
+
+    G4bool CoincidenceTrigger::Apply(std::vector<SipmHit>& hits)
+    {
+        fAccEvents += 1;
+        fAccRawHits += static_cast<G4double>(hits.size());
+
+        for (auto& times : fTimes) times.clear();
+        for (const auto& hit : hits) {
+            if (hit.sipmID < 0 || hit.sipmID >= SipmChannel::kChannels) continue;
+            fTimes[hit.sipmID].push_back(hit.time / ns);
+        }
+
+        // Channel fire time: the hit completing the first window with threshold photoelectrons
+        const G4double window = fParameters.window;
+        fFireTimes.clear();
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            fFired[channel] = false;
+            auto& times = fTimes[channel];
+            const std::size_t threshold = static_cast<std::size_t>(std::max(fParameters.thresholds[channel], 0));
+            if (threshold == 0 || times.size() < threshold) continue;
+            std::sort(times.begin(), times.end());
+            for (std::size_t i = 0; i + threshold <= times.size(); i++) {
+                if (times[i + threshold - 1] - times[i] > window) continue;
+                fFireTimes.emplace_back(times[i + threshold - 1], channel);
+                fFired[channel] = true;
+                break;
+            }
+        }
+        std::sort(fFireTimes.begin(), fFireTimes.end());
+
+        // Slide the window over the fire times, counting the layers that have a channel in it
+        std::array<G4int, SipmChannel::kLayers> channelsInLayer{};
+        G4int layers = 0, top = 0, bottom = 0;
+        auto count = [&](G4int channel, G4int delta) {
+            G4int& n = channelsInLayer[SipmChannel::Layer(channel)];
+            if (n == 0 || n + delta == 0) {
+                layers += delta;
+                (SipmChannel::IsTopLayer(channel) ? top : bottom) += delta;
+            }
+            n += delta;
+        };
+        G4bool accepted = false;
+        std::size_t first = 0;
+        for (std::size_t last = 0; last < fFireTimes.size() && !accepted; last++) {
+            count(fFireTimes[last].second, 1);
+            while (fFireTimes[last].first - fFireTimes[first].first > window) count(fFireTimes[first++].second, -1);
+            accepted = layers >= fParameters.layers && top >= fParameters.topLayers && bottom >= fParameters.bottomLayers;
+        }
+
+        if (!accepted) {
+            hits.clear();
+            return false;
+        }
+
+        hits.erase(std::remove_if(hits.begin(), hits.end(), [this](const SipmHit& hit) {
+            return hit.sipmID < 0 || hit.sipmID >= SipmChannel::kChannels || !fFired[hit.sipmID];
+        }), hits.end());
+        fAccAccepted += 1;
+        fAccKeptHits += static_cast<G4double>(hits.size());
+        return true;
+    }
+
+    void CoincidenceTrigger::PrintSummary() const
+    {
+        if (!fParameters.enabled) return;
+
+        const G4int events = fAccEvents.GetValue();
+        const G4double rawHits = fAccRawHits.GetValue();
+        G4cout << "Trigger: " << fParameters.layers << " layers (" << fParameters.topLayers << " top, "
+            << fParameters.bottomLayers << " bottom) within " << fParameters.window << " ns, accepted "
+            << fAccAccepted.GetValue() << " of " << events << " events";
+        if (events > 0) G4cout << " (" << 100. * fAccAccepted.GetValue() / events << "%)";
+        G4cout << ", kept " << static_cast<long long>(fAccKeptHits.GetValue()) << " of "
+            << static_cast<long long>(rawHits) << " SiPM hits";
+        if (rawHits > 0.) G4cout << " (" << 100. * fAccKeptHits.GetValue() / rawHits << "%)";
+        G4cout << G4endl;
+    }
+}
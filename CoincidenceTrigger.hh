@@ -0,0 +1,65 @@
+
+#ifndef G4_BREMS_COINCIDENCE_TRIGGER_H
+#define G4_BREMS_COINCIDENCE_TRIGGER_H 1
+
+#include "G4Accumulable.hh"
+#include "SipmChannel.hh"
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Event-level trigger of the DAQ, configured on the master by TriggerMessenger between runs.
+    // A channel fires when threshold photoelectrons arrive within the window; the event is kept
+    // when channels of at least 'layers' different layers fire within one window, among them at
+    // least topLayers top and bottomLayers bottom layers (see SipmChannel::IsTopLayer).
+    struct TriggerParameters {
+        G4bool enabled = false;
+        G4int layers = 2;
+        G4int topLayers = 0;
+        G4int bottomLayers = 0;
+        G4double window = 20.;           // ns
+        // Photoelectrons per channel, 0 masks the channel
+        std::array<G4int, SipmChannel::kChannels> thresholds;
+
+        TriggerParameters() { thresholds.fill(1); }
+    };
+
+    // Per-thread trigger, owned by RunAction and applied at end of event before the hits reach
+    // any output: rejected events lose all their hits, accepted ones keep only the hits of the
+    // channels that fired (zero suppression).
+    class CoincidenceTrigger
+    {
+    public:
+        CoincidenceTrigger();
+        ~CoincidenceTrigger() = default;
+
+        static TriggerParameters& Parameters() { return fParameters; }
+        static G4bool IsEnabled() { return fParameters.enabled; }
+
+        // Filters hits in place; false, with hits emptied, when the event fails the trigger
+        G4bool Apply(std::vector<SipmHit>& hits);
+
+        // Master only, after the accumulables are merged
+        void PrintSummary() const;
+        G4int GetAcceptedEvents() const { return fAccAccepted.GetValue(); }
+        G4double GetRawHits() const { return fAccRawHits.GetValue(); }
+
+    private:
+        static TriggerParameters fParameters;
+
+        std::array<std::vector<G4double>, SipmChannel::kChannels> fTimes;   // ns, current event
+        std::array<G4bool, SipmChannel::kChannels> fFired;
+        std::vector<std::pair<G4double, G4int>> fFireTimes;                 // (ns, channel)
+
+        G4Accumulable<G4int> fAccEvents;
+        G4Accumulable<G4int> fAccAccepted;
+        G4Accumulable<G4double> fAccRawHits;
+        G4Accumulable<G4double> fAccKeptHits;
+    };
+}
+
+#endif
@@ -0,0 +1,177 @@
+
+#include "CommandLine.hh"
+#include <cstdlib>
+#include <string>
+
+namespace G4_BREMS {
+
+    namespace {
+        // Accepts "--name value" and "--name=value"; a missing value leaves it empty
+        G4bool TakeValue(const std::string& arg, const std::string& name, int& i, int argc, char** argv,
+            std::string& value)
+        {
+            if (arg == name) {
+                value = (i + 1 < argc) ? argv[++i] : "";
+                return true;
+            }
+            if (arg.rfind(name + "=", 0) == 0) {
+                value = arg.substr(name.size() + 1);
+                return true;
+            }
+            return false;
+        }
+
+        G4bool ToInt(const std::string& name, const std::string& value, long& result)
+        {
+            char* end = nullptr;
+            result = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || result < 0) {
+                G4cerr << "Error: option " << name << " expects a non-negative integer, got '"
+                    << value << "'" << G4endl;
+                return false;
+            }
+            return true;
+        }
+    }
+
+    G4bool ParseCommandLine(int argc, char** argv, CommandLineOptions& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::string value;
+            long number = 0;
+
+            if (arg == "--help" || arg == "-h") {
+                options.help = true;
+            }
+            else if (arg == "--headless") {
+                options.headless = true;
+            }
+            else if (TakeValue(arg, "--macro", i, argc, argv, value)) {
+                if (value.empty()) {
+                    G4cerr << "Error: option --macro needs a file name" << G4endl;
+                    return false;
+                }
+                options.macro = value;
+            }
+            else if (TakeValue(arg, "--output", i, argc, argv, value)) {
+                if (value.empty()) {
+                    G4cerr << "Error: option --output needs a prefix" << G4endl;
+                    return false;
+                }
+                options.output = value;
+            }
+            else if (TakeValue(arg, "--run-manager", i, argc, argv, value)) {
+                if (value != "serial" && value != "mt" && value != "tasking" && value != "subevt"
+                    && value != "default") {
+                    G4cerr << "Error: unknown run manager '" << value << "'" << G4endl;
+                    return false;
+                }
+                options.runManager = value;
+            }
+            else if (TakeValue(arg, "--threads", i, argc, argv, value)) {
+                if (!ToInt("--threads", value, number)) return false;
+                options.threads = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--subevent-size", i, argc, argv, value)) {
+                if (!ToInt("--subevent-size", value, number) || number == 0) return false;
+                options.subEventSize = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--events", i, argc, argv, value)) {
+                if (!ToInt("--events", value, number)) return false;
+                options.events = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--seed", i, argc, argv, value)) {
+                if (!ToInt("--seed", value, number)) return false;
+                options.seed = number;
+            }
+            else if (TakeValue(arg, "--job-index", i, argc, argv, value)) {
+                if (!ToInt("--job-index", value, number)) return false;
+                options.jobIndex = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--job-count", i, argc, argv, value)) {
+                if (!ToInt("--job-count", value, number) || number == 0) return false;
+                options.jobCount = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--processes", i, argc, argv, value)) {
+                if (!ToInt("--processes", value, number) || number == 0) return false;
+                options.processes = static_cast<G4int>(number);
+            }
+            else if (TakeValue(arg, "--em", i, argc, argv, value)) {
+                if (value.empty()) {
+                    G4cerr << "Error: option --em needs a constructor name" << G4endl;
+                    return false;
+                }
+                options.em = value;
+            }
+            else if (TakeValue(arg, "--optical-profile", i, argc, argv, value)) {
+                if (value.empty()) {
+                    G4cerr << "Error: option --optical-profile needs a profile name" << G4endl;
+                    return false;
+                }
+                options.opticalProfile = value;
+            }
+            else if (TakeValue(arg, "--physics-cache", i, argc, argv, value)) {
+                if (value.empty()) {
+                    G4cerr << "Error: option --physics-cache needs a directory" << G4endl;
+                    return false;
+                }
+                options.physicsCache = value;
+            }
+            else if (arg.rfind("-", 0) != 0 && options.macro.empty()) {
+                // Backwards compatible: G4_Brems run.mac
+                options.macro = arg;
+            }
+            else {
+                G4cerr << "Error: unknown argument '" << arg << "'" << G4endl;
+                return false;
+            }
+        }
+
+        if (options.jobCount > 0 && options.jobIndex < 0) {
+            G4cerr << "Error: --job-count needs --job-index" << G4endl;
+            return false;
+        }
+        if (options.jobCount > 0 && options.jobIndex >= options.jobCount) {
+            G4cerr << "Error: --job-index must be smaller than --job-count" << G4endl;
+            return false;
+        }
+        if (options.IsForkMode()) {
+            if (options.runManager != "default" && options.runManager != "serial") {
+                G4cerr << "Error: --processes runs the serial run manager in every process" << G4endl;
+                return false;
+            }
+            if (options.events <= 0) {
+                G4cerr << "Error: --processes needs --events" << G4endl;
+                return false;
+            }
+            if (options.IsShard()) {
+                G4cerr << "Error: --processes cannot be combined with --job-index" << G4endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PrintUsage(const char* program)
+    {
+        G4cout << "Usage: " << program << " [options] [macro]\n"
+            << "  --macro <file>        execute the macro in batch mode\n"
+            << "  --events <n>          run /run/beamOn <n> after the macro\n"
+            << "  --threads <n>         number of worker threads\n"
+            << "  --run-manager <type>  serial, mt, tasking, subevt or default (G4RUN_MANAGER_TYPE)\n"
+            << "  --processes <n>       fork n serial worker processes sharing the initialized detector\n"
+            << "  --subevent-size <n>   optical photons per sub-event in subevt mode (default 2000)\n"
+            << "  --seed <n>            master random seed (default 12345)\n"
+            << "  --output <prefix>     prefix for the ROOT and csv output files\n"
+            << "  --job-index <i>       shard i of a split job: own event range and _job<i> outputs\n"
+            << "  --job-count <n>       number of shards (only checked against --job-index)\n"
+            << "  --em <name>           EM physics: none, standard (default), option1..option4, livermore,\n"
+            << "                        penelope, wvi, ss or gs\n"
+            << "  --optical-profile <p> optical physics: production, wls-study or full (default)\n"
+            << "  --physics-cache <dir> retrieve the physics tables from <dir>, or store them there\n"
+            << "  --headless            never create the UI session or vis manager\n"
+            << "  --help                print this message\n"
+            << "Without a macro or --events an interactive session with vis.mac is started." << G4endl;
+    }
+}
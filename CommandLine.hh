@@ -0,0 +1,39 @@
+
+#ifndef G4_BREMS_COMMAND_LINE_H
+#define G4_BREMS_COMMAND_LINE_H 1
+
+#include "globals.hh"
+
+namespace G4_BREMS {
+
+    // Options understood by the G4_Brems executable
+    struct CommandLineOptions {
+        G4String macro;                 // --macro <file> (or a bare first argument)
+        G4String output;                // --output <prefix>, empty keeps the default file names
+        G4String runManager = "default"; // --run-manager serial|mt|tasking|subevt|default
+        G4int threads = 0;              // --threads <n>, 0 leaves the Geant4 default
+        G4int subEventSize = 2000;      // --subevent-size <n>, optical photons per sub-event
+        G4int events = 0;               // --events <n>, beamOn after the macro
+        long seed = 12345;              // --seed <n>
+        G4int jobIndex = -1;            // --job-index <i>, shard of a split job (-1: not sharded)
+        G4int jobCount = 0;             // --job-count <n>, total number of shards
+        G4int processes = 1;            // --processes <n>, forked worker processes (serial run manager)
+        G4String em;                    // --em <name>, EM constructor (empty keeps the default)
+        G4String opticalProfile;        // --optical-profile <name>, see OpticalProfile
+        G4String physicsCache;          // --physics-cache <dir>, stored physics tables
+        G4bool headless = false;        // --headless, never create UI or vis
+        G4bool help = false;            // --help
+
+        // Interactive session only when nothing was asked for on the command line
+        G4bool IsInteractive() const { return !headless && macro.empty() && events == 0; }
+        G4bool IsSubEventMode() const { return runManager == "subevt"; }
+        G4bool IsShard() const { return jobIndex >= 0; }
+        G4bool IsForkMode() const { return processes > 1; }
+    };
+
+    // Returns false (after printing the reason) on malformed arguments
+    G4bool ParseCommandLine(int argc, char** argv, CommandLineOptions& options);
+    void PrintUsage(const char* program);
+}
+
+#endif
@@ -0,0 +1,142 @@
+
+#include "CosmicMuonSampler.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace G4_BREMS {
+
+    namespace {
+        constexpr G4double kMuonMass = 0.1056583755;   // GeV
+        constexpr G4double kBackOff = 1. * mm;
+
+        // Effective cos(theta) for the curvature of the atmosphere (Chirkin's fit)
+        G4double EffectiveCos(G4double cosTheta)
+        {
+            constexpr G4double p1 = 0.102573, p2 = -0.068287, p3 = 0.958633, p4 = 0.0407253, p5 = 0.817285;
+            G4double value = (cosTheta * cosTheta + p1 * p1 + p2 * std::pow(cosTheta, p3) + p4 * std::pow(cosTheta, p5))
+                / (1. + p1 * p1 + p2 + p4);
+            return std::sqrt(std::max(value, 0.));
+        }
+
+        // Position inside a bin and the bin from a continuous index k + f
+        std::size_t SplitIndex(G4double index, std::size_t bins, G4double& fraction)
+        {
+            auto bin = std::min(static_cast<std::size_t>(index), bins - 1);
+            fraction = std::min(std::max(index - bin, 0.), 1.);
+            return bin;
+        }
+    }
+
+    G4double CosmicMuonSampler::Intensity(G4double energy, G4double cosTheta)
+    {
+        const G4double cosStar = EffectiveCos(cosTheta);
+        if (cosStar <= 0.) return 0.;
+        const G4double shape = energy * (1. + 3.64 / (energy * std::pow(cosStar, 1.29)));
+        return 0.14 * std::pow(shape, -2.7)
+            * (1. / (1. + 1.1 * energy * cosStar / 115.) + 0.054 / (1. + 1.1 * energy * cosStar / 850.));
+    }
+
+    void CosmicMuonSampler::Build(const G4ThreeVector& min, const G4ThreeVector& max,
+        G4double minEnergy, G4double maxEnergy)
+    {
+        fMin = min;
+        fMax = max;
+        const G4ThreeVector size = max - min;
+        fFaceArea[0] = size.y() * size.z() / cm2;
+        fFaceArea[1] = size.x() * size.z() / cm2;
+        fFaceArea[2] = size.x() * size.y() / cm2;
+
+        fLogMinEnergy = std::log(minEnergy / GeV + kMuonMass);
+        fLogEnergyStep = (std::log(maxEnergy / GeV + kMuonMass) - fLogMinEnergy) / kEnergyBins;
+
+        // Energy tables per zenith bin: E dI/dE on the ln E edges, integrated exactly as a power
+        // law between them; their sums give the intensity of every zenith bin
+        std::vector<G4double> indexEdges(kEnergyBins + 1);
+        std::iota(indexEdges.begin(), indexEdges.end(), 0.);
+        std::vector<G4double> density(kEnergyBins + 1);
+        std::vector<G4double> weights(kEnergyBins);
+        std::vector<G4double> intensity(kCosBins);
+        fEnergy.assign(kCosBins, AliasTable());
+        fSlope.assign(std::size_t(kCosBins) * kEnergyBins, 0.);
+        const G4double cosStep = 1. / kCosBins;
+        for (G4int c = 0; c < kCosBins; c++) {
+            const G4double cosTheta = (c + 0.5) * cosStep;
+            for (G4int e = 0; e <= kEnergyBins; e++) {
+                const G4double energy = std::exp(fLogMinEnergy + e * fLogEnergyStep);
+                density[e] = energy * Intensity(energy, cosTheta);
+            }
+            intensity[c] = 0.;
+            for (G4int e = 0; e < kEnergyBins; e++) {
+                const G4double ratio = (density[e] > 0. && density[e + 1] > 0.) ? density[e] / density[e + 1] : 1.;
+                const G4double slope = std::log(ratio) / fLogEnergyStep;
+                fSlope[std::size_t(c) * kEnergyBins + e] = slope;
+                weights[e] = std::abs(slope) > 1e-9
+                    ? (density[e] - density[e + 1]) / slope
+                    : density[e] * fLogEnergyStep;
+                intensity[c] += weights[e];
+            }
+            fEnergy[c].Build(indexEdges, weights);
+        }
+
+        // Directions from intensity x projected area, per cm2 s sr x cm2 x sr
+        std::vector<G4double> directionEdges(std::size_t(kCosBins) * kPhiBins + 1);
+        std::iota(directionEdges.begin(), directionEdges.end(), 0.);
+        std::vector<G4double> directionWeights(std::size_t(kCosBins) * kPhiBins);
+        const G4double phiStep = twopi / kPhiBins;
+        for (G4int c = 0; c < kCosBins; c++) {
+            const G4double cosTheta = (c + 0.5) * cosStep;
+            const G4double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+            for (G4int p = 0; p < kPhiBins; p++) {
+                const G4double phi = (p + 0.5) * phiStep;
+                const G4double area = std::abs(sinTheta * std::cos(phi)) * fFaceArea[0]
+                    + std::abs(sinTheta * std::sin(phi)) * fFaceArea[1] + cosTheta * fFaceArea[2];
+                directionWeights[std::size_t(c) * kPhiBins + p] = intensity[c] * area * cosStep * phiStep;
+            }
+        }
+        fDirection.Build(directionEdges, directionWeights);
+        fRate = std::accumulate(directionWeights.begin(), directionWeights.end(), 0.) * hertz;
+    }
+
+    void CosmicMuonSampler::Sample(const G4double* u, Muon& muon) const
+    {
+        // u[0] zenith and azimuth bin and cos(theta) in it, u[1] azimuth in the bin
+        G4double fraction;
+        const std::size_t bin = SplitIndex(fDirection.Sample(u[0]), std::size_t(kCosBins) * kPhiBins, fraction);
+        const std::size_t c = bin / kPhiBins;
+        const G4double cosTheta = (c + fraction) / kCosBins;
+        const G4double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+        const G4double phi = (bin % kPhiBins + u[1]) * twopi / kPhiBins;
+        // Arriving from (theta, phi), travelling down
+        muon.direction.set(-sinTheta * std::cos(phi), -sinTheta * std::sin(phi), -cosTheta);
+
+        // u[2] energy, power law inside the ln E bin
+        const std::size_t e = SplitIndex(fEnergy[c].Sample(u[2]), kEnergyBins, fraction);
+        const G4double slope = fSlope[c * kEnergyBins + e];
+        G4double step = fraction * fLogEnergyStep;
+        if (std::abs(slope) > 1e-9) {
+            step = -std::log1p(fraction * std::expm1(-slope * fLogEnergyStep)) / slope;
+        }
+        const G4double energy = std::exp(fLogMinEnergy + e * fLogEnergyStep + step);
+        muon.kineticEnergy = (energy - kMuonMass) * GeV;
+
+        // u[3] entry face, weighted by its projected area; u[4], u[5] point on it
+        const G4double projected[3] = { std::abs(muon.direction.x()) * fFaceArea[0],
+            std::abs(muon.direction.y()) * fFaceArea[1], std::abs(muon.direction.z()) * fFaceArea[2] };
+        G4double pick = u[3] * (projected[0] + projected[1] + projected[2]);
+        G4int face = 0;
+        while (face < 2 && pick >= projected[face]) pick -= projected[face++];
+        const G4int a = (face + 1) % 3;
+        const G4int b = (face + 2) % 3;
+        G4ThreeVector entry;
+        entry[face] = muon.direction[face] < 0. ? fMax[face] : fMin[face];
+        entry[a] = fMin[a] + u[4] * (fMax[a] - fMin[a]);
+        entry[b] = fMin[b] + u[5] * (fMax[b] - fMin[b]);
+        muon.position = entry - kBackOff * muon.direction;
+
+        // u[6] charge
+        muon.positive = u[6] * (1. + kChargeRatio) < kChargeRatio;
+    }
+}
@@ -0,0 +1,70 @@
+
+#ifndef G4_BREMS_COSMIC_MUON_SAMPLER_H
+#define G4_BREMS_COSMIC_MUON_SAMPLER_H 1
+
+#include "AliasTable.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Sea-level cosmic muons that all cross a box (the bounding box of the layer stack, +z up).
+    //
+    // The intensity is the Gaisser parametrization modified for low energies and the earth's
+    // curvature (Guan et al., arXiv:1509.06176), in total energy E and zenith angle theta:
+    //   dI/dE dOmega = 0.14 [E (1 + 3.64 / (E cos*^1.29))]^-2.7
+    //                  x [1 / (1 + 1.1 E cos* / 115) + 0.054 / (1 + 1.1 E cos* / 850)]
+    // per cm2 s sr GeV. A muon of direction d crosses the box when it enters through one of the
+    // three faces it sees, so the rate through the box is the intensity times the projected area
+    // A(d) = sum |d.n_face| A_face, integrated over energy and solid angle. Directions are drawn
+    // from intensity x A(d) and the entry point uniformly on the projected area (a visible face
+    // with probability |d.n_face| A_face / A(d), then uniformly on it): every muon is aimed at the
+    // box and each event stands for 1 / GetRate() of exposure.
+    class CosmicMuonSampler
+    {
+    public:
+        static constexpr G4int kCosBins = 90;
+        static constexpr G4int kPhiBins = 72;
+        static constexpr G4int kEnergyBins = 256;      // logarithmic, per zenith bin
+        static constexpr G4double kChargeRatio = 1.27; // mu+ / mu-
+        static constexpr G4int kUniforms = 7;
+
+        struct Muon {
+            G4ThreeVector position;    // on the entry face, backed off by 1 mm
+            G4ThreeVector direction;
+            G4double kineticEnergy;
+            G4bool positive;
+        };
+
+        // Intensity per cm2 s sr GeV, total energy in GeV
+        static G4double Intensity(G4double energy, G4double cosTheta);
+
+        // Kinetic energy range in Geant4 units
+        void Build(const G4ThreeVector& min, const G4ThreeVector& max, G4double minEnergy, G4double maxEnergy);
+        G4bool IsBuiltFor(const G4ThreeVector& min, const G4ThreeVector& max) const
+        {
+            return !fDirection.IsEmpty() && min == fMin && max == fMax;
+        }
+
+        // kUniforms numbers in [0,1)
+        void Sample(const G4double* u, Muon& muon) const;
+
+        // Muons crossing the box per unit time, Geant4 units
+        G4double GetRate() const { return fRate; }
+
+    private:
+        G4ThreeVector fMin;
+        G4ThreeVector fMax;
+        G4double fFaceArea[3] = {};                // faces normal to x, y, z
+        G4double fLogMinEnergy = 0.;               // ln of the total energy in GeV
+        G4double fLogEnergyStep = 0.;
+        G4double fRate = 0.;
+        AliasTable fDirection;                     // [cos bin][phi bin]
+        // ln E per cos bin; inside a bin the intensity is interpolated as a power law of E
+        std::vector<AliasTable> fEnergy;
+        std::vector<G4double> fSlope;              // [cos bin][energy bin], of ln(E dI/dE) in ln E
+    };
+}
+
+#endif
@@ -6,28 +6,77 @@
 #include "G4LogicalVolume.hh"
 #include "G4VSensitiveDetector.hh"
 #include "SteppingAction.hh"
+#include "G4SystemOfUnits.hh"
+#include <vector>
+
+class G4Material;
+class G4OpticalSurface;
 
 namespace G4_BREMS {
+    class DetectorMessenger;
+    class ScanMessenger;
+
+    // Merged and energy-sorted optical spectra read from the BCF-91A csv files
+    struct OpticalSpectra {
+        std::vector<G4double> energies;
+        std::vector<G4double> scintEmission;
+        std::vector<G4double> absFiber;
+        std::vector<G4double> emissionIntensity;
+    };
+
+    // Optical constants and layer spacing that can change between runs without rebuilding
+    // the detector (see /snf/scan/). Surface values are flat in photon energy.
+    struct OpticalParameters {
+        G4double fiberReflectivity = 0.5;
+        G4double fiberTransmittance = 0.5;
+        G4double sipmReflectivity = 0.1;
+        G4double sipmTransmittance = 0.9;
+        G4double scintillationYield = 12000.0 / CLHEP::MeV;
+        G4double wlsTimeConstant = 0.5 * CLHEP::ns;
+        G4double layerSpacing = 0.1 * CLHEP::mm;
+    };
+
     class DetectorConstruction : public G4VUserDetectorConstruction {
     public:
-        
+
         DetectorConstruction();  // Add constructor
         ~DetectorConstruction() override;  // Add destructor
 
         G4VPhysicalVolume* Construct() override;
         void ConstructSDandField() override;
 
-        
+
         G4LogicalVolume* GetTileVolume() const { return fTileVolume; }
         G4LogicalVolume* GetFiberVolume() const { return fFiberCoreVolume; }
         G4LogicalVolume* GetCladVolume() const { return fFiberCladVolume; }
         G4LogicalVolume* GetSipmVolume() const { return fSipmVolume; }
-        
-        
+
+        // Geometry snapshot (GDML + binary property cache)
+        void SetSnapshotImportPath(const G4String& path) { fSnapshotImportPath = path; }
+        void SetSnapshotExportPath(const G4String& path) { fSnapshotExportPath = path; }
+        G4bool ExportSnapshot(const G4String& path) const;
+
+        // Before construction the values are used by Construct(); afterwards the property
+        // tables and layer placements are updated in place (master, between runs)
+        const OpticalParameters& GetOpticalParameters() const { return fOptical; }
+        void SetOpticalParameters(const OpticalParameters& parameters);
+
 
     private:
-        
-        
+        G4bool LoadSpectra();
+        G4VPhysicalVolume* ConstructDetector();
+        G4VPhysicalVolume* ConstructFromSnapshot();
+        // Tiles, Fibers and Sipms regions for the production cuts of PhysicsList
+        void DefineRegions();
+
+        void ApplyMaterialProperties(G4Material* air, G4Material* polystyrene, G4Material* fiber,
+            G4Material* clad, G4Material* sipm) const;
+        void ApplySurfaceProperties(G4OpticalSurface* fiberSurface, G4OpticalSurface* tileFiberSurface,
+            G4OpticalSurface* fiberSipmSurface) const;
+        // Shift every world daughter above the first bottom layer along z
+        void MoveLayers(G4double shift);
+
+
         G4LogicalVolume* fTileVolume;
         G4LogicalVolume* fFiberCoreVolume;
         G4LogicalVolume* fFiberCladVolume;
@@ -37,8 +86,19 @@ namespace G4_BREMS {
         G4VSensitiveDetector* fFiberCoreSD;
         G4VSensitiveDetector* fFiberCladSD;
         G4VSensitiveDetector* fSipmSD;
-        
-        
+
+        OpticalSpectra fSpectra;
+        G4VPhysicalVolume* fWorld;
+
+        G4String fSnapshotImportPath;
+        G4String fSnapshotExportPath;
+        DetectorMessenger* fMessenger;
+
+        OpticalParameters fOptical;
+        G4OpticalSurface* fFiberSurface;
+        G4OpticalSurface* fTileFiberSurface;
+        G4OpticalSurface* fFiberSipmSurface;
+        ScanMessenger* fScanMessenger;
 
     };
 }
@@ -0,0 +1,57 @@
+
+#include "DetectorMessenger.hh"
+#include "DetectorConstruction.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4StateManager.hh"
+
+namespace G4_BREMS {
+
+    DetectorMessenger::DetectorMessenger(DetectorConstruction* detector)
+        : G4UImessenger(), fDetector(detector)
+    {
+        fSnfDirectory = new G4UIdirectory("/snf/");
+        fSnfDirectory->SetGuidance("SNF monitoring detector simulation control.");
+
+        fGeometryDirectory = new G4UIdirectory("/snf/geometry/", false);
+        fGeometryDirectory->SetGuidance("Detector geometry control.");
+
+        fImportSnapshotCmd = new G4UIcmdWithAString("/snf/geometry/importSnapshot", this);
+        fImportSnapshotCmd->SetGuidance("Load the detector from a GDML snapshot instead of constructing it.");
+        fImportSnapshotCmd->SetGuidance("The <file>.props property cache must sit next to the GDML file;");
+        fImportSnapshotCmd->SetGuidance("a stale or missing snapshot falls back to the full construction.");
+        fImportSnapshotCmd->SetParameterName("file", false);
+        fImportSnapshotCmd->AvailableForStates(G4State_PreInit);
+        fImportSnapshotCmd->SetToBeBroadcasted(false);
+
+        fExportSnapshotCmd = new G4UIcmdWithAString("/snf/geometry/exportSnapshot", this);
+        fExportSnapshotCmd->SetGuidance("Write the constructed detector to a GDML snapshot and <file>.props cache.");
+        fExportSnapshotCmd->SetGuidance("Before /run/initialize the snapshot is written right after construction.");
+        fExportSnapshotCmd->SetParameterName("file", false);
+        fExportSnapshotCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fExportSnapshotCmd->SetToBeBroadcasted(false);
+    }
+
+    DetectorMessenger::~DetectorMessenger()
+    {
+        delete fImportSnapshotCmd;
+        delete fExportSnapshotCmd;
+        delete fGeometryDirectory;
+        delete fSnfDirectory;
+    }
+
+    void DetectorMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        if (command == fImportSnapshotCmd) {
+            fDetector->SetSnapshotImportPath(newValue);
+        }
+        else if (command == fExportSnapshotCmd) {
+            if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_PreInit) {
+                fDetector->SetSnapshotExportPath(newValue);
+            }
+            else {
+                fDetector->ExportSnapshot(newValue);
+            }
+        }
+    }
+}
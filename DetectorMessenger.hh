@@ -0,0 +1,32 @@
+
+#ifndef G4_BREMS_DETECTOR_MESSENGER_H
+#define G4_BREMS_DETECTOR_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+
+namespace G4_BREMS {
+    class DetectorConstruction;
+
+    class DetectorMessenger : public G4UImessenger
+    {
+    public:
+        DetectorMessenger(DetectorConstruction* detector);
+        ~DetectorMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        DetectorConstruction* fDetector;
+
+        G4UIdirectory* fSnfDirectory;
+        G4UIdirectory* fGeometryDirectory;
+        G4UIcmdWithAString* fImportSnapshotCmd;
+        G4UIcmdWithAString* fExportSnapshotCmd;
+    };
+}
+
+#endif
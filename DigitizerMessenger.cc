@@ -0,0 +1,154 @@
+
+#include "DigitizerMessenger.hh"
+#include "SipmDigitizer.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4SystemOfUnits.hh"
+
+namespace G4_BREMS {
+
+    namespace {
+        // Parameters given as plain numbers; times are stored in ns and rates in Hz
+        struct DoubleParameter {
+            const char* name;
+            const char* guidance;
+            G4double DigitizerParameters::* member;
+            const char* unitCategory;   // nullptr for dimensionless values
+            const char* defaultUnit;
+            G4double unit;
+            const char* range;
+        };
+
+        const DoubleParameter kDoubleParameters[] = {
+            { "samplingPeriod", "Time between samples (default 2 ns, 500 MS/s).",
+                &DigitizerParameters::samplingPeriod, "Time", "ns", ns, "value > 0" },
+            { "windowStart", "Event time of the first sample (default 0 ns).",
+                &DigitizerParameters::windowStart, "Time", "ns", ns, nullptr },
+            { "riseTime", "Rise time constant of the single-photoelectron pulse (default 1 ns).",
+                &DigitizerParameters::riseTime, "Time", "ns", ns, "value > 0" },
+            { "fallTime", "Fall time constant of the single-photoelectron pulse (default 40 ns).",
+                &DigitizerParameters::fallTime, "Time", "ns", ns, "value > 0" },
+            { "gain", "Peak amplitude of one photoelectron in ADC counts (default 20).",
+                &DigitizerParameters::gain, nullptr, nullptr, 1., "value >= 0" },
+            { "gainSpread", "Relative sigma of the avalanche amplitude (default 0.1).",
+                &DigitizerParameters::gainSpread, nullptr, nullptr, 1., "value >= 0" },
+            { "crosstalk", "Probability of an avalanche to fire a neighbour cell (default 0.1).",
+                &DigitizerParameters::crosstalk, nullptr, nullptr, 1., "value >= 0 && value < 1" },
+            { "afterpulse", "Afterpulse probability per avalanche (default 0.05).",
+                &DigitizerParameters::afterpulse, nullptr, nullptr, 1., "value >= 0 && value <= 1" },
+            { "afterpulseTime", "Mean delay of an afterpulse (default 20 ns).",
+                &DigitizerParameters::afterpulseTime, "Time", "ns", ns, "value > 0" },
+            { "recoveryTime", "Cell recovery time, scales the afterpulse amplitude (default 15 ns).",
+                &DigitizerParameters::recoveryTime, "Time", "ns", ns, "value > 0" },
+            { "darkRate", "Dark count rate per channel (default 100 kHz).",
+                &DigitizerParameters::darkRate, "Frequency", "kHz", hertz, "value >= 0" },
+            { "baseline", "Baseline in ADC counts (default 200).",
+                &DigitizerParameters::baseline, nullptr, nullptr, 1., nullptr },
+            { "noise", "Sigma of the white electronics noise in ADC counts (default 1).",
+                &DigitizerParameters::noise, nullptr, nullptr, 1., "value >= 0" },
+            { "cfdFraction", "Constant fraction of the peak that defines the channel time (default 0.3).",
+                &DigitizerParameters::cfdFraction, nullptr, nullptr, 1., "value > 0 && value < 1" },
+            { "featureThreshold", "ADC counts above baseline for time over threshold and the features csv (default 10).",
+                &DigitizerParameters::featureThreshold, nullptr, nullptr, 1., "value >= 0" }
+        };
+    }
+
+    DigitizerMessenger::DigitizerMessenger()
+        : G4UImessenger()
+    {
+        fDigiDirectory = new G4UIdirectory("/snf/digi/", false);
+        fDigiDirectory->SetGuidance("SiPM digitizer: photon hits to sampled waveforms per channel.");
+
+        fEnableCmd = new G4UIcmdWithABool("/snf/digi/enable", this);
+        fEnableCmd->SetGuidance("Digitize every event; traces go to digits_run<N>.bin.");
+        fEnableCmd->SetParameterName("enable", true);
+        fEnableCmd->SetDefaultValue(true);
+
+        fSamplesCmd = new G4UIcmdWithAnInteger("/snf/digi/samples", this);
+        fSamplesCmd->SetGuidance("Samples per trace (default 256).");
+        fSamplesCmd->SetParameterName("samples", false);
+        fSamplesCmd->SetRange("samples > 0 && samples <= 65536");
+
+        fAdcBitsCmd = new G4UIcmdWithAnInteger("/snf/digi/adcBits", this);
+        fAdcBitsCmd->SetGuidance("ADC resolution; samples are clipped to [0, 2^bits - 1] (default 12).");
+        fAdcBitsCmd->SetParameterName("bits", false);
+        fAdcBitsCmd->SetRange("bits > 0 && bits <= 16");
+
+        fBaselineSamplesCmd = new G4UIcmdWithAnInteger("/snf/digi/baselineSamples", this);
+        fBaselineSamplesCmd->SetGuidance("Leading samples averaged for the baseline of the features (default 16).");
+        fBaselineSamplesCmd->SetParameterName("samples", false);
+        fBaselineSamplesCmd->SetRange("samples > 0");
+
+        for (const auto& parameter : kDoubleParameters) {
+            G4String path = G4String("/snf/digi/") + parameter.name;
+            G4UIcommand* command = nullptr;
+            if (parameter.unitCategory) {
+                auto* unitCommand = new G4UIcmdWithADoubleAndUnit(path, this);
+                unitCommand->SetParameterName("value", false);
+                unitCommand->SetUnitCategory(parameter.unitCategory);
+                unitCommand->SetDefaultUnit(parameter.defaultUnit);
+                command = unitCommand;
+            }
+            else {
+                auto* plainCommand = new G4UIcmdWithADouble(path, this);
+                plainCommand->SetParameterName("value", false);
+                command = plainCommand;
+            }
+            command->SetGuidance(parameter.guidance);
+            if (parameter.range) command->SetRange(parameter.range);
+            fDoubleCmds.push_back({ command, parameter.member, parameter.unit });
+        }
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fEnableCmd, fSamplesCmd, fAdcBitsCmd, fBaselineSamplesCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+        for (const auto& entry : fDoubleCmds) {
+            entry.command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            entry.command->SetToBeBroadcasted(false);
+        }
+    }
+
+    DigitizerMessenger::~DigitizerMessenger()
+    {
+        delete fEnableCmd;
+        delete fSamplesCmd;
+        delete fAdcBitsCmd;
+        delete fBaselineSamplesCmd;
+        for (const auto& entry : fDoubleCmds) delete entry.command;
+        delete fDigiDirectory;
+    }
+
+    void DigitizerMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        DigitizerParameters& parameters = SipmDigitizer::Parameters();
+        if (command == fEnableCmd) {
+            parameters.enabled = fEnableCmd->GetNewBoolValue(newValue);
+            return;
+        }
+        if (command == fSamplesCmd) {
+            parameters.samples = fSamplesCmd->GetNewIntValue(newValue);
+            return;
+        }
+        if (command == fAdcBitsCmd) {
+            parameters.adcBits = fAdcBitsCmd->GetNewIntValue(newValue);
+            return;
+        }
+        if (command == fBaselineSamplesCmd) {
+            parameters.baselineSamples = fBaselineSamplesCmd->GetNewIntValue(newValue);
+            return;
+        }
+
+        for (const auto& entry : fDoubleCmds) {
+            if (command != entry.command) continue;
+            auto* unitCommand = dynamic_cast<G4UIcmdWithADoubleAndUnit*>(command);
+            G4double value = unitCommand ? unitCommand->GetNewDoubleValue(newValue) / entry.unit
+                : G4UIcommand::ConvertToDouble(newValue);
+            parameters.*(entry.member) = value;
+            return;
+        }
+    }
+}
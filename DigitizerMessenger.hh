@@ -0,0 +1,42 @@
+
+#ifndef G4_BREMS_DIGITIZER_MESSENGER_H
+#define G4_BREMS_DIGITIZER_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+#include <vector>
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+
+namespace G4_BREMS {
+
+    struct DigitizerParameters;
+
+    // /snf/digi/: SiPM and front-end model of the digitizer (master only, see SipmDigitizer)
+    class DigitizerMessenger : public G4UImessenger
+    {
+    public:
+        DigitizerMessenger();
+        ~DigitizerMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        struct DoubleCommand {
+            G4UIcommand* command;
+            G4double DigitizerParameters::* member;
+            G4double unit;
+        };
+
+        G4UIdirectory* fDigiDirectory;
+        G4UIcmdWithABool* fEnableCmd;
+        G4UIcmdWithAnInteger* fSamplesCmd;
+        G4UIcmdWithAnInteger* fAdcBitsCmd;
+        G4UIcmdWithAnInteger* fBaselineSamplesCmd;
+        std::vector<DoubleCommand> fDoubleCmds;
+    };
+}
+
+#endif
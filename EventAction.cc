@@ -0,0 +1,107 @@
+
+#include "EventAction.hh"
+#include "RunAction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "ChannelHistograms.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+#include <mutex>
+
+namespace G4_BREMS {
+
+    namespace {
+        // Guards a parent event's hits and published flag between its EndOfEventAction and the
+        // merging of its sub-events
+        G4Mutex subEventMutex = G4MUTEX_INITIALIZER;
+    }
+
+    void SipmEventInfo::Print() const
+    {
+        G4cout << "SipmEventInfo: " << hits.size() << " SiPM hits" << G4endl;
+    }
+
+    EventAction::EventAction(G4bool subEventMode)
+        : G4UserEventAction(), fSubEventMode(subEventMode), fEventInfo(nullptr),
+        fRunAction(nullptr), fGenerator(nullptr)
+    {
+    }
+
+    void EventAction::BeginOfEventAction(const G4Event*)
+    {
+        // Owned by the event from here on
+        fEventInfo = new SipmEventInfo;
+        G4EventManager::GetEventManager()->SetUserInformation(fEventInfo);
+
+        if (fRunAction) fRunAction->BeginOfEvent();
+    }
+
+    void EventAction::EndOfEventAction(const G4Event* event)
+    {
+        // Sub-events are merged into their parent event on the master, see MergeSubEvent
+        if (fSubEventMode && !G4Threading::IsMasterThread()) return;
+
+        // Pile-up before the trigger, which judges the mixed event; then rejected events and
+        // channels that did not fire never reach an output
+        if (!fSubEventMode && fRunAction) fRunAction->MixEvent(event->GetEventID(), fEventInfo->hits);
+        G4bool triggered = fSubEventMode || !fRunAction || fRunAction->TriggerEvent(fEventInfo->hits);
+        if (fSubEventMode) {
+            // Publishes the master's hits and those merged so far; the list is not touched again
+            G4AutoLock lock(&subEventMutex);
+            fEventInfo->published = true;
+            PublishHits(fEventInfo->hits);
+        }
+        else {
+            PublishHits(fEventInfo->hits);
+        }
+
+        // Sobol replicas and response matrix; RunAction refuses them in sub-event mode, where
+        // the photons of the event may still be in flight
+        if (fRunAction) {
+            G4int replica = fGenerator ? fGenerator->GetCurrentReplica() : -1;
+            fRunAction->EndOfEvent(event->GetEventID(), replica, fEventInfo->hits, triggered);
+        }
+    }
+
+#if G4VERSION_NUMBER >= 1120
+    void EventAction::MergeSubEvent(G4Event* masterEvent, const G4Event* subEvent)
+    {
+        auto subInfo = dynamic_cast<const SipmEventInfo*>(subEvent->GetUserInformation());
+        if (!subInfo || subInfo->hits.empty()) return;
+
+        // Sub-events may complete after the parent's EndOfEventAction. The hits of those that
+        // complete before are published with the parent's, the others straight away. For the
+        // same reason the trigger, the library recording, the mixing and the photoelectrons
+        // per event of the channel histograms, which need the whole event, cannot be applied.
+        if (CoincidenceTrigger::IsEnabled() || BackgroundMixer::IsRecording() || BackgroundMixer::IsMixing()
+            || ChannelHistograms::IsEnabled()) {
+            static std::once_flag warned;
+            std::call_once(warned, [] {
+                G4Exception("EventAction::MergeSubEvent", "Trigger_W002", JustWarning,
+                    "Trigger, hit library recording, background mixing and per-event channel photoelectrons "
+                    "are not applied in sub-event mode.");
+            });
+        }
+
+        auto masterInfo = dynamic_cast<SipmEventInfo*>(masterEvent->GetUserInformation());
+        G4AutoLock lock(&subEventMutex);
+        if (masterInfo && !masterInfo->published) {
+            masterInfo->hits.insert(masterInfo->hits.end(), subInfo->hits.begin(), subInfo->hits.end());
+        }
+        else {
+            PublishHits(subInfo->hits);
+        }
+    }
+#endif
+
+    void EventAction::PublishHits(const std::vector<SipmHit>& hits) const
+    {
+        // Histogram mode keeps no run-wide hit list
+        if (hits.empty() || ChannelHistograms::IsEnabled()) return;
+
+        // One lock per event instead of one per hit
+        G4AutoLock lock(&sipmHitsMutex);
+        gSipmHits.insert(gSipmHits.end(), hits.begin(), hits.end());
+    }
+}
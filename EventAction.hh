@@ -0,0 +1,61 @@
+
+#ifndef G4_BREMS_EVENT_ACTION_H
+#define G4_BREMS_EVENT_ACTION_H 1
+
+#include "G4UserEventAction.hh"
+#include "G4VUserEventInformation.hh"
+#include "G4Version.hh"
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <vector>
+
+class G4Event;
+
+namespace G4_BREMS {
+    class RunAction;
+    class PrimaryGeneratorAction;
+
+    // SiPM hits of one event (or of one sub-event in sub-event parallel mode)
+    class SipmEventInfo : public G4VUserEventInformation
+    {
+    public:
+        SipmEventInfo() = default;
+        ~SipmEventInfo() override = default;
+
+        void Print() const override;
+
+        std::vector<SipmHit> hits;
+        // Sub-event mode: the parent's EndOfEventAction has published the hits, so sub-events
+        // merged after it publish their own
+        G4bool published = false;
+    };
+
+    class EventAction : public G4UserEventAction
+    {
+    public:
+        EventAction(G4bool subEventMode);
+        ~EventAction() override = default;
+
+        void BeginOfEventAction(const G4Event* event) override;
+        void EndOfEventAction(const G4Event* event) override;
+#if G4VERSION_NUMBER >= 1120
+        void MergeSubEvent(G4Event* masterEvent, const G4Event* subEvent) override;
+#endif
+
+        void AddSipmHit(const SipmHit& hit) { fEventInfo->hits.push_back(hit); }
+
+        // Optional, for the per-replica tallies of the Sobol sampler
+        void SetRunAction(RunAction* runAction) { fRunAction = runAction; }
+        void SetPrimaryGenerator(PrimaryGeneratorAction* generator) { fGenerator = generator; }
+
+    private:
+        void PublishHits(const std::vector<SipmHit>& hits) const;
+
+        G4bool fSubEventMode;
+        SipmEventInfo* fEventInfo;
+        RunAction* fRunAction;
+        PrimaryGeneratorAction* fGenerator;
+    };
+}
+
+#endif
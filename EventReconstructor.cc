@@ -0,0 +1,112 @@
+
+#include "EventReconstructor.hh"
+#include "G4AutoLock.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    ReconstructionParameters EventReconstructor::fParameters;
+
+    namespace {
+        G4Mutex reconstructionMutex = G4MUTEX_INITIALIZER;
+        std::ofstream gRecoFile;
+    }
+
+    void EventReconstructor::OpenOutput(const G4String& path)
+    {
+        G4AutoLock lock(&reconstructionMutex);
+        if (gRecoFile.is_open()) gRecoFile.close();
+        gRecoFile.open(path, std::ios::trunc);
+        if (!gRecoFile.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return;
+        }
+        gRecoFile << "event,x_mm,y_mm,z_mm,energy_MeV,time_ns,vertex_fraction,gamma_clusters\n";
+        G4cout << "Writing reconstructed events to " << path << G4endl;
+    }
+
+    void EventReconstructor::CloseOutput()
+    {
+        G4AutoLock lock(&reconstructionMutex);
+        if (gRecoFile.is_open()) gRecoFile.close();
+    }
+
+    void EventReconstructor::BeginOfRun()
+    {
+        fConfigured = false;
+        fEventIDs.clear();
+        fCharge.clear();
+        fTime.clear();
+        if (!fParameters.enabled) return;
+
+        // The geometry may have been rebuilt or imported since the last run
+        const G4LogicalVolume* sipmVolume = G4LogicalVolumeStore::GetInstance()->GetVolume("Sipm", false);
+        VertexGeometry geometry;
+        G4int placed = 0;
+        for (const G4VPhysicalVolume* volume : *G4PhysicalVolumeStore::GetInstance()) {
+            if (!sipmVolume || volume->GetLogicalVolume() != sipmVolume) continue;
+            const G4int channel = volume->GetCopyNo();
+            if (channel < 0 || channel >= SipmChannel::kChannels) continue;
+            // Bottom fibers run along y and measure x, top fibers the other way round
+            const G4ThreeVector position = volume->GetTranslation();
+            geometry.coordinate[channel] = static_cast<float>((SipmChannel::IsTopLayer(channel) ? position.y() : position.x()) / mm);
+            geometry.z[channel] = static_cast<float>(position.z() / mm);
+            placed++;
+        }
+        if (placed != SipmChannel::kChannels) {
+            G4ExceptionDescription msg;
+            msg << "Found " << placed << " of " << SipmChannel::kChannels
+                << " SiPM placements; events are not reconstructed in this run.";
+            G4Exception("EventReconstructor::BeginOfRun", "Reco_W001", JustWarning, msg);
+            return;
+        }
+
+        fFitter.Configure(geometry, fParameters.fit);
+        fConfigured = true;
+    }
+
+    void EventReconstructor::AddEvent(G4int eventID, const std::vector<SipmHit>& hits)
+    {
+        if (!fConfigured) return;
+
+        const std::size_t offset = fCharge.size();
+        fEventIDs.push_back(eventID);
+        fCharge.resize(offset + SipmChannel::kChannels, 0.f);
+        fTime.resize(offset + SipmChannel::kChannels, 0.f);
+        float* charge = &fCharge[offset];
+        float* time = &fTime[offset];
+        for (const auto& hit : hits) {
+            if (hit.sipmID < 0 || hit.sipmID >= SipmChannel::kChannels) continue;
+            const float t = static_cast<float>(hit.time / ns);
+            time[hit.sipmID] = charge[hit.sipmID] > 0.f ? std::min(time[hit.sipmID], t) : t;
+            charge[hit.sipmID] += 1.f;
+        }
+
+        if (fEventIDs.size() >= VertexFitter::kBatch) Flush();
+    }
+
+    void EventReconstructor::Flush()
+    {
+        if (fEventIDs.empty()) return;
+
+        fFitter.Fit(fCharge.data(), fTime.data(), fEventIDs.size(), fResults);
+        fLines.clear();
+        for (std::size_t event = 0; event < fEventIDs.size(); event++) {
+            fLines += std::to_string(fEventIDs[event]) + "," + std::to_string(fResults.x[event]) + ","
+                + std::to_string(fResults.y[event]) + "," + std::to_string(fResults.z[event]) + ","
+                + std::to_string(fResults.energy[event]) + "," + std::to_string(fResults.time[event]) + ","
+                + std::to_string(fResults.vertexFraction[event]) + ","
+                + std::to_string(static_cast<G4int>(fResults.gammaClusters[event])) + "\n";
+        }
+        fEventIDs.clear();
+        fCharge.clear();
+        fTime.clear();
+
+        G4AutoLock lock(&reconstructionMutex);
+        if (gRecoFile.is_open()) gRecoFile << fLines;
+    }
+}
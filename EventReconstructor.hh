@@ -0,0 +1,57 @@
+
+#ifndef G4_BREMS_EVENT_RECONSTRUCTOR_H
+#define G4_BREMS_EVENT_RECONSTRUCTOR_H 1
+
+#include "VertexFit.hh"
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <string>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Configured on the master by ReconstructionMessenger between runs
+    struct ReconstructionParameters {
+        G4bool enabled = false;
+        VertexSettings fit;
+    };
+
+    // Per-thread reconstruction, owned by RunAction: the SiPM hits of each triggered event become
+    // per-channel charges (photoelectrons) and times (earliest hit), fitted by VertexFitter once
+    // VertexFitter::kBatch events are queued and at end of run. The channel positions are read
+    // from the SiPM placements at begin of run, so imported geometries are fitted as built.
+    //
+    // Output, reco_run<N>.csv, in completion order:
+    //   event,x_mm,y_mm,z_mm,energy_MeV,time_ns,vertex_fraction,gamma_clusters
+    class EventReconstructor
+    {
+    public:
+        EventReconstructor() = default;
+        ~EventReconstructor() = default;
+
+        static ReconstructionParameters& Parameters() { return fParameters; }
+        static G4bool IsEnabled() { return fParameters.enabled; }
+
+        // Master: opens and closes the run's output file
+        static void OpenOutput(const G4String& path);
+        static void CloseOutput();
+
+        void BeginOfRun();
+        void AddEvent(G4int eventID, const std::vector<SipmHit>& hits);
+        // Fits and writes the queued events; called by every thread at end of run
+        void Flush();
+
+    private:
+        static ReconstructionParameters fParameters;
+
+        G4bool fConfigured = false;
+        VertexFitter fFitter;
+        VertexResults fResults;
+        std::vector<G4int> fEventIDs;
+        std::vector<float> fCharge;      // [event][channel]
+        std::vector<float> fTime;        // [event][channel]
+        std::string fLines;
+    };
+}
+
+#endif
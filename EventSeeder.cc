@@ -0,0 +1,35 @@
+
+#include "EventSeeder.hh"
+#include "Randomize.hh"
+
+namespace G4_BREMS {
+
+    G4long EventSeeder::fMasterSeed = 12345;
+    G4long EventSeeder::fEventOffset = 0;
+
+    std::uint64_t EventSeeder::Mix(std::uint64_t x)
+    {
+        // SplitMix64 finaliser
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    void EventSeeder::SeedEvent(G4int runID, G4int eventID)
+    {
+        std::uint64_t key = Mix(static_cast<std::uint64_t>(fMasterSeed));
+        key = Mix(key ^ static_cast<std::uint64_t>(runID));
+        key = Mix(key ^ static_cast<std::uint64_t>(fEventOffset + eventID));
+
+        // Four positive 31-bit words; MixMax maps them onto a unique stream,
+        // other engines simply take them as seeds
+        long seeds[5];
+        for (G4int i = 0; i < 4; i++) {
+            key = Mix(key);
+            seeds[i] = static_cast<long>(key & 0x7FFFFFFFULL) | 1L;
+        }
+        seeds[4] = 0;
+        G4Random::setTheSeeds(seeds, 4);
+    }
+}
@@ -0,0 +1,34 @@
+
+#ifndef G4_BREMS_EVENT_SEEDER_H
+#define G4_BREMS_EVENT_SEEDER_H 1
+
+#include "globals.hh"
+#include <cstdint>
+
+namespace G4_BREMS {
+
+    // Counter-based event seeding: the engine is reseeded at the start of every event with
+    // seeds derived only from (master seed, run id, event id). Results therefore do not depend
+    // on the number of threads or on which worker happens to process which event.
+    class EventSeeder
+    {
+    public:
+        static void SetMasterSeed(G4long seed) { fMasterSeed = seed; }
+        static G4long GetMasterSeed() { return fMasterSeed; }
+
+        // Added to the local event id, so sharded jobs draw from disjoint streams
+        static void SetEventOffset(G4long offset) { fEventOffset = offset; }
+        static G4long GetEventOffset() { return fEventOffset; }
+
+        static void SeedEvent(G4int runID, G4int eventID);
+
+        // Exposed for generators that need their own per-event streams
+        static std::uint64_t Mix(std::uint64_t x);
+
+    private:
+        static G4long fMasterSeed;
+        static G4long fEventOffset;
+    };
+}
+
+#endif
@@ -0,0 +1,101 @@
+
+#include "ForkRunner.hh"
+#include "EventSeeder.hh"
+#include "OutputPaths.hh"
+#include "PhysicsList.hh"
+#include "RunAction.hh"
+#include "ShardMerger.hh"
+#include "G4RunManager.hh"
+#include "G4RunManagerKernel.hh"
+#include "G4UImanager.hh"
+#include "G4UIcommandStatus.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace G4_BREMS {
+
+#ifndef _WIN32
+    G4bool ForkRunner::BeamOn(G4int events) const
+    {
+        auto runManager = G4RunManager::GetRunManager();
+        auto UImanager = G4UImanager::GetUIpointer();
+
+        // Close the geometry and build the physics tables without running the user run action
+        UImanager->ApplyCommand("/run/beamOn 0");
+
+        // Store the table cache once here rather than from every child's run action
+        auto physicsList = dynamic_cast<PhysicsList*>(G4RunManagerKernel::GetRunManagerKernel()->GetPhysicsList());
+        if (physicsList) {
+            physicsList->StoreTableCache();
+        }
+
+        // Workers all run "run 0" so the parent knows which csv files to merge
+        runManager->SetRunIDCounter(0);
+
+        const G4String mergedStem = OutputPaths::Stem();
+        const G4String shardPrefix = mergedStem.empty() ? G4String("G4_Brems") : mergedStem;
+        const G4long baseOffset = EventSeeder::GetEventOffset();
+
+        std::cout.flush();
+        std::cerr.flush();
+
+        std::vector<pid_t> children;
+        std::vector<G4String> shardStems;
+        G4long firstEvent = 0;
+        for (G4int i = 0; i < fProcesses; i++) {
+            G4int count = events / fProcesses + ((i < events % fProcesses) ? 1 : 0);
+            shardStems.push_back(OutputPaths::ShardStem(shardPrefix, i));
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                G4cerr << "Error: fork failed for worker process " << i << G4endl;
+                break;
+            }
+            if (pid == 0) {
+                // Worker: own output stem and event slice, then leave without running the
+                // parent's destructors; a failed run or output fails the exit status
+                OutputPaths::SetPrefix(shardPrefix);
+                OutputPaths::SetTag("");
+                OutputPaths::SetShardIndex(i);
+                EventSeeder::SetEventOffset(baseOffset + firstEvent);
+                G4bool succeeded = true;
+                if (count > 0) {
+                    succeeded = UImanager->ApplyCommand("/run/beamOn " + std::to_string(count)) == fCommandSucceeded
+                        && RunAction::OutputsWritten();
+                }
+                std::cout.flush();
+                std::cerr.flush();
+                _exit(succeeded ? 0 : 1);
+            }
+            children.push_back(pid);
+            firstEvent += count;
+        }
+
+        G4bool ok = (static_cast<G4int>(children.size()) == fProcesses);
+        for (auto pid : children) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                G4cerr << "Error: worker process " << pid << " failed" << G4endl;
+                ok = false;
+            }
+        }
+
+        G4cout << "Merging " << children.size() << " worker outputs" << G4endl;
+        shardStems.resize(children.size());
+        ShardMerger merger(shardStems, mergedStem, 0);
+        return merger.Merge() && ok;
+    }
+#else
+    G4bool ForkRunner::BeamOn(G4int) const
+    {
+        G4Exception("ForkRunner::BeamOn()", "Fork_F001", FatalException,
+            "Multi-process mode needs fork() and is not available on Windows");
+        return false;
+    }
+#endif
+}
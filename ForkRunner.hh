@@ -0,0 +1,27 @@
+
+#ifndef G4_BREMS_FORK_RUNNER_H
+#define G4_BREMS_FORK_RUNNER_H 1
+
+#include "globals.hh"
+
+namespace G4_BREMS {
+
+    // Multi-process mode for the sequential run manager. The parent closes the geometry and
+    // builds the physics tables once (/run/beamOn 0), then fork()s worker processes that share
+    // those pages copy-on-write. Worker i runs its own contiguous slice of the event range,
+    // seeded as in one big run, and writes <stem>_job<i> outputs; the parent waits for all
+    // workers and merges the shards with ShardMerger.
+    class ForkRunner
+    {
+    public:
+        explicit ForkRunner(G4int processes) : fProcesses(processes) {}
+        ~ForkRunner() = default;
+
+        G4bool BeamOn(G4int events) const;
+
+    private:
+        G4int fProcesses;
+    };
+}
+
+#endif
@@ -0,0 +1,499 @@
+// G4-Brems-bench.cc : micro-benchmarks of the per-event processing stages.
+//
+//   G4_Brems_bench [--events <n>] [--seed <n>] [--hits <n>] [--threads <n>] [--scratch <dir>]
+//
+// Waveform features: synthetic 128-channel events (baseline, noise, a few SiPM-like pulses per
+// channel) are run through FeatureExtractor and through a straightforward floating-point
+// reference, one sample at a time; the features are compared and the time per event and per
+// channel printed for several trace lengths.
+//
+// Vertex fit: synthetic charge patterns (a vertex lighting its layer and the neighbours, and
+// sometimes annihilation-gamma clusters elsewhere) are fitted by VertexFitter in full batches
+// and one event per call; the throughput in events/s and the rms of the fitted positions are
+// printed. The patterns come from the fitter's own light-sharing model, so the rms is a
+// self-consistency check, not a resolution.
+//
+// SiPM hits csv: synthetic runs of 10^6 hits up to --hits (by powers of ten) are written by
+// SipmHitsWriter, with the time of each stage. Up to 10^7 hits the csv is also written the way
+// RunAction did before, grouping copies of the hits in a std::map, and the two files compared.
+// The hits take about 120 bytes each in memory and the csv about as much on disk.
+//
+
+#include "WaveformFeatures.hh"
+#include "VertexFit.hh"
+#include "SipmChannel.hh"
+#include "SipmHitsWriter.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace G4_BREMS;
+
+namespace {
+	// Results of timed loops are stored here, so the compiler cannot drop the work
+	volatile G4double benchSink = 0.;
+
+	void PrintBenchUsage(const char* program)
+	{
+		G4cout << "Usage: " << program << " [--events <n>] [--seed <n>] [--hits <n>] [--threads <n>] [--scratch <dir>]\n"
+			<< "  --events <n>     events per measurement (default 2000)\n"
+			<< "  --seed <n>       seed of the synthetic traces (default 12345)\n"
+			<< "  --hits <n>       largest SiPM hit count of the csv benchmark (default 1e7)\n"
+			<< "  --threads <n>    threads of the csv writer (default one per hardware thread)\n"
+			<< "  --scratch <dir>  directory of the benchmark csv files, removed afterwards (default .)" << G4endl;
+	}
+
+	// Channel-major traces like SipmDigitizer writes them
+	std::vector<std::uint16_t> MakeEvent(std::size_t samples, std::mt19937_64& engine)
+	{
+		std::normal_distribution<double> noise(200., 1.);
+		std::uniform_real_distribution<double> start(20., 2. * samples - 100.);
+		std::poisson_distribution<int> pulses(2.);
+		std::vector<std::uint16_t> adc(SipmChannel::kChannels * samples);
+		std::vector<double> trace(samples);
+		for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+			for (auto& value : trace) value = noise(engine);
+			for (G4int pulse = pulses(engine); pulse > 0; pulse--) {
+				double t0 = start(engine);
+				for (std::size_t s = 0; s < samples; s++) {
+					double t = 2. * s - t0;
+					if (t > 0.) trace[s] += 21.5 * (std::exp(-t / 40.) - std::exp(-t));
+				}
+			}
+			for (std::size_t s = 0; s < samples; s++) {
+				adc[channel * samples + s] = static_cast<std::uint16_t>(std::clamp(std::round(trace[s]), 0., 4095.));
+			}
+		}
+		return adc;
+	}
+
+	// Baseline-subtracted samples in floating point, same definitions as FeatureExtractor
+	void ExtractReference(const std::uint16_t* adc, std::size_t channels, std::size_t samples,
+		const FeatureSettings& settings, ChannelFeatures& features)
+	{
+		features.Resize(channels);
+		const std::size_t baselineSamples = std::min<std::size_t>(std::max(settings.baselineSamples, 1), samples);
+		for (std::size_t channel = 0; channel < channels; channel++) {
+			const std::uint16_t* trace = adc + channel * samples;
+			double baseline = 0.;
+			for (std::size_t s = 0; s < baselineSamples; s++) baseline += trace[s];
+			baseline /= baselineSamples;
+
+			double peak = -1.e30, integral = 0., above = 0.;
+			std::size_t peakIndex = 0;
+			for (std::size_t s = baselineSamples; s < samples; s++) {
+				double v = trace[s] - baseline;
+				integral += v;
+				if (v > settings.threshold) above += 1.;
+				if (v > peak) {
+					peak = v;
+					peakIndex = s;
+				}
+			}
+
+			double time = -1.;
+			double level = settings.cfdFraction * peak;
+			if (peak > settings.threshold) {
+				for (std::size_t s = peakIndex; s-- > baselineSamples;) {
+					double v0 = trace[s] - baseline;
+					double v1 = trace[s + 1] - baseline;
+					if (v0 < level && v1 >= level) {
+						time = settings.windowStart + (s + (level - v0) / (v1 - v0)) * settings.samplingPeriod;
+						break;
+					}
+				}
+			}
+
+			features.baseline[channel] = static_cast<float>(baseline);
+			features.time[channel] = static_cast<float>(time);
+			features.charge[channel] = static_cast<float>(integral * settings.samplingPeriod);
+			features.peak[channel] = static_cast<float>(peak);
+			features.timeOverThreshold[channel] = static_cast<float>(above * settings.samplingPeriod);
+		}
+	}
+
+	G4bool Agree(const ChannelFeatures& a, const ChannelFeatures& b)
+	{
+		auto close = [](const std::vector<float>& x, const std::vector<float>& y) {
+			for (std::size_t i = 0; i < x.size(); i++) {
+				if (std::abs(x[i] - y[i]) > 1.e-3f * std::max(1.f, std::abs(y[i]))) return false;
+			}
+			return true;
+		};
+		return close(a.baseline, b.baseline) && close(a.time, b.time) && close(a.charge, b.charge)
+			&& close(a.peak, b.peak) && close(a.timeOverThreshold, b.timeOverThreshold);
+	}
+
+	G4int BenchFeatures(G4int events, std::mt19937_64& engine)
+	{
+		// A pool of distinct events, reused so generation stays out of the timing
+		constexpr G4int kPool = 64;
+		FeatureSettings settings;
+		FeatureExtractor extractor;
+		ChannelFeatures features, reference;
+
+		G4cout << SipmChannel::kChannels << " channels, " << events << " events per measurement" << G4endl;
+		G4cout << std::setw(8) << "samples" << std::setw(14) << "extractor us" << std::setw(14) << "ns/channel"
+			<< std::setw(14) << "reference us" << std::setw(10) << "speedup" << std::setw(8) << "agree" << G4endl;
+
+		G4int status = 0;
+		for (std::size_t samples : { 128, 256, 512, 1024 }) {
+			std::vector<std::vector<std::uint16_t>> pool;
+			for (G4int i = 0; i < kPool; i++) pool.push_back(MakeEvent(samples, engine));
+
+			G4bool agree = true;
+			for (const auto& adc : pool) {
+				extractor.Extract(adc.data(), SipmChannel::kChannels, samples, settings, features);
+				ExtractReference(adc.data(), SipmChannel::kChannels, samples, settings, reference);
+				agree = agree && Agree(features, reference);
+			}
+			if (!agree) status = 1;
+
+			// Sum of a feature keeps the work from being optimised away
+			G4double checksum = 0.;
+			auto time = [&](auto&& extract) {
+				auto start = std::chrono::steady_clock::now();
+				for (G4int event = 0; event < events; event++) {
+					const auto& adc = pool[event % kPool];
+					extract(adc.data());
+					checksum += features.charge[event % SipmChannel::kChannels];
+				}
+				std::chrono::duration<G4double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+				return elapsed.count() / events;
+			};
+			G4double extracted = time([&](const std::uint16_t* adc) {
+				extractor.Extract(adc, SipmChannel::kChannels, samples, settings, features);
+			});
+			G4double scalar = time([&](const std::uint16_t* adc) {
+				ExtractReference(adc, SipmChannel::kChannels, samples, settings, features);
+			});
+
+			G4cout << std::setw(8) << samples << std::setw(14) << std::setprecision(3) << extracted
+				<< std::setw(14) << extracted * 1000. / SipmChannel::kChannels << std::setw(14) << scalar
+				<< std::setw(10) << scalar / extracted << std::setw(8) << (agree ? "yes" : "NO") << G4endl;
+			benchSink = checksum;
+		}
+		return status;
+	}
+
+	// Nominal readout: groove positions of DetectorConstruction, layers 5 mm apart
+	VertexGeometry MakeVertexGeometry()
+	{
+		const float grooves[SipmChannel::kGrooves] = { -155.5f, -118.f, -81.5f, -44.5f, 44.5f, 81.5f, 118.f, 155.5f };
+		VertexGeometry geometry;
+		for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+			geometry.coordinate[channel] = grooves[SipmChannel::Groove(channel)];
+			geometry.z[channel] = 5.f * SipmChannel::Layer(channel);
+		}
+		return geometry;
+	}
+
+	struct VertexTruth {
+		G4double x, y, energy;
+		G4int gammas;
+	};
+
+	// Photoelectrons of one event, [channel]; the light of a deposit is shared between the
+	// grooves of a layer with the fitter's own model
+	VertexTruth MakeVertexEvent(const VertexGeometry& geometry, const VertexSettings& settings,
+		std::mt19937_64& engine, float* charge, float* time)
+	{
+		std::uniform_real_distribution<double> uniform(0., 1.);
+		std::exponential_distribution<double> decay(1. / 3.);
+		std::fill(charge, charge + SipmChannel::kChannels, 0.f);
+		std::fill(time, time + SipmChannel::kChannels, 0.f);
+
+		G4double deposited = 0.;
+		auto deposit = [&](G4int layer, G4double x, G4double y, G4double energy) {
+			deposited += energy;
+			G4double u = SipmChannel::IsTopLayer(SipmChannel::Id(layer, 0, 0)) ? y : x;
+			G4double share[SipmChannel::kGrooves], sum = 0.;
+			for (G4int groove = 0; groove < SipmChannel::kGrooves; groove++) {
+				share[groove] = std::exp(-std::abs(u - geometry.coordinate[SipmChannel::Id(layer, groove, 0)]) / settings.shareLength) + 1.e-3;
+				sum += share[groove];
+			}
+			for (G4int groove = 0; groove < SipmChannel::kGrooves; groove++) {
+				std::poisson_distribution<int> photoelectrons(0.5 * energy * settings.lightYield * share[groove] / sum);
+				for (G4int end = 0; end < SipmChannel::kEnds; end++) {
+					G4int channel = SipmChannel::Id(layer, groove, end);
+					G4int n = photoelectrons(engine);
+					if (n == 0) continue;
+					float t = static_cast<float>(1. + decay(engine));
+					time[channel] = charge[channel] > 0.f ? std::min(time[channel], t) : t;
+					charge[channel] += static_cast<float>(n);
+				}
+			}
+		};
+
+		VertexTruth truth{ 300. * uniform(engine) - 150., 300. * uniform(engine) - 150., 0., 0 };
+		G4double energy = 1. + 7. * uniform(engine);
+		G4int vertex = static_cast<G4int>(uniform(engine) * SipmChannel::kLayers);
+		deposit(vertex, truth.x, truth.y, 0.7 * energy);
+		if (vertex > 0) deposit(vertex - 1, truth.x, truth.y, 0.15 * energy);
+		if (vertex + 1 < SipmChannel::kLayers) deposit(vertex + 1, truth.x, truth.y, 0.15 * energy);
+
+		// Annihilation gammas converting in distinct layers at least two away from the vertex
+		G4double roll = uniform(engine);
+		G4int gammas = roll < 0.5 ? 0 : (roll < 0.8 ? 1 : 2);
+		G4int used = -10;
+		for (G4int attempt = 0; attempt < 20 && truth.gammas < gammas; attempt++) {
+			G4int layer = static_cast<G4int>(uniform(engine) * SipmChannel::kLayers);
+			if (std::abs(layer - vertex) < 2 || std::abs(layer - used) < 2) continue;
+			deposit(layer, 300. * uniform(engine) - 150., 300. * uniform(engine) - 150., 0.3);
+			used = layer;
+			truth.gammas++;
+		}
+		truth.energy = deposited;
+		return truth;
+	}
+
+	G4int BenchVertexFit(G4int events, std::mt19937_64& engine)
+	{
+		constexpr std::size_t kPool = 8192;
+		const VertexGeometry geometry = MakeVertexGeometry();
+		const VertexSettings settings;
+		VertexFitter fitter;
+		fitter.Configure(geometry, settings);
+
+		std::vector<float> charge(kPool * SipmChannel::kChannels), time(kPool * SipmChannel::kChannels);
+		std::vector<VertexTruth> truth(kPool);
+		for (std::size_t event = 0; event < kPool; event++) {
+			truth[event] = MakeVertexEvent(geometry, settings, engine, &charge[event * SipmChannel::kChannels],
+				&time[event * SipmChannel::kChannels]);
+		}
+
+		// Whole pool per call, batches of kBatch inside, against one event per call
+		const G4int repeats = std::max(1, events / 200);
+		VertexResults results, single;
+		auto start = std::chrono::steady_clock::now();
+		for (G4int repeat = 0; repeat < repeats; repeat++) fitter.Fit(charge.data(), time.data(), kPool, results);
+		std::chrono::duration<G4double> batched = std::chrono::steady_clock::now() - start;
+
+		G4int status = 0;
+		start = std::chrono::steady_clock::now();
+		for (G4int repeat = 0; repeat < repeats; repeat++) {
+			for (std::size_t event = 0; event < kPool; event++) {
+				fitter.Fit(&charge[event * SipmChannel::kChannels], &time[event * SipmChannel::kChannels], 1, single);
+				if (repeat == 0 && !(single.x[0] == results.x[event] && single.energy[0] == results.energy[event])) status = 1;
+			}
+		}
+		std::chrono::duration<G4double> unbatched = std::chrono::steady_clock::now() - start;
+
+		G4double dx2 = 0., dy2 = 0., energyBias = 0.;
+		G4int clustersRight = 0;
+		for (std::size_t event = 0; event < kPool; event++) {
+			dx2 += sqr(results.x[event] - truth[event].x);
+			dy2 += sqr(results.y[event] - truth[event].y);
+			energyBias += results.energy[event] / truth[event].energy - 1.;
+			if (static_cast<G4int>(results.gammaClusters[event]) == truth[event].gammas) clustersRight++;
+		}
+
+		const G4double fitted = static_cast<G4double>(repeats) * kPool;
+		G4cout << "Vertex fit, " << fitted << " events, batches of " << VertexFitter::kBatch << G4endl;
+		G4cout << std::setw(22) << "batched events/s" << std::setw(22) << "one per call events/s"
+			<< std::setw(10) << "x rms mm" << std::setw(10) << "y rms mm" << std::setw(13) << "energy bias"
+			<< std::setw(14) << "gammas right" << std::setw(8) << "agree" << G4endl;
+		G4cout << std::setprecision(3) << std::setw(22) << fitted / batched.count() << std::setw(22) << fitted / unbatched.count()
+			<< std::setw(10) << std::sqrt(dx2 / kPool) << std::setw(10) << std::sqrt(dy2 / kPool)
+			<< std::setw(13) << energyBias / kPool << std::setw(13) << 100. * clustersRight / kPool << "%"
+			<< std::setw(8) << (status == 0 ? "yes" : "NO") << G4endl;
+		return status;
+	}
+
+	// A run's worth of hits: events of a few hundred photons on the channels of a track,
+	// arrival times over a few microseconds, and a few hits on unknown channels
+	std::vector<SipmHit> MakeHits(std::size_t count, std::mt19937_64& engine)
+	{
+		std::vector<G4String> names;
+		for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) names.push_back(SipmChannel::Name(channel));
+		std::uniform_real_distribution<double> uniform(0., 1.);
+		std::exponential_distribution<double> decay(1. / 8.);
+		std::uniform_int_distribution<G4int> channels(0, SipmChannel::kChannels - 1);
+
+		std::vector<SipmHit> hits(count);
+		G4int channel = 0;
+		G4double start = 0.;
+		for (std::size_t i = 0; i < count; i++) {
+			if (i % 400 == 0) start = 4000. * uniform(engine);
+			if (i % 25 == 0) channel = channels(engine);
+			SipmHit& hit = hits[i];
+			const G4bool unknown = uniform(engine) < 1.e-4;
+			hit.sipmID = unknown ? -1 : channel;
+			hit.sipmName = unknown ? G4String("SiPM_Unknown") : names[channel];
+			hit.time = (start + decay(engine)) * ns;
+			hit.position.set(300. * uniform(engine) - 150., 300. * uniform(engine) - 150., 40. * uniform(engine));
+			hit.energy = (2.2 + 0.4 * uniform(engine)) * eV;
+			hit.wavelength = 1239.84 / (hit.energy / eV);
+			hit.provenance.history = engine() & ((std::uint64_t(1) << 45) - 1);
+			hit.provenance.tilePath = static_cast<float>(500. * uniform(engine));
+			hit.provenance.cladPath = static_cast<float>(50. * uniform(engine));
+			hit.provenance.corePath = static_cast<float>(1000. * uniform(engine));
+		}
+		return hits;
+	}
+
+	// The end-of-run csv as RunAction wrote it before SipmHitsWriter
+	G4bool WriteHitsReference(const std::vector<SipmHit>& allHits, const G4String& filename)
+	{
+		std::ofstream outFile(filename);
+		if (!outFile.is_open()) return false;
+		outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm),TimeBin(ns),PhotonsInBin,"
+			<< "History,TilePath(mm),CladPath(mm),CorePath(mm)" << std::endl;
+
+		std::map<G4String, std::vector<SipmHit>> hitsBySipm;
+		for (const auto& hit : allHits) {
+			hitsBySipm[hit.sipmName].push_back(hit);
+		}
+		for (auto& sipmPair : hitsBySipm) {
+			auto& hits = sipmPair.second;
+			std::sort(hits.begin(), hits.end(),
+				[](const SipmHit& a, const SipmHit& b) {
+					if (a.time != b.time) return a.time < b.time;
+					if (a.energy != b.energy) return a.energy < b.energy;
+					if (a.position.x() != b.position.x()) return a.position.x() < b.position.x();
+					if (a.position.y() != b.position.y()) return a.position.y() < b.position.y();
+					return a.position.z() < b.position.z();
+				});
+			const G4double binSize = 100.0 * ns;
+			std::map<G4int, G4int> binCounts;
+			for (const auto& hit : hits) {
+				binCounts[static_cast<G4int>(hit.time / binSize)]++;
+			}
+			for (const auto& hit : hits) {
+				G4int binIndex = static_cast<G4int>(hit.time / binSize);
+				G4double binStart = binIndex * binSize;
+				G4double binEnd = (binIndex + 1) * binSize;
+				outFile << hit.sipmName << ","
+					<< hit.time / ns << ","
+					<< hit.position.x() / mm << ","
+					<< hit.position.y() / mm << ","
+					<< hit.position.z() / mm << ","
+					<< hit.energy / eV << ","
+					<< hit.wavelength << ","
+					<< binStart / ns << "-" << binEnd / ns << ","
+					<< binCounts[binIndex] << ","
+					<< hit.provenance.history << ","
+					<< hit.provenance.tilePath << ","
+					<< hit.provenance.cladPath << ","
+					<< hit.provenance.corePath << std::endl;
+			}
+		}
+		return outFile.good();
+	}
+
+	// FNV-1a of a file, 0 when it cannot be read
+	std::uint64_t HashFile(const G4String& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in.is_open()) return 0;
+		std::uint64_t hash = 14695981039346656037ull;
+		std::vector<char> buffer(1 << 20);
+		while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+			for (std::streamsize i = 0; i < in.gcount(); i++) {
+				hash = (hash ^ static_cast<unsigned char>(buffer[i])) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	G4int BenchHitsWriter(std::size_t maxHits, unsigned threads, const G4String& scratch, std::mt19937_64& engine)
+	{
+		constexpr std::size_t kReferenceHits = 10000000;
+		const G4String path = scratch + "/bench_sipm_hits.csv";
+		const G4String referencePath = scratch + "/bench_sipm_hits_reference.csv";
+		SipmHitsWriter writer(threads);
+
+		G4cout << "SiPM hits csv, " << writer.GetThreads() << " threads" << G4endl;
+		G4cout << std::setw(12) << "hits" << std::setw(13) << "partition s" << std::setw(9) << "sort s"
+			<< std::setw(11) << "format s" << std::setw(10) << "total s" << std::setw(12) << "Mhits/s"
+			<< std::setw(14) << "reference s" << std::setw(10) << "speedup" << std::setw(8) << "agree" << G4endl;
+
+		G4int status = 0;
+		std::vector<std::size_t> sizes;
+		for (std::size_t size = 1000000; size <= maxHits; size *= 10) sizes.push_back(size);
+		if (sizes.empty()) sizes.push_back(maxHits);
+		for (std::size_t size : sizes) {
+			std::vector<SipmHit> hits = MakeHits(size, engine);
+
+			auto start = std::chrono::steady_clock::now();
+			if (!writer.Write(hits, path)) return 1;
+			const G4double total = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+			const auto& times = writer.GetStageTimes();
+			G4cout << std::setprecision(3) << std::setw(12) << static_cast<G4double>(size)
+				<< std::setw(13) << times.partition << std::setw(9) << times.sort << std::setw(11) << times.format
+				<< std::setw(10) << total << std::setw(12) << size * 1.e-6 / total;
+
+			if (size <= kReferenceHits) {
+				start = std::chrono::steady_clock::now();
+				G4bool written = WriteHitsReference(hits, referencePath);
+				const G4double reference = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+				const G4bool agree = written && HashFile(path) == HashFile(referencePath);
+				if (!agree) status = 1;
+				G4cout << std::setw(14) << reference << std::setw(10) << reference / total << std::setw(8) << (agree ? "yes" : "NO");
+				std::remove(referencePath.c_str());
+			}
+			G4cout << G4endl;
+			std::remove(path.c_str());
+		}
+		return status;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	G4int events = 2000;
+	unsigned long seed = 12345;
+	std::size_t maxHits = 10000000;
+	unsigned threads = 0;
+	G4String scratch = ".";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		G4bool hasValue = (i + 1 < argc);
+		if (arg == "--help" || arg == "-h") {
+			PrintBenchUsage(argv[0]);
+			return 0;
+		}
+		else if (arg == "--events" && hasValue) {
+			events = std::atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && hasValue) {
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--hits" && hasValue) {
+			maxHits = static_cast<std::size_t>(std::atof(argv[++i]));
+		}
+		else if (arg == "--threads" && hasValue) {
+			threads = static_cast<unsigned>(std::atoi(argv[++i]));
+		}
+		else if (arg == "--scratch" && hasValue) {
+			scratch = argv[++i];
+		}
+		else {
+			G4cerr << "Error: unknown argument '" << arg << "'" << G4endl;
+			PrintBenchUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (events <= 0 || maxHits == 0) {
+		G4cerr << "Error: --events and --hits must be positive" << G4endl;
+		return 1;
+	}
+
+	std::mt19937_64 engine(seed);
+	G4int status = BenchFeatures(events, engine);
+	G4cout << G4endl;
+	status |= BenchVertexFit(events, engine);
+	G4cout << G4endl;
+	status |= BenchHitsWriter(maxHits, threads, scratch, engine);
+	return status;
+}
@@ -0,0 +1,102 @@
+// G4-Brems-merge.cc : merges the outputs of sharded G4_Brems jobs.
+//
+//   G4_Brems_merge --output <stem> [--run <n>] <shard stem> [<shard stem> ...]
+//   G4_Brems_merge --output <stem> [--run <n>] --prefix <prefix> --job-count <n>
+//
+
+#include "ShardMerger.hh"
+#include "OutputPaths.hh"
+
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace G4_BREMS;
+
+namespace {
+	void PrintMergeUsage(const char* program)
+	{
+		G4cout << "Usage: " << program << " --output <stem> [--run <n>] <shard stem>...\n"
+			<< "       " << program << " --output <stem> [--run <n>] --prefix <prefix> --job-count <n>\n"
+			<< "  --output <stem>     stem of the merged files (as given to G4_Brems --output)\n"
+			<< "  --run <n>           run id of the csv files to merge (default 0)\n"
+			<< "  --prefix <prefix>   shard stems are <prefix>_job0 ... <prefix>_job<n-1>\n"
+			<< "  --job-count <n>     number of shards written with --prefix" << G4endl;
+	}
+
+	// Same rules as the G4_Brems options: a whole non-negative number that fits a G4int
+	G4bool ToInt(const std::string& name, const std::string& value, G4int& result)
+	{
+		char* end = nullptr;
+		const long number = std::strtol(value.c_str(), &end, 10);
+		if (value.empty() || *end != '\0' || number < 0 || number > std::numeric_limits<G4int>::max()) {
+			G4cerr << "Error: option " << name << " expects a non-negative integer, got '"
+				<< value << "'" << G4endl;
+			return false;
+		}
+		result = static_cast<G4int>(number);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	G4String output;
+	G4String prefix;
+	G4int run = 0;
+	G4int jobCount = 0;
+	std::vector<G4String> shards;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		G4bool hasValue = (i + 1 < argc);
+		if (arg == "--help" || arg == "-h") {
+			PrintMergeUsage(argv[0]);
+			return 0;
+		}
+		else if (arg == "--output" && hasValue) {
+			output = argv[++i];
+		}
+		else if (arg == "--prefix" && hasValue) {
+			prefix = argv[++i];
+		}
+		else if (arg == "--run" && hasValue) {
+			if (!ToInt("--run", argv[++i], run)) {
+				PrintMergeUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (arg == "--job-count" && hasValue) {
+			if (!ToInt("--job-count", argv[++i], jobCount)) {
+				PrintMergeUsage(argv[0]);
+				return 1;
+			}
+			if (jobCount == 0) {
+				G4cerr << "Error: option --job-count expects at least one shard" << G4endl;
+				PrintMergeUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (arg.rfind("-", 0) != 0) {
+			shards.push_back(arg);
+		}
+		else {
+			G4cerr << "Error: unknown argument '" << arg << "'" << G4endl;
+			PrintMergeUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	for (G4int i = 0; i < jobCount; i++) {
+		shards.push_back(OutputPaths::ShardStem(prefix.empty() ? G4String("G4_Brems") : prefix, i));
+	}
+
+	if (output.empty() || shards.empty()) {
+		PrintMergeUsage(argv[0]);
+		return 1;
+	}
+
+	ShardMerger merger(shards, output, run);
+	return merger.Merge() ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// G4-Brems-mix.cc : overlays recorded hit libraries on a continuous time-line.
+//
+//   G4_Brems_mix --source <name>:<library>:<rate Hz> [--source ...] [--dark-rate <Hz>]
+//                --duration <s> [--seed <n>] [--slice <ns>] --output <csv>
+//
+// Every source is a Poisson process of events drawn at random from its library (written by
+// /snf/bkg/record). The time-line is built in slices: events starting in a slice are expanded
+// into hits, sorted together with the hits still pending from earlier slices, and the hits
+// before the end of the slice are written, so memory stays bounded by one slice plus the
+// longest recorded event however long the time-line is.
+//
+
+#include "HitLibrary.hh"
+#include "SipmChannel.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace G4_BREMS;
+
+namespace {
+	struct MixSource {
+		G4String name;
+		G4double rate = 0.;          // Hz
+		HitLibrary library;
+		G4double next = 0.;          // ns, next event start
+		G4long events = 0;
+		G4long hits = 0;
+	};
+
+	struct TimelineHit {
+		G4double time;               // ns
+		G4int channel;
+		G4int source;                // index into the sources, -1 for dark counts
+		G4int event;                 // library event, -1 for dark counts
+	};
+
+	void PrintMixUsage(const char* program)
+	{
+		G4cout << "Usage: " << program << " --source <name>:<library>:<rate> [--source ...] --duration <s> --output <csv>\n"
+			<< "  --source <n>:<f>:<r>  library <f> (from /snf/bkg/record) overlaid at <r> events/s as source <n>\n"
+			<< "  --dark-rate <Hz>      dark count rate per channel (default 0)\n"
+			<< "  --duration <s>        length of the time-line\n"
+			<< "  --seed <n>            random seed (default 1)\n"
+			<< "  --slice <ns>          time-line slice processed at once (default 1e6)\n"
+			<< "  --output <csv>        time_ns,channel,source,event per hit, in time order" << G4endl;
+	}
+
+	// name:library:rate; the library path may itself contain ':'
+	G4bool ParseSource(const std::string& spec, MixSource& source, G4String& path)
+	{
+		const std::size_t first = spec.find(':');
+		const std::size_t last = spec.rfind(':');
+		if (first == std::string::npos || first == last) return false;
+		source.name = spec.substr(0, first);
+		path = spec.substr(first + 1, last - first - 1);
+		source.rate = std::atof(spec.c_str() + last + 1);
+		return !source.name.empty() && !path.empty() && source.rate > 0.;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::unique_ptr<MixSource>> sources;
+	G4String output;
+	G4double darkRate = 0.;
+	G4double duration = 0.;
+	G4double slice = 1e6;
+	unsigned long long seed = 1;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		G4bool hasValue = (i + 1 < argc);
+		if (arg == "--help" || arg == "-h") {
+			PrintMixUsage(argv[0]);
+			return 0;
+		}
+		else if (arg == "--source" && hasValue) {
+			auto source = std::make_unique<MixSource>();
+			G4String path;
+			if (!ParseSource(argv[++i], *source, path)) {
+				G4cerr << "Error: --source expects <name>:<library>:<rate>, got '" << argv[i] << "'" << G4endl;
+				return 1;
+			}
+			if (!source->library.Load(path)) return 1;
+			if (source->library.GetEventCount() == 0) {
+				G4cerr << "Error: " << path << " holds no events" << G4endl;
+				return 1;
+			}
+			sources.push_back(std::move(source));
+		}
+		else if (arg == "--dark-rate" && hasValue) {
+			darkRate = std::atof(argv[++i]);
+		}
+		else if (arg == "--duration" && hasValue) {
+			duration = std::atof(argv[++i]) * 1e9;
+		}
+		else if (arg == "--seed" && hasValue) {
+			seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--slice" && hasValue) {
+			slice = std::atof(argv[++i]);
+		}
+		else if (arg == "--output" && hasValue) {
+			output = argv[++i];
+		}
+		else {
+			G4cerr << "Error: unknown argument '" << arg << "'" << G4endl;
+			PrintMixUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (output.empty() || duration <= 0. || slice <= 0. || (sources.empty() && darkRate <= 0.)) {
+		PrintMixUsage(argv[0]);
+		return 1;
+	}
+
+	std::ofstream out(output);
+	if (!out.is_open()) {
+		G4cerr << "Error: Could not open " << output << G4endl;
+		return 1;
+	}
+	out << "time_ns,channel,source,event\n" << std::fixed << std::setprecision(3);
+
+	std::mt19937_64 engine(seed);
+	std::uniform_real_distribution<G4double> uniform(0., 1.);
+	// Exponential gap in ns for a rate in Hz
+	auto gap = [&](G4double rate) { return -std::log(1. - uniform(engine)) * 1e9 / rate; };
+
+	for (auto& source : sources) source->next = gap(source->rate);
+	const G4double darkTotal = darkRate * SipmChannel::kChannels;
+	G4double nextDark = darkTotal > 0. ? gap(darkTotal) : duration;
+	G4long darkHits = 0;
+
+	auto byTime = [](const TimelineHit& a, const TimelineHit& b) { return a.time < b.time; };
+	std::vector<TimelineHit> pending;
+	G4long written = 0;
+	for (G4double start = 0.; start < duration; start += slice) {
+		const G4double end = std::min(start + slice, duration);
+		const std::ptrdiff_t carried = pending.size();
+
+		for (std::size_t s = 0; s < sources.size(); s++) {
+			MixSource& source = *sources[s];
+			std::uniform_int_distribution<std::size_t> pick(0, source.library.GetEventCount() - 1);
+			for (; source.next < end; source.next += gap(source.rate)) {
+				const std::size_t event = pick(engine);
+				auto [first, last] = source.library.GetEvent(event);
+				for (auto hit = first; hit != last; ++hit) {
+					pending.push_back({ source.next + hit->time, hit->channel, G4int(s), G4int(event) });
+				}
+				source.events++;
+				source.hits += last - first;
+			}
+		}
+		std::uniform_int_distribution<G4int> channel(0, SipmChannel::kChannels - 1);
+		for (; nextDark < end; nextDark += gap(darkTotal)) {
+			pending.push_back({ nextDark, channel(engine), -1, -1 });
+			darkHits++;
+		}
+
+		// The carried hits are sorted already. Hits of later slices all start at or after their
+		// end, so everything before this end is final.
+		std::sort(pending.begin() + carried, pending.end(), byTime);
+		std::inplace_merge(pending.begin(), pending.begin() + carried, pending.end(), byTime);
+		auto done = std::lower_bound(pending.begin(), pending.end(), TimelineHit{ end, 0, 0, 0 }, byTime);
+		// Hits of the last events that fall past the time-line are dropped
+		if (end >= duration) done = pending.end();
+		for (auto hit = pending.begin(); hit != done; ++hit) {
+			if (hit->time >= duration) break;
+			out << hit->time << ',' << hit->channel << ','
+				<< (hit->source < 0 ? G4String("dark") : sources[hit->source]->name) << ',' << hit->event << '\n';
+			written++;
+		}
+		pending.erase(pending.begin(), done);
+	}
+
+	G4cout << "Mixed " << duration * 1e-9 << " s into " << output << " (" << written << " hits)" << G4endl;
+	for (const auto& source : sources) {
+		G4cout << "  " << source->name << ": " << source->events << " events, " << source->hits
+			<< " hits from " << source->library.GetPath() << G4endl;
+	}
+	if (darkTotal > 0.) G4cout << "  dark: " << darkHits << " hits" << G4endl;
+	return 0;
+}
@@ -0,0 +1,208 @@
+// G4-Brems-replay.cc : reruns the optical photon analysis on recorded step tapes.
+//
+//   G4_Brems_replay --output <stem> [--run <n>] <tape> [<tape> ...]
+//
+// Tapes are written by /snf/tape/enable (steps_run<N>.tape). Every step goes through the same
+// StepAnalysis as during tracking, so changed histogram binning or selection logic only needs
+// a rebuild and a replay instead of a new simulation. Writes the histograms of
+// OpticalPhotonAnalysis1.root and the stepping counters of summary_run<N>.csv under <stem>.
+//
+
+#include "StepAnalysis.hh"
+#include "StepTape.hh"
+#include "OutputPaths.hh"
+#include "SteppingAction.hh"
+
+#include "G4AnalysisManager.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace G4_BREMS;
+
+namespace {
+	// The RunAction counters, as plain integers
+	class ReplaySink : public StepSink
+	{
+	public:
+		void CountVolume(std::uint8_t volume) override { fVolumes[volume]++; }
+		void CountProcess(std::uint8_t volume, std::uint8_t process, G4bool isCreationProcess) override
+		{
+			(isCreationProcess ? fCreation : fInteraction)[volume][process]++;
+		}
+		void CountEnteredFiber() override { fEntered++; }
+		void CountAbsorbedFiber() override { fAbsorbed++; }
+		void AddSipmHit(SipmHit&, const StepRecord&) override { fHits++; }
+		void FillH1(G4int id, G4double value) override { fAnalysis->FillH1(id, value); }
+		void FillH2(G4int id, G4double x, G4double y, G4double weight) override { fAnalysis->FillH2(id, x, y, weight); }
+
+		void SetAnalysisManager(G4AnalysisManager* analysis) { fAnalysis = analysis; }
+		void WriteSummary(const G4String& path, long long events) const;
+
+	private:
+		using Counts = std::array<std::array<long long, StepCode::kProcesses>, StepCode::kVolumes>;
+
+		G4AnalysisManager* fAnalysis = nullptr;
+		std::array<long long, StepCode::kVolumes> fVolumes{};
+		Counts fCreation{};
+		Counts fInteraction{};
+		long long fEntered = 0;
+		long long fAbsorbed = 0;
+		long long fHits = 0;
+	};
+
+	void ReplaySink::WriteSummary(const G4String& path, long long events) const
+	{
+		std::ofstream outFile(path);
+		if (!outFile.is_open()) {
+			G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+			return;
+		}
+
+		// Same keys and order as RunAction::WriteSummary, for the counters a tape holds
+		long long other = 0;
+		for (std::uint8_t volume = StepCode::kWorld; volume < StepCode::kVolumes; volume++) other += fVolumes[volume];
+		outFile << "Key,Value" << std::endl;
+		outFile << "Events," << events << std::endl;
+		outFile << "SipmHits," << fHits << std::endl;
+		outFile << "TileCount," << fVolumes[StepCode::kTile] << std::endl;
+		outFile << "CladCount," << fVolumes[StepCode::kFiberClad] << std::endl;
+		outFile << "CoreCount," << fVolumes[StepCode::kFiberCore] << std::endl;
+		outFile << "SipmCount," << fVolumes[StepCode::kSipm] << std::endl;
+		outFile << "OtherCount," << other << std::endl;
+		outFile << "PhotonsEnteredFiber," << fEntered << std::endl;
+		outFile << "PhotonsExitedFiber," << 0 << std::endl;
+		outFile << "PhotonsAbsorbedFiber," << fAbsorbed << std::endl;
+
+		const std::uint8_t volumes[] = { StepCode::kTile, StepCode::kFiberCore, StepCode::kFiberClad, StepCode::kSipm };
+		const std::uint8_t creations[] = { StepCode::kCerenkov, StepCode::kScintillation, StepCode::kOpWLS };
+		const std::uint8_t interactions[] = { StepCode::kOpAbsorption, StepCode::kOpWLS, StepCode::kTransportation };
+		std::map<std::string, long long> creationCounts;
+		std::map<std::string, long long> interactionCounts;
+		for (auto volume : volumes) {
+			const std::string prefix = StepCode::VolumeName(volume);
+			for (auto process : creations) {
+				creationCounts[prefix + "_Creation_" + StepCode::ProcessName(process)] = fCreation[volume][process];
+			}
+			for (auto process : interactions) {
+				interactionCounts[prefix + "_Interaction_" + StepCode::ProcessName(process)] = fInteraction[volume][process];
+			}
+		}
+		for (const auto& pair : creationCounts) outFile << pair.first << "," << pair.second << std::endl;
+		for (const auto& pair : interactionCounts) outFile << pair.first << "," << pair.second << std::endl;
+
+		G4double trappingEfficiency = (fEntered > 0) ? static_cast<G4double>(fAbsorbed) / fEntered : 0.0;
+		outFile << "TrappingEfficiency," << trappingEfficiency << std::endl;
+	}
+
+	void PrintReplayUsage(const char* program)
+	{
+		G4cout << "Usage: " << program << " --output <stem> [--run <n>] <tape>...\n"
+			<< "  --output <stem>     stem of the histogram and summary files (as given to G4_Brems --output)\n"
+			<< "  --run <n>           run id of the summary csv (default 0)\n"
+			<< "  <tape>              steps_run<N>.tape files; several tapes (shards) are summed" << G4endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	G4String output;
+	G4int run = 0;
+	std::vector<G4String> tapes;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		G4bool hasValue = (i + 1 < argc);
+		if (arg == "--help" || arg == "-h") {
+			PrintReplayUsage(argv[0]);
+			return 0;
+		}
+		else if (arg == "--output" && hasValue) {
+			output = argv[++i];
+		}
+		else if (arg == "--run" && hasValue) {
+			run = std::atoi(argv[++i]);
+		}
+		else if (arg.rfind("-", 0) != 0) {
+			tapes.push_back(arg);
+		}
+		else {
+			G4cerr << "Error: unknown argument '" << arg << "'" << G4endl;
+			PrintReplayUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (output.empty() || tapes.empty()) {
+		PrintReplayUsage(argv[0]);
+		return 1;
+	}
+
+	auto analysisManager = G4AnalysisManager::Instance();
+	analysisManager->SetVerboseLevel(0);
+	analysisManager->SetDefaultFileType("root");
+	analysisManager->SetFileName(OutputPaths::AnalysisFileName(output));
+	StepAnalysis::BookHistograms();
+	if (!analysisManager->OpenFile()) {
+		G4cerr << "Error: Could not open " << analysisManager->GetFileName() << G4endl;
+		return 1;
+	}
+
+	ReplaySink sink;
+	sink.SetAnalysisManager(analysisManager);
+	StepTape block;
+	StepRecord step{};
+	TrackSummary track;
+	long long events = 0;
+	long long steps = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const auto& tape : tapes) {
+		std::ifstream in(tape, std::ios::binary);
+		if (!in.is_open() || !StepTape::ReadHeader(in)) {
+			G4cerr << "Error: " << tape << " is not a step tape" << G4endl;
+			return 1;
+		}
+		// Every shard numbers its events from 0, so distinct events are counted per tape
+		std::unordered_set<G4int> tapeEvents;
+		while (block.ReadBlock(in)) {
+			// The steps of a photon are consecutive and never split over blocks
+			for (std::size_t i = 0; i < block.size(); i++) {
+				const G4int event = step.event;
+				const G4int trackID = step.track;
+				block.Get(i, step);
+				if (i > 0 && (step.event != event || step.track != trackID)) {
+					StepAnalysis::EndTrack(track, sink);
+					track = TrackSummary();
+				}
+				tapeEvents.insert(step.event);
+				StepAnalysis::Analyze(step, track, sink);
+			}
+			StepAnalysis::EndTrack(track, sink);
+			track = TrackSummary();
+			steps += block.size();
+		}
+		if (in.bad()) {
+			G4cerr << "Error: " << tape << " ends inside a block" << G4endl;
+			return 1;
+		}
+		events += static_cast<long long>(tapeEvents.size());
+	}
+	G4double seconds = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+
+	analysisManager->Write();
+	analysisManager->CloseFile();
+	// Events without any optical photon step leave no trace on the tape
+	sink.WriteSummary(OutputPaths::SummaryCsvName(output, run), events);
+
+	G4cout << "Replayed " << steps << " steps of " << events << " events from " << tapes.size()
+		<< " tapes in " << seconds << " s";
+	if (seconds > 0.) G4cout << " (" << steps / seconds << " steps/s)";
+	G4cout << G4endl;
+	return 0;
+}
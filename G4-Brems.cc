@@ -4,6 +4,11 @@
 #include "G4UImanager.hh"
 #include "G4UIExecutive.hh"
 #include "G4RunManagerFactory.hh"
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= 1120
+#include "G4SubEvtRunManager.hh"
+#endif
+#include "G4StateManager.hh"
 #include "G4VisExecutive.hh"
 #include "G4SteppingVerbose.hh"
 
@@ -11,6 +16,11 @@
 #include "PhysicsList.hh"
 
 #include "ActionInit.hh"
+#include "StackingAction.hh"
+#include "CommandLine.hh"
+#include "EventSeeder.hh"
+#include "ForkRunner.hh"
+#include "OutputPaths.hh"
 
 using namespace G4_BREMS;
 
@@ -20,12 +30,29 @@ using namespace std;
 
 int main(int argc, char** argv)
 {
+	CommandLineOptions options;
+	if (!ParseCommandLine(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	if (options.help) {
+		PrintUsage(argv[0]);
+		return 0;
+	}
+
 	// Initialize (or don't) a UI
 	G4UIExecutive* ui = nullptr;
-	if (argc == 1) {
+	if (options.IsInteractive()) {
 		ui = new G4UIExecutive(argc, argv);
 	}
 
+	if (!options.output.empty()) {
+		OutputPaths::SetPrefix(options.output);
+	}
+	if (options.IsShard()) {
+		OutputPaths::SetShardIndex(options.jobIndex);
+	}
+
 	// ======================================================================
 	// RunManager, + 3 Required additions:
 	// PrimaryGeneratorAction,
@@ -33,43 +60,113 @@ int main(int argc, char** argv)
 	// DetectorConstruction.
 	// ======================================================================
 	
-	// create default runmanager
+	// create the requested runmanager (Default honours G4RUN_MANAGER_TYPE)
+	G4RunManagerType runManagerType = G4RunManagerType::Default;
+	if (options.runManager == "serial" || options.IsForkMode()) {
+		runManagerType = G4RunManagerType::Serial;
+	}
+	else if (options.runManager == "mt") {
+		runManagerType = G4RunManagerType::MT;
+	}
+	else if (options.runManager == "tasking") {
+		runManagerType = G4RunManagerType::Tasking;
+	}
+	else if (options.IsSubEventMode()) {
+#if G4VERSION_NUMBER >= 1120
+		runManagerType = G4RunManagerType::SubEvt;
+#else
+		G4cerr << "Error: sub-event parallel mode needs Geant4 11.2 or newer" << G4endl;
+		return 1;
+#endif
+	}
 	auto* runManager =
-		G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+		G4RunManagerFactory::CreateRunManager(runManagerType, options.threads);
+
+#if G4VERSION_NUMBER >= 1120
+	// optical photons of each event are tracked in batches spread over the workers
+	if (options.IsSubEventMode()) {
+		auto* subEvtRunManager = dynamic_cast<G4SubEvtRunManager*>(runManager);
+		if (subEvtRunManager) {
+			subEvtRunManager->RegisterSubEventType(StackingAction::kOpticalSubEventType,
+				options.subEventSize);
+		}
+	}
+#endif
 	
 	// set 3 required initialization classes
-	runManager->SetUserInitialization(new PhysicsList());
+	auto* physicsList = new PhysicsList();
+	if ((!options.em.empty() && !physicsList->SetEmPhysics(options.em)) ||
+		(!options.opticalProfile.empty() && !physicsList->SetOpticalProfile(options.opticalProfile))) {
+		delete physicsList;
+		delete runManager;
+		return 1;
+	}
+	if (!options.physicsCache.empty()) {
+		physicsList->SetTableCache(options.physicsCache);
+	}
+	runManager->SetUserInitialization(physicsList);
 	runManager->SetUserInitialization(new DetectorConstruction());
-	runManager->SetUserInitialization(new ActionInit());
+	runManager->SetUserInitialization(new ActionInit(options.IsSubEventMode()));
 
 	// ======================================================================
 	// OTHER CLASSES:
 	// Vismanager, scoringmanager, etc.
 	// ======================================================================
 
-	G4VisManager* visManager = new G4VisExecutive;
-	visManager->Initialize();
+	// vis is only needed for the interactive session
+	G4VisManager* visManager = nullptr;
+	if (ui) {
+		visManager = new G4VisExecutive;
+		visManager->Initialize();
+	}
 
 	//G4TrajectoryDrawByAttribute* model = new G4TrajectoryDrawByAttribute;
 	//model->Set("CPN")
 
 	// random seed
-	long seed = 12345;
+	long seed = options.seed;
 	
 	CLHEP::HepRandom::setTheSeed(seed);
 	G4Random::setTheSeed(seed);
 
+	// every event is reseeded from (seed, run id, event id), independent of the thread count
+	EventSeeder::SetMasterSeed(seed);
+
+	// shards of a split job continue the event numbering of the previous shard, so the
+	// union of all shards is the same sample as one big run with the same seed
+	if (options.IsShard()) {
+		G4long stride = (options.events > 0) ? options.events : (G4long(1) << 32);
+		EventSeeder::SetEventOffset(options.jobIndex * stride);
+	}
+
 	// START UI =============================================================
 
 	// get pointer to UI manager
 	G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
 	// Run macro or start UI
+	int exitCode = 0;
 	if (!ui) {
 		// batch mode
-		G4String command = "/control/execute ";
-		G4String fileName = argv[1];
-		UImanager->ApplyCommand(command + fileName);
+		if (!options.macro.empty()) {
+			G4String command = "/control/execute ";
+			UImanager->ApplyCommand(command + options.macro);
+		}
+		if (options.events > 0) {
+			if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_PreInit) {
+				UImanager->ApplyCommand("/run/initialize");
+			}
+			if (options.IsForkMode()) {
+				// one serial run manager per process instead of one thread per core
+				ForkRunner forkRunner(options.processes);
+				if (!forkRunner.BeamOn(options.events)) {
+					exitCode = 1;
+				}
+			}
+			else {
+				UImanager->ApplyCommand("/run/beamOn " + std::to_string(options.events));
+			}
+		}
 	}
 	else {
 		// run visualization
@@ -85,7 +182,7 @@ int main(int argc, char** argv)
 	delete runManager;
 
 
-	return 0;
+	return exitCode;
 }
 
 
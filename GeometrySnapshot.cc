@@ -0,0 +1,135 @@
+
+#include "GeometrySnapshot.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Version.hh"
+#ifdef G4_BREMS_WITH_GDML
+#include "G4GDMLParser.hh"
+#endif
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        const char kCacheMagic[8] = { 'S', 'N', 'F', 'P', 'R', 'O', 'P', '1' };
+        constexpr std::uint64_t kFnvOffset = 14695981039346656037ULL;
+        constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
+
+        std::uint64_t HashBytes(const char* data, std::size_t size, std::uint64_t hash) {
+            for (std::size_t i = 0; i < size; i++) {
+                hash ^= static_cast<unsigned char>(data[i]);
+                hash *= kFnvPrime;
+            }
+            return hash;
+        }
+
+        template <typename T>
+        std::uint64_t HashValue(const T& value, std::uint64_t hash) {
+            return HashBytes(reinterpret_cast<const char*>(&value), sizeof(T), hash);
+        }
+
+        void WriteVector(std::ofstream& out, const std::vector<G4double>& values) {
+            out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(G4double));
+        }
+
+        G4bool ReadVector(std::ifstream& in, std::vector<G4double>& values, std::uint64_t size) {
+            values.resize(size);
+            in.read(reinterpret_cast<char*>(values.data()), size * sizeof(G4double));
+            return static_cast<G4bool>(in);
+        }
+    }
+
+    std::uint64_t GeometrySnapshot::HashFile(const G4String& path, std::uint64_t seed) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return seed;
+
+        std::uint64_t hash = seed;
+        char buffer[1 << 16];
+        while (in) {
+            in.read(buffer, sizeof(buffer));
+            hash = HashBytes(buffer, static_cast<std::size_t>(in.gcount()), hash);
+        }
+        return hash;
+    }
+
+    std::uint64_t GeometrySnapshot::InputChecksum(const std::vector<G4String>& inputFiles) {
+        std::uint64_t hash = kFnvOffset;
+        hash = HashValue(kGeometryRevision, hash);
+        hash = HashValue(static_cast<G4int>(G4VERSION_NUMBER), hash);
+        for (const auto& file : inputFiles) {
+            hash = HashBytes(file.data(), file.size(), hash);
+            hash = HashFile(file, hash);
+        }
+        return hash;
+    }
+
+    G4bool GeometrySnapshot::WritePropertyCache(const G4String& path, std::uint64_t inputChecksum,
+        std::uint64_t gdmlHash, const OpticalSpectra& spectra) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return false;
+        }
+
+        std::uint64_t size = spectra.energies.size();
+        out.write(kCacheMagic, sizeof(kCacheMagic));
+        out.write(reinterpret_cast<const char*>(&inputChecksum), sizeof(inputChecksum));
+        out.write(reinterpret_cast<const char*>(&gdmlHash), sizeof(gdmlHash));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        WriteVector(out, spectra.energies);
+        WriteVector(out, spectra.scintEmission);
+        WriteVector(out, spectra.absFiber);
+        WriteVector(out, spectra.emissionIntensity);
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool GeometrySnapshot::ReadPropertyCache(const G4String& path, std::uint64_t& inputChecksum,
+        std::uint64_t& gdmlHash, OpticalSpectra& spectra) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return false;
+
+        char magic[sizeof(kCacheMagic)];
+        std::uint64_t size = 0;
+        in.read(magic, sizeof(magic));
+        if (!in || std::memcmp(magic, kCacheMagic, sizeof(kCacheMagic)) != 0) return false;
+        in.read(reinterpret_cast<char*>(&inputChecksum), sizeof(inputChecksum));
+        in.read(reinterpret_cast<char*>(&gdmlHash), sizeof(gdmlHash));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!in) return false;
+
+        return ReadVector(in, spectra.energies, size)
+            && ReadVector(in, spectra.scintEmission, size)
+            && ReadVector(in, spectra.absFiber, size)
+            && ReadVector(in, spectra.emissionIntensity, size);
+    }
+
+#ifdef G4_BREMS_WITH_GDML
+    G4bool GeometrySnapshot::WriteGDML(const G4String& path, const G4VPhysicalVolume* world) {
+        // The GDML writer refuses to overwrite an existing file
+        std::remove(path.c_str());
+
+        G4GDMLParser parser;
+        parser.Write(path, world, true);
+        return true;
+    }
+
+    G4VPhysicalVolume* GeometrySnapshot::ReadGDML(const G4String& path) {
+        G4GDMLParser parser;
+        parser.Read(path, false);
+        return parser.GetWorldVolume();
+    }
+#else
+    G4bool GeometrySnapshot::WriteGDML(const G4String&, const G4VPhysicalVolume*) {
+        G4Exception("GeometrySnapshot::WriteGDML()", "Snapshot_W001", JustWarning,
+            "Geant4 was built without GDML support, snapshot not written");
+        return false;
+    }
+
+    G4VPhysicalVolume* GeometrySnapshot::ReadGDML(const G4String&) {
+        G4Exception("GeometrySnapshot::ReadGDML()", "Snapshot_W002", JustWarning,
+            "Geant4 was built without GDML support, snapshot ignored");
+        return nullptr;
+    }
+#endif
+}
@@ -0,0 +1,39 @@
+
+#ifndef G4_BREMS_GEOMETRY_SNAPSHOT_H
+#define G4_BREMS_GEOMETRY_SNAPSHOT_H 1
+
+#include "globals.hh"
+#include "DetectorConstruction.hh"
+#include <cstdint>
+#include <vector>
+
+class G4VPhysicalVolume;
+
+namespace G4_BREMS {
+
+    // Snapshot of the constructed detector: a GDML file holding the volumes, materials and
+    // optical surfaces, plus a binary cache "<file>.props" holding the merged optical spectra
+    // at full precision. The cache header carries a checksum of the construction inputs
+    // (csv files, geometry revision, Geant4 version) so stale snapshots are rejected.
+    class GeometrySnapshot
+    {
+    public:
+        // Bump whenever DetectorConstruction::ConstructDetector changes the geometry
+        static constexpr std::uint32_t kGeometryRevision = 3;
+
+        static G4String PropertyCachePath(const G4String& gdmlPath) { return gdmlPath + ".props"; }
+
+        static std::uint64_t HashFile(const G4String& path, std::uint64_t seed);
+        static std::uint64_t InputChecksum(const std::vector<G4String>& inputFiles);
+
+        static G4bool WritePropertyCache(const G4String& path, std::uint64_t inputChecksum,
+            std::uint64_t gdmlHash, const OpticalSpectra& spectra);
+        static G4bool ReadPropertyCache(const G4String& path, std::uint64_t& inputChecksum,
+            std::uint64_t& gdmlHash, OpticalSpectra& spectra);
+
+        static G4bool WriteGDML(const G4String& path, const G4VPhysicalVolume* world);
+        static G4VPhysicalVolume* ReadGDML(const G4String& path);
+    };
+}
+
+#endif
@@ -0,0 +1,100 @@
+
+#include "HitLibrary.hh"
+#include "SipmChannel.hh"
+#include "G4AutoLock.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        G4Mutex hitLibraryMutex = G4MUTEX_INITIALIZER;
+        std::ofstream gLibraryFile;
+
+        const char kLibraryMagic[8] = { 'S', 'N', 'F', 'H', 'L', 'I', 'B', '1' };
+
+        template <typename T>
+        void Append(std::vector<char>& buffer, const T& value) {
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+    }
+
+    void HitLibrary::OpenOutput(const G4String& path)
+    {
+        G4AutoLock lock(&hitLibraryMutex);
+        if (gLibraryFile.is_open()) gLibraryFile.close();
+        gLibraryFile.open(path, std::ios::binary | std::ios::trunc);
+        if (!gLibraryFile.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return;
+        }
+        const std::uint32_t channels = SipmChannel::kChannels;
+        gLibraryFile.write(kLibraryMagic, sizeof(kLibraryMagic));
+        gLibraryFile.write(reinterpret_cast<const char*>(&channels), sizeof(channels));
+        G4cout << "Recording SiPM hit lists to " << path << G4endl;
+    }
+
+    void HitLibrary::CloseOutput()
+    {
+        G4AutoLock lock(&hitLibraryMutex);
+        if (gLibraryFile.is_open()) gLibraryFile.close();
+    }
+
+    void HitLibrary::Serialize(G4int eventID, const std::vector<SipmHit>& hits, std::vector<char>& buffer)
+    {
+        buffer.clear();
+        Append(buffer, static_cast<std::uint32_t>(eventID));
+        Append(buffer, static_cast<std::uint32_t>(hits.size()));
+        for (const auto& hit : hits) {
+            Append(buffer, Hit{ hit.sipmID, static_cast<float>(hit.time / ns),
+                static_cast<float>(hit.position.x() / mm), static_cast<float>(hit.position.y() / mm),
+                static_cast<float>(hit.position.z() / mm), static_cast<float>(hit.energy / eV),
+                static_cast<float>(hit.wavelength) });
+        }
+    }
+
+    void HitLibrary::Write(const std::vector<char>& buffer)
+    {
+        G4AutoLock lock(&hitLibraryMutex);
+        if (gLibraryFile.is_open()) gLibraryFile.write(buffer.data(), buffer.size());
+    }
+
+    G4bool HitLibrary::Load(const G4String& path)
+    {
+        fPath = path;
+        fMaxTime = 0.;
+        fHits.clear();
+        fOffsets.assign(1, 0);
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            G4cerr << "Error: Could not open " << path << G4endl;
+            return false;
+        }
+        char magic[8];
+        std::uint32_t channels = 0;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&channels), sizeof(channels));
+        if (!in || std::memcmp(magic, kLibraryMagic, sizeof(magic)) != 0 || channels != SipmChannel::kChannels) {
+            G4cerr << "Error: " << path << " is not a hit library of " << SipmChannel::kChannels << " channels" << G4endl;
+            return false;
+        }
+
+        std::uint32_t header[2];
+        while (in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            const std::size_t first = fHits.size();
+            fHits.resize(first + header[1]);
+            if (!in.read(reinterpret_cast<char*>(fHits.data() + first), header[1] * sizeof(Hit))) {
+                G4cerr << "Error: " << path << " ends inside event " << header[0] << G4endl;
+                fHits.resize(first);
+                return false;
+            }
+            for (std::size_t hit = first; hit < fHits.size(); hit++) fMaxTime = std::max<G4double>(fMaxTime, fHits[hit].time);
+            fOffsets.push_back(fHits.size());
+        }
+        return true;
+    }
+}
@@ -0,0 +1,59 @@
+
+#ifndef G4_BREMS_HIT_LIBRARY_H
+#define G4_BREMS_HIT_LIBRARY_H 1
+
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Library of simulated events as bare SiPM hit lists, recorded once and replayed by the
+    // background mixer or G4_Brems_mix instead of tracking the optical photons again. Hit times
+    // are relative to the start of the recorded event.
+    //
+    // File layout (little endian):
+    //   char[8] "SNFHLIB1", uint32 channels, then per event in completion order:
+    //   uint32 eventID, uint32 hits, per hit: int32 channel, float time[ns], float x, y, z [mm],
+    //   float energy[eV], float wavelength[nm]
+    class HitLibrary
+    {
+    public:
+        struct Hit {
+            std::int32_t channel;
+            float time;
+            float x, y, z;
+            float energy;
+            float wavelength;
+        };
+        static_assert(sizeof(Hit) == 28, "Hit is written as is");
+
+        // Recording: the master opens and closes the run's file, every thread appends events
+        static void OpenOutput(const G4String& path);
+        static void CloseOutput();
+        static void Serialize(G4int eventID, const std::vector<SipmHit>& hits, std::vector<char>& buffer);
+        static void Write(const std::vector<char>& buffer);
+
+        // Reading, whole file into memory; false with a message on error
+        G4bool Load(const G4String& path);
+        const G4String& GetPath() const { return fPath; }
+        std::size_t GetEventCount() const { return fOffsets.size() - 1; }
+        std::size_t GetHitCount() const { return fHits.size(); }
+        // Latest hit time of any event, ns
+        G4double GetMaxTime() const { return fMaxTime; }
+        std::pair<const Hit*, const Hit*> GetEvent(std::size_t event) const
+        {
+            return { fHits.data() + fOffsets[event], fHits.data() + fOffsets[event + 1] };
+        }
+
+    private:
+        G4String fPath;
+        G4double fMaxTime = 0.;
+        std::vector<Hit> fHits;
+        std::vector<std::size_t> fOffsets{ 0 };   // first hit of each event, and the end
+    };
+}
+
+#endif
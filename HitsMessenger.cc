@@ -0,0 +1,77 @@
+
+#include "HitsMessenger.hh"
+#include "ChannelHistograms.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4SystemOfUnits.hh"
+
+namespace G4_BREMS {
+
+    HitsMessenger::HitsMessenger()
+        : G4UImessenger()
+    {
+        fHitsDirectory = new G4UIdirectory("/snf/hits/", false);
+        fHitsDirectory->SetGuidance("Storage of the SiPM hits of a run.");
+
+        fModeCmd = new G4UIcmdWithAString("/snf/hits/mode", this);
+        fModeCmd->SetGuidance("list: keep every hit and write the sipm hits csv (default).");
+        fModeCmd->SetGuidance("histogram: fill per-channel time and photoelectron histograms at detection");
+        fModeCmd->SetGuidance("time instead, written to channel_hists_run<N>.csv; memory does not grow with events.");
+        fModeCmd->SetParameterName("mode", false);
+        fModeCmd->SetCandidates("list histogram");
+
+        fTimeBinsCmd = new G4UIcmdWithAnInteger("/snf/hits/timeBins", this);
+        fTimeBinsCmd->SetGuidance("Bins of the per-channel arrival time histogram, plus one overflow bin (default 200).");
+        fTimeBinsCmd->SetParameterName("bins", false);
+        fTimeBinsCmd->SetRange("bins > 0");
+
+        fTimeMaxCmd = new G4UIcmdWithADoubleAndUnit("/snf/hits/timeMax", this);
+        fTimeMaxCmd->SetGuidance("Upper edge of the arrival time histogram (default 200 ns).");
+        fTimeMaxCmd->SetParameterName("time", false);
+        fTimeMaxCmd->SetDefaultUnit("ns");
+
+        fPeBinsCmd = new G4UIcmdWithAnInteger("/snf/hits/peBins", this);
+        fPeBinsCmd->SetGuidance("Bins of the per-channel photoelectrons per event, last one is overflow (default 64).");
+        fPeBinsCmd->SetParameterName("bins", false);
+        fPeBinsCmd->SetRange("bins > 1");
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fModeCmd, fTimeBinsCmd, fTimeMaxCmd, fPeBinsCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+    }
+
+    HitsMessenger::~HitsMessenger()
+    {
+        delete fModeCmd;
+        delete fTimeBinsCmd;
+        delete fTimeMaxCmd;
+        delete fPeBinsCmd;
+        delete fHitsDirectory;
+    }
+
+    void HitsMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        ChannelHistogramParameters& parameters = ChannelHistograms::Parameters();
+        if (command == fModeCmd) {
+            parameters.enabled = (newValue == "histogram");
+        }
+        else if (command == fTimeBinsCmd) {
+            parameters.timeBins = fTimeBinsCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fTimeMaxCmd) {
+            G4double timeMax = fTimeMaxCmd->GetNewDoubleValue(newValue) / ns;
+            if (timeMax <= 0.) {
+                G4Exception("HitsMessenger::SetNewValue", "Hits_W001", JustWarning,
+                    "The arrival time histogram needs a positive upper edge, timeMax is unchanged.");
+                return;
+            }
+            parameters.timeMax = timeMax;
+        }
+        else if (command == fPeBinsCmd) {
+            parameters.peBins = fPeBinsCmd->GetNewIntValue(newValue);
+        }
+    }
+}
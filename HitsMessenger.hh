@@ -0,0 +1,33 @@
+
+#ifndef G4_BREMS_HITS_MESSENGER_H
+#define G4_BREMS_HITS_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADoubleAndUnit;
+
+namespace G4_BREMS {
+
+    // /snf/hits/: hit list or per-channel histograms (master only, see ChannelHistograms)
+    class HitsMessenger : public G4UImessenger
+    {
+    public:
+        HitsMessenger();
+        ~HitsMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fHitsDirectory;
+        G4UIcmdWithAString* fModeCmd;
+        G4UIcmdWithAnInteger* fTimeBinsCmd;
+        G4UIcmdWithADoubleAndUnit* fTimeMaxCmd;
+        G4UIcmdWithAnInteger* fPeBinsCmd;
+    };
+}
+
+#endif
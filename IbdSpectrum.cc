@@ -0,0 +1,130 @@
+
+#include "IbdSpectrum.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        // exp(sum a_k E^k), E in MeV; Mueller et al. PRC 83 (2011) 054615 / Huber PRC 84 (2011) 024617
+        const G4double kFissionCoefficients[4][6] = {
+            { 3.217, -3.111, 1.395, -0.3690, 0.04445, -0.002053 },      // U235
+            { 0.4833, 0.1927, -0.1283, -0.006762, 0.002233, -0.0001536 }, // U238
+            { 6.413, -7.432, 3.535, -0.8820, 0.1025, -0.004550 },       // Pu239
+            { 3.251, -3.204, 1.428, -0.3675, 0.04254, -0.001896 }       // Pu241
+        };
+
+        // Beta endpoint (MeV) and relative activity above threshold
+        struct BetaBranch {
+            G4double endpoint;
+            G4double activity;
+        };
+        const BetaBranch kSpentFuelBranches[] = {
+            { 2.9975, 1.0 },   // Pr-144 (from Ce-144)
+            { 3.5410, 0.6 },   // Rh-106 (from Ru-106)
+            { 2.2801, 0.4 }    // Y-90 (from Sr-90)
+        };
+
+        // Allowed antineutrino spectrum of a beta decay with the given endpoint
+        G4double AllowedSpectrum(G4double neutrinoEnergy, G4double endpoint) {
+            G4double kinetic = endpoint - neutrinoEnergy;
+            if (kinetic <= 0.) return 0.;
+            G4double total = kinetic + IbdSpectrum::kElectronMass;
+            G4double momentum = std::sqrt(total * total - IbdSpectrum::kElectronMass * IbdSpectrum::kElectronMass);
+            return neutrinoEnergy * neutrinoEnergy * total * momentum;
+        }
+    }
+
+    G4double IbdSpectrum::ReactorFlux(G4double neutrinoEnergy, const FissionFractions& fractions)
+    {
+        G4double flux = 0.;
+        for (std::size_t i = 0; i < fractions.size(); i++) {
+            G4double exponent = 0.;
+            G4double power = 1.;
+            for (G4double a : kFissionCoefficients[i]) {
+                exponent += a * power;
+                power *= neutrinoEnergy;
+            }
+            flux += fractions[i] * std::exp(exponent);
+        }
+        return flux;
+    }
+
+    G4double IbdSpectrum::SpentFuelFlux(G4double neutrinoEnergy)
+    {
+        G4double flux = 0.;
+        for (const auto& branch : kSpentFuelBranches) {
+            flux += branch.activity * AllowedSpectrum(neutrinoEnergy, branch.endpoint);
+        }
+        return flux;
+    }
+
+    G4double IbdSpectrum::CrossSection(G4double neutrinoEnergy)
+    {
+        // sigma ~ E_e p_e (Vogel & Beacom, zeroth order)
+        G4double total = neutrinoEnergy - kMassDifference;
+        if (total <= kElectronMass) return 0.;
+        return total * std::sqrt(total * total - kElectronMass * kElectronMass);
+    }
+
+    G4bool IbdSpectrum::ReadFluxFile(const G4String& path, std::vector<G4double>& energies,
+        std::vector<G4double>& flux)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) return false;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream iss(line);
+            G4double e = 0., f = 0.;
+            // header lines and malformed rows are skipped
+            if (!(iss >> e >> f)) continue;
+            energies.push_back(e);
+            flux.push_back(f);
+        }
+        return energies.size() >= 2 && std::is_sorted(energies.begin(), energies.end());
+    }
+
+    G4bool IbdSpectrum::Build(const G4String& model, const FissionFractions& fractions,
+        std::vector<G4double>& edges, std::vector<G4double>& weights,
+        G4double maxNeutrinoEnergy, std::size_t bins)
+    {
+        std::vector<G4double> fileEnergies;
+        std::vector<G4double> fileFlux;
+        const G4bool fromFile = (model != "reactor" && model != "spentfuel");
+        if (fromFile && !ReadFluxFile(model, fileEnergies, fileFlux)) {
+            G4cerr << "Error: Could not read antineutrino spectrum " << model << G4endl;
+            return false;
+        }
+
+        auto flux = [&](G4double e) {
+            if (model == "reactor") return ReactorFlux(e, fractions);
+            if (model == "spentfuel") return SpentFuelFlux(e);
+            if (e < fileEnergies.front() || e > fileEnergies.back()) return 0.;
+            auto it = std::upper_bound(fileEnergies.begin(), fileEnergies.end(), e);
+            if (it == fileEnergies.end()) return fileFlux.back();
+            std::size_t i = it - fileEnergies.begin();
+            G4double t = (e - fileEnergies[i - 1]) / (fileEnergies[i] - fileEnergies[i - 1]);
+            return fileFlux[i - 1] + t * (fileFlux[i] - fileFlux[i - 1]);
+        };
+
+        // Uniform bins in neutrino energy are uniform bins in positron kinetic energy
+        const G4double offset = kMassDifference + kElectronMass;
+        const G4double width = (maxNeutrinoEnergy - kThreshold) / bins;
+        edges.resize(bins + 1);
+        weights.resize(bins);
+        for (std::size_t i = 0; i <= bins; i++) {
+            edges[i] = std::max(0., kThreshold + i * width - offset) * MeV;
+        }
+        for (std::size_t i = 0; i < bins; i++) {
+            G4double e = kThreshold + (i + 0.5) * width;
+            weights[i] = std::max(0., flux(e)) * CrossSection(e);
+        }
+        return true;
+    }
+}
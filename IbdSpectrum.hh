@@ -0,0 +1,44 @@
+
+#ifndef G4_BREMS_IBD_SPECTRUM_H
+#define G4_BREMS_IBD_SPECTRUM_H 1
+
+#include "globals.hh"
+#include <array>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Positron kinetic energy spectrum of inverse beta decay, antineutrino flux x IBD cross
+    // section, in zeroth order (infinite nucleon mass): T(e+) = E(nu) - (m_n - m_p) - m_e.
+    //  - "reactor":   Huber-Mueller exponential-polynomial fits of the U235/U238/Pu239/Pu241
+    //                 fission spectra weighted by the fission fractions
+    //  - "spentfuel": long-lived fission products above threshold (Pr-144, Rh-106, Y-90) as
+    //                 allowed beta spectra without Fermi function, activities of ~1 year cooled fuel
+    //  - anything else is read as a csv file "E_nu(MeV),flux" and interpolated linearly
+    class IbdSpectrum
+    {
+    public:
+        static constexpr G4double kThreshold = 1.806;          // MeV, antineutrino energy
+        static constexpr G4double kMassDifference = 1.29333;   // MeV, m_n - m_p
+        static constexpr G4double kElectronMass = 0.51099895;  // MeV
+
+        // Fission fractions U235, U238, Pu239, Pu241
+        using FissionFractions = std::array<G4double, 4>;
+
+        static G4double ReactorFlux(G4double neutrinoEnergy, const FissionFractions& fractions);
+        static G4double SpentFuelFlux(G4double neutrinoEnergy);
+        static G4double CrossSection(G4double neutrinoEnergy);   // arbitrary units
+
+        // Bin edges (positron kinetic energy, Geant4 units) and weights; false if the model
+        // is neither built in nor a readable file
+        static G4bool Build(const G4String& model, const FissionFractions& fractions,
+            std::vector<G4double>& edges, std::vector<G4double>& weights,
+            G4double maxNeutrinoEnergy = 10.0, std::size_t bins = 820);
+
+    private:
+        static G4bool ReadFluxFile(const G4String& path, std::vector<G4double>& energies,
+            std::vector<G4double>& flux);
+    };
+}
+
+#endif
@@ -0,0 +1,108 @@
+
+#include "MixingMessenger.hh"
+#include "BackgroundMixer.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4SystemOfUnits.hh"
+#include <sstream>
+
+namespace G4_BREMS {
+
+    MixingMessenger::MixingMessenger()
+        : G4UImessenger()
+    {
+        fBkgDirectory = new G4UIdirectory("/snf/bkg/", false);
+        fBkgDirectory->SetGuidance("SiPM hit libraries and background mixing for pile-up studies.");
+
+        fRecordCmd = new G4UIcmdWithABool("/snf/bkg/record", this);
+        fRecordCmd->SetGuidance("Write the hits of every event, before mixing and trigger, to hitlib_run<N>.bin.");
+        fRecordCmd->SetParameterName("record", true);
+        fRecordCmd->SetDefaultValue(true);
+
+        fAddCmd = new G4UIcommand("/snf/bkg/add", this);
+        fAddCmd->SetGuidance("Overlay events of a hit library on every event at the given rate (Hz).");
+        fAddCmd->SetGuidance("The library is read once, here; sources accumulate until /snf/bkg/clear.");
+        fAddCmd->SetParameter(new G4UIparameter("name", 's', false));
+        fAddCmd->SetParameter(new G4UIparameter("library", 's', false));
+        auto rate = new G4UIparameter("rate", 'd', false);
+        rate->SetParameterRange("rate >= 0");
+        fAddCmd->SetParameter(rate);
+
+        fClearCmd = new G4UIcmdWithoutParameter("/snf/bkg/clear", this);
+        fClearCmd->SetGuidance("Remove all background sources.");
+
+        fDarkRateCmd = new G4UIcmdWithADoubleAndUnit("/snf/bkg/darkRate", this);
+        fDarkRateCmd->SetGuidance("Dark count rate per channel added as single hits (default 0).");
+        fDarkRateCmd->SetParameterName("rate", false);
+        fDarkRateCmd->SetRange("rate >= 0");
+        fDarkRateCmd->SetUnitCategory("Frequency");
+        fDarkRateCmd->SetDefaultUnit("kHz");
+
+        fWindowCmd = new G4UIcommand("/snf/bkg/window", this);
+        fWindowCmd->SetGuidance("Time line around each event that backgrounds are mixed into (default -1000 1000 ns).");
+        fWindowCmd->SetParameter(new G4UIparameter("start", 'd', false));
+        fWindowCmd->SetParameter(new G4UIparameter("end", 'd', false));
+        auto unit = new G4UIparameter("unit", 's', true);
+        unit->SetDefaultValue("ns");
+        fWindowCmd->SetParameter(unit);
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fRecordCmd, fAddCmd, fClearCmd,
+            fDarkRateCmd, fWindowCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+    }
+
+    MixingMessenger::~MixingMessenger()
+    {
+        delete fRecordCmd;
+        delete fAddCmd;
+        delete fClearCmd;
+        delete fDarkRateCmd;
+        delete fWindowCmd;
+        delete fBkgDirectory;
+    }
+
+    void MixingMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        MixingParameters& parameters = BackgroundMixer::Parameters();
+        if (command == fRecordCmd) {
+            parameters.record = fRecordCmd->GetNewBoolValue(newValue);
+        }
+        else if (command == fAddCmd) {
+            std::istringstream is(newValue);
+            G4String name, path;
+            G4double rate = 0.;
+            is >> name >> path >> rate;
+            auto library = std::make_shared<HitLibrary>();
+            if (!library->Load(path)) return;
+            parameters.sources.push_back({ name, rate, library });
+            G4cout << "Background " << name << ": " << library->GetEventCount() << " events, "
+                << library->GetHitCount() << " hits from " << path << " at " << rate << " Hz" << G4endl;
+        }
+        else if (command == fClearCmd) {
+            parameters.sources.clear();
+        }
+        else if (command == fDarkRateCmd) {
+            parameters.darkRate = fDarkRateCmd->GetNewDoubleValue(newValue) / hertz;
+        }
+        else if (command == fWindowCmd) {
+            std::istringstream is(newValue);
+            G4double start = 0., end = 0.;
+            G4String unit;
+            is >> start >> end >> unit;
+            const G4double scale = G4UIcommand::ValueOf(unit) / ns;
+            if (end <= start) {
+                G4Exception("MixingMessenger::SetNewValue", "Mixing_W001", JustWarning,
+                    "The window end must be after its start; window unchanged.");
+                return;
+            }
+            parameters.windowStart = start * scale;
+            parameters.windowEnd = end * scale;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+
+#ifndef G4_BREMS_MIXING_MESSENGER_H
+#define G4_BREMS_MIXING_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithABool;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithoutParameter;
+
+namespace G4_BREMS {
+
+    // /snf/bkg/: hit libraries and pile-up mixing (master only, see BackgroundMixer)
+    class MixingMessenger : public G4UImessenger
+    {
+    public:
+        MixingMessenger();
+        ~MixingMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fBkgDirectory;
+        G4UIcmdWithABool* fRecordCmd;
+        G4UIcommand* fAddCmd;
+        G4UIcmdWithoutParameter* fClearCmd;
+        G4UIcmdWithADoubleAndUnit* fDarkRateCmd;
+        G4UIcommand* fWindowCmd;
+    };
+}
+
+#endif
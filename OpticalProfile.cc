@@ -0,0 +1,97 @@
+
+#include "OpticalProfile.hh"
+#include "G4OpticalParameters.hh"
+#include "G4StateManager.hh"
+#include "G4UImanager.hh"
+#include <algorithm>
+
+namespace G4_BREMS {
+
+    namespace {
+        const std::vector<G4String> kOpticalProcesses = {
+            "Cerenkov", "Scintillation", "OpAbsorption", "OpRayleigh", "OpMieHG", "OpBoundary", "OpWLS"
+        };
+
+        std::vector<OpticalProfile> BuildProfiles()
+        {
+            // Everything on: the reference for the other two
+            OpticalProfile full;
+            full.name = "full";
+
+            // Fiber timing studies: realistic WLS re-emission time, no bulk scattering (the
+            // materials carry no RAYLEIGH or MIEHG data), no Cerenkov light born in the SiPMs
+            OpticalProfile wlsStudy;
+            wlsStudy.name = "wls-study";
+            wlsStudy.inactiveProcesses = { "OpRayleigh", "OpMieHG" };
+            wlsStudy.wlsTimeProfile = "exponential";
+            wlsStudy.regionVetoes = { { "Cerenkov", "Sipms" } };
+
+            // Only what changes the SiPM hits: photons born in the SiPMs never enter them from a
+            // fiber, and scintillation outside the tiles is vetoed should a material gain a yield
+            OpticalProfile production;
+            production.name = "production";
+            production.inactiveProcesses = { "OpRayleigh", "OpMieHG" };
+            production.cerenkovMaxPhotonsPerStep = 300;
+            production.cerenkovMaxBetaChange = 20.;
+            production.regionVetoes = { { "Cerenkov", "Sipms" }, { "Scintillation", "Sipms" },
+                { "Scintillation", "Fibers" } };
+
+            return { production, wlsStudy, full };
+        }
+
+        const OpticalProfile* gActiveProfile = nullptr;
+    }
+
+    const std::vector<OpticalProfile>& OpticalProfile::All()
+    {
+        static const std::vector<OpticalProfile> profiles = BuildProfiles();
+        return profiles;
+    }
+
+    const OpticalProfile* OpticalProfile::Find(const G4String& name)
+    {
+        for (const auto& profile : All()) {
+            if (profile.name == name) return &profile;
+        }
+        return nullptr;
+    }
+
+    const OpticalProfile& OpticalProfile::Active()
+    {
+        return gActiveProfile ? *gActiveProfile : *Find("full");
+    }
+
+    G4bool OpticalProfile::SetActive(const G4String& name)
+    {
+        const OpticalProfile* profile = Find(name);
+        if (!profile) {
+            G4cerr << "Error: unknown optical profile '" << name << "'" << G4endl;
+            return false;
+        }
+        gActiveProfile = profile;
+
+        auto parameters = G4OpticalParameters::Instance();
+        parameters->SetWLSTimeProfile(profile->wlsTimeProfile);
+        parameters->SetScintTrackSecondariesFirst(profile->scintTrackSecondariesFirst);
+        parameters->SetCerenkovMaxPhotonsPerStep(profile->cerenkovMaxPhotonsPerStep);
+        parameters->SetCerenkovMaxBetaChange(profile->cerenkovMaxBetaChange);
+
+        const G4bool initialized = G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit;
+        for (const auto& process : kOpticalProcesses) {
+            G4bool active = std::find(profile->inactiveProcesses.begin(), profile->inactiveProcesses.end(),
+                process) == profile->inactiveProcesses.end();
+            parameters->SetProcessActivation(process, active);
+            // Broadcast, the process tables are per thread
+            if (initialized) {
+                G4UImanager::GetUIpointer()->ApplyCommand(
+                    (active ? "/process/activate " : "/process/inactivate ") + process);
+            }
+        }
+
+        // The WLS time profile and Cerenkov limits are read when the physics tables are prepared
+        if (initialized) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/run/physicsModified");
+        }
+        return true;
+    }
+}
@@ -0,0 +1,35 @@
+
+#ifndef G4_BREMS_OPTICAL_PROFILE_H
+#define G4_BREMS_OPTICAL_PROFILE_H 1
+
+#include "globals.hh"
+#include <utility>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Named set of optical-physics switches. G4OpticalParameters is global, so the per-region
+    // part is a list of vetoes: photons created by a process inside a region (as defined by
+    // DetectorConstruction) are killed by the StackingAction before they are tracked.
+    struct OpticalProfile {
+        G4String name;
+        std::vector<G4String> inactiveProcesses;
+        G4String wlsTimeProfile = "delta";
+        G4bool scintTrackSecondariesFirst = true;
+        G4int cerenkovMaxPhotonsPerStep = 100;
+        G4double cerenkovMaxBetaChange = 10.;   // percent
+        std::vector<std::pair<G4String, G4String>> regionVetoes;   // (creator process, region)
+
+        // production, wls-study or full; nullptr if unknown
+        static const OpticalProfile* Find(const G4String& name);
+        static const std::vector<OpticalProfile>& All();
+
+        // Profile in use, read by the stacking actions of every thread
+        static const OpticalProfile& Active();
+        // Before /run/initialize only G4OpticalParameters is set; between runs the processes are
+        // also switched with /process/(in)activate and the physics is flagged as modified
+        static G4bool SetActive(const G4String& name);
+    };
+}
+
+#endif
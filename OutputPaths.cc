@@ -0,0 +1,112 @@
+
+#include "OutputPaths.hh"
+#include <string>
+
+namespace G4_BREMS {
+
+    G4String OutputPaths::fPrefix;
+    G4int OutputPaths::fShardIndex = -1;
+    G4String OutputPaths::fTag;
+
+    G4String OutputPaths::Stem()
+    {
+        if (fPrefix.empty() && fShardIndex < 0 && fTag.empty()) return "";
+
+        G4String stem = fPrefix.empty() ? G4String("G4_Brems") : fPrefix;
+        if (fShardIndex >= 0) stem = ShardStem(stem, fShardIndex);
+        if (!fTag.empty()) stem += "_" + fTag;
+        return stem;
+    }
+
+    G4String OutputPaths::ShardStem(const G4String& prefix, G4int index)
+    {
+        return prefix + "_job" + std::to_string(index);
+    }
+
+    G4String OutputPaths::AnalysisFileName(const G4String& stem)
+    {
+        if (stem.empty()) return "OpticalPhotonAnalysis1";
+        return stem;
+    }
+
+    G4String OutputPaths::SipmHitsFileName(const G4String& stem)
+    {
+        if (stem.empty()) return "Sipm_Hits.root";
+        return stem + "_sipm_hits.root";
+    }
+
+    G4String OutputPaths::SipmHitsCsvName(const G4String& stem, G4int runID)
+    {
+        G4String name = "sipm_hits_run" + std::to_string(runID) + ".csv";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::SummaryCsvName(const G4String& stem, G4int runID)
+    {
+        G4String name = "summary_run" + std::to_string(runID) + ".csv";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::ResponseMatrixName(const G4String& stem)
+    {
+        if (stem.empty()) return "response_matrix.bin";
+        return stem + "_response_matrix.bin";
+    }
+
+    G4String OutputPaths::ScanIndexName(const G4String& stem)
+    {
+        if (stem.empty()) return "scan_points.csv";
+        return stem + "_scan_points.csv";
+    }
+
+    G4String OutputPaths::TileDepositsName(const G4String& stem, G4int runID)
+    {
+        G4String name = "tile_deposits_run" + std::to_string(runID) + ".bin";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::DigitsName(const G4String& stem, G4int runID)
+    {
+        G4String name = "digits_run" + std::to_string(runID) + ".bin";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::FeaturesName(const G4String& stem, G4int runID)
+    {
+        G4String name = "features_run" + std::to_string(runID) + ".csv";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::ReconstructionName(const G4String& stem, G4int runID)
+    {
+        G4String name = "reco_run" + std::to_string(runID) + ".csv";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::HitLibraryName(const G4String& stem, G4int runID)
+    {
+        G4String name = "hitlib_run" + std::to_string(runID) + ".bin";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::StepTapeName(const G4String& stem, G4int runID)
+    {
+        G4String name = "steps_run" + std::to_string(runID) + ".tape";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+
+    G4String OutputPaths::ChannelHistogramsName(const G4String& stem, G4int runID)
+    {
+        G4String name = "channel_hists_run" + std::to_string(runID) + ".csv";
+        if (stem.empty()) return name;
+        return stem + "_" + name;
+    }
+}
@@ -0,0 +1,63 @@
+
+#ifndef G4_BREMS_OUTPUT_PATHS_H
+#define G4_BREMS_OUTPUT_PATHS_H 1
+
+#include "globals.hh"
+
+namespace G4_BREMS {
+
+    // Names of the files written by RunAction. All names derive from a stem
+    // "<prefix>[_job<index>][_<tag>]". Without prefix, shard or tag the historical names are
+    // kept: OpticalPhotonAnalysis1.root, Sipm_Hits.root and sipm_hits_run<N>.csv.
+    // Configured on the master between runs, read by every thread at begin and end of run.
+    class OutputPaths
+    {
+    public:
+        static void SetPrefix(const G4String& prefix) { fPrefix = prefix; }
+        static const G4String& GetPrefix() { return fPrefix; }
+        static void SetShardIndex(G4int index) { fShardIndex = index; }
+        static G4int GetShardIndex() { return fShardIndex; }
+        static void SetTag(const G4String& tag) { fTag = tag; }
+        static const G4String& GetTag() { return fTag; }
+
+        // Empty when the historical names are in use
+        static G4String Stem();
+        static G4String ShardStem(const G4String& prefix, G4int index);
+
+        static G4String AnalysisFileName() { return AnalysisFileName(Stem()); }
+        static G4String SipmHitsFileName() { return SipmHitsFileName(Stem()); }
+        static G4String SipmHitsCsvName(G4int runID) { return SipmHitsCsvName(Stem(), runID); }
+        static G4String SummaryCsvName(G4int runID) { return SummaryCsvName(Stem(), runID); }
+        static G4String ResponseMatrixName() { return ResponseMatrixName(Stem()); }
+        static G4String ScanIndexName() { return ScanIndexName(Stem()); }
+        static G4String TileDepositsName(G4int runID) { return TileDepositsName(Stem(), runID); }
+        static G4String DigitsName(G4int runID) { return DigitsName(Stem(), runID); }
+        static G4String FeaturesName(G4int runID) { return FeaturesName(Stem(), runID); }
+        static G4String ReconstructionName(G4int runID) { return ReconstructionName(Stem(), runID); }
+        static G4String HitLibraryName(G4int runID) { return HitLibraryName(Stem(), runID); }
+        static G4String StepTapeName(G4int runID) { return StepTapeName(Stem(), runID); }
+        static G4String ChannelHistogramsName(G4int runID) { return ChannelHistogramsName(Stem(), runID); }
+
+        // Same names for an explicit stem, used by the shard merger
+        static G4String AnalysisFileName(const G4String& stem);
+        static G4String SipmHitsFileName(const G4String& stem);
+        static G4String SipmHitsCsvName(const G4String& stem, G4int runID);
+        static G4String SummaryCsvName(const G4String& stem, G4int runID);
+        static G4String ResponseMatrixName(const G4String& stem);
+        static G4String ScanIndexName(const G4String& stem);
+        static G4String TileDepositsName(const G4String& stem, G4int runID);
+        static G4String DigitsName(const G4String& stem, G4int runID);
+        static G4String FeaturesName(const G4String& stem, G4int runID);
+        static G4String ReconstructionName(const G4String& stem, G4int runID);
+        static G4String HitLibraryName(const G4String& stem, G4int runID);
+        static G4String StepTapeName(const G4String& stem, G4int runID);
+        static G4String ChannelHistogramsName(const G4String& stem, G4int runID);
+
+    private:
+        static G4String fPrefix;
+        static G4int fShardIndex;
+        static G4String fTag;
+    };
+}
+
+#endif
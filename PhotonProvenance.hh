@@ -0,0 +1,76 @@
+
+#ifndef G4_BREMS_PHOTON_PROVENANCE_H
+#define G4_BREMS_PHOTON_PROVENANCE_H 1
+
+#include "StepAnalysis.hh"
+#include "globals.hh"
+#include <cstdint>
+
+namespace G4_BREMS {
+
+    // Light path of a detected photon, kept up to date while it is tracked and handed on to the
+    // photons it is re-emitted as by WLS, so a hit carries the history of its whole chain.
+    //
+    // History word, from bit 0:
+    //   3 bits   origin process, StepCode creator of the first photon of the chain
+    //   3 bits   origin volume, StepCode volume it was created in (7 = unknown)
+    //   4 bits   WLS conversions
+    //   3 bits   volume of the last WLS conversion (7 = none)
+    //   16 bits  total internal reflections
+    //   16 bits  other reflections (Fresnel, Lambertian, lobe, spike, backscatter)
+    //   19 bits  zero
+    // Counters saturate instead of wrapping. Path lengths cover the whole chain, in mm.
+    struct PhotonProvenance {
+        static constexpr std::uint8_t kNoVolume = 7;
+        static constexpr std::uint64_t kUnknown =
+            (std::uint64_t(kNoVolume) << 3) | (std::uint64_t(kNoVolume) << 10);
+
+        std::uint64_t history = kUnknown;
+        float tilePath = 0.f;
+        float cladPath = 0.f;
+        float corePath = 0.f;
+
+        std::uint8_t OriginProcess() const { return Field(0, 3); }
+        std::uint8_t OriginVolume() const { return Field(3, 3); }
+        G4int WlsConversions() const { return Field(6, 4); }
+        std::uint8_t LastWlsVolume() const { return Field(10, 3); }
+        G4int TotalInternalReflections() const { return Field(13, 16); }
+        G4int Reflections() const { return Field(29, 16); }
+
+        void SetOrigin(std::uint8_t process, std::uint8_t volume)
+        {
+            SetField(0, 3, process);
+            SetField(3, 3, volume < StepCode::kVolumes ? volume : kNoVolume);
+        }
+        void AddWlsConversion(std::uint8_t volume)
+        {
+            Increment(6, 4);
+            SetField(10, 3, volume < StepCode::kVolumes ? volume : kNoVolume);
+        }
+        void AddTotalInternalReflection() { Increment(13, 16); }
+        void AddReflection() { Increment(29, 16); }
+        void AddPath(std::uint8_t volume, G4double length)
+        {
+            if (volume == StepCode::kTile) tilePath += static_cast<float>(length);
+            else if (volume == StepCode::kFiberClad) cladPath += static_cast<float>(length);
+            else if (volume == StepCode::kFiberCore) corePath += static_cast<float>(length);
+        }
+
+    private:
+        std::uint32_t Field(G4int shift, G4int bits) const
+        {
+            return static_cast<std::uint32_t>((history >> shift) & ((std::uint64_t(1) << bits) - 1));
+        }
+        void SetField(G4int shift, G4int bits, std::uint64_t value)
+        {
+            const std::uint64_t mask = ((std::uint64_t(1) << bits) - 1) << shift;
+            history = (history & ~mask) | ((value << shift) & mask);
+        }
+        void Increment(G4int shift, G4int bits)
+        {
+            if (Field(shift, bits) != (std::uint64_t(1) << bits) - 1) history += std::uint64_t(1) << shift;
+        }
+    };
+}
+
+#endif
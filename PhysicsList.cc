@@ -1,4 +1,7 @@
 #include "PhysicsList.hh"
+#include "PhysicsMessenger.hh"
+#include "GeometrySnapshot.hh"
+#include "OpticalProfile.hh"
 
 // Standard EM Physics
 #include "G4EmStandardPhysics.hh"
@@ -17,33 +20,188 @@
 
 // Optical Physics
 #include "G4OpticalPhysics.hh"
-#include "G4OpticalParameters.hh"
 
 //#include "QGSP_BERT.hh"
 
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4StateManager.hh"
+#include "G4Threading.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 
 namespace G4_BREMS
 {
-    PhysicsList::PhysicsList() : G4VModularPhysicsList()
+    namespace {
+        G4VPhysicsConstructor* CreateEmPhysics(const G4String& name)
+        {
+            if (name == "standard") return new G4EmStandardPhysics();
+            if (name == "option1") return new G4EmStandardPhysics_option1();
+            if (name == "option2") return new G4EmStandardPhysics_option2();
+            if (name == "option3") return new G4EmStandardPhysics_option3();
+            if (name == "option4") return new G4EmStandardPhysics_option4();
+            if (name == "livermore") return new G4EmLivermorePhysics();
+            if (name == "penelope") return new G4EmPenelopePhysics();
+            if (name == "wvi") return new G4EmStandardPhysicsWVI();
+            if (name == "ss") return new G4EmStandardPhysicsSS();
+            if (name == "gs") return new G4EmStandardPhysicsGS();
+            return nullptr;
+        }
+
+        // Production cuts of a region created by DetectorConstruction; negative keeps the world cuts
+        void ApplyRegionCut(const G4String& name, G4double cut)
+        {
+            if (cut < 0.) return;
+            G4Region* region = G4RegionStore::GetInstance()->GetRegion(name, false);
+            if (!region) {
+                G4ExceptionDescription msg;
+                msg << "Region " << name << " not found, its production cut is ignored";
+                G4Exception("PhysicsList::SetCuts()", "Physics_W001", JustWarning, msg);
+                return;
+            }
+            G4ProductionCuts* cuts = region->GetProductionCuts();
+            if (!cuts) {
+                cuts = new G4ProductionCuts();
+                region->SetProductionCuts(cuts);
+            }
+            cuts->SetProductionCut(cut);
+        }
+
+        std::uint64_t Fnv1a(const std::string& text)
+        {
+            std::uint64_t hash = 14695981039346656037ULL;
+            for (unsigned char c : text) {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+    }
+
+    PhysicsList::PhysicsList() : G4VModularPhysicsList(),
+        fEmName("none"), fWorldCut(GetDefaultCutValue()), fTileCut(-1.), fFiberCut(-1.), fSipmCut(-1.),
+        fTablesRetrieved(false), fTablesStored(false), fMessenger(nullptr)
     {
 
         
         
         G4OpticalPhysics* opticalPhysics = new G4OpticalPhysics();
 
-        auto opticalParams = G4OpticalParameters::Instance();
-        opticalParams->SetWLSTimeProfile("delta");
-        opticalParams->SetProcessActivation("OpWLS", true);
+        // WLS delta time profile, all optical processes active
+        SetOpticalProfile("full");
         
         RegisterPhysics(opticalPhysics);
 
+        // Without an EM constructor charged particles deposit no energy and only emit Cerenkov
+        // light; /snf/physics/em none restores that
+        SetEmPhysics("standard");
+
+        fMessenger = new PhysicsMessenger(this);
+    }
 
+    PhysicsList::~PhysicsList()
+    {
+        delete fMessenger;
+    }
 
-       
+    G4bool PhysicsList::SetEmPhysics(const G4String& name)
+    {
+        if (name == "none") {
+            RemovePhysics(bElectromagnetic);
+            fEmName = name;
+            return true;
+        }
+        G4VPhysicsConstructor* emPhysics = CreateEmPhysics(name);
+        if (!emPhysics) {
+            G4cerr << "Error: unknown EM physics '" << name << "'" << G4endl;
+            return false;
+        }
+        ReplacePhysics(emPhysics);
+        fEmName = name;
+        return true;
     }
 
-    
+    G4bool PhysicsList::SetOpticalProfile(const G4String& name)
+    {
+        return OpticalProfile::SetActive(name);
+    }
+
+    G4bool PhysicsList::SetRegionCut(const G4String& region, G4double cut)
+    {
+        if (region == "World") fWorldCut = cut;
+        else if (region == "Tiles") fTileCut = cut;
+        else if (region == "Fibers") fFiberCut = cut;
+        else if (region == "Sipms") fSipmCut = cut;
+        else return false;
+
+        // Between runs the cuts table picks the change up at the next /run/beamOn; tables retrieved
+        // for the old cuts must not be retrieved again, so the cache of the new configuration is
+        // used if it exists and the rebuilt tables are stored otherwise
+        fTablesStored = false;
+        if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle) {
+            if (region == "World") SetDefaultCutValue(cut);
+            else ApplyRegionCut(region, cut);
+            ResetPhysicsTableRetrieved();
+            fTablesRetrieved = false;
+            RetrieveTableCache();
+        }
+        return true;
+    }
+
+    G4String PhysicsList::ConfigurationKey() const
+    {
+        std::ostringstream key;
+        key << "geant4=" << G4VERSION_NUMBER << ";geometry=" << GeometrySnapshot::kGeometryRevision
+            << ";em=" << fEmName << ";cuts=" << fWorldCut / mm << "," << fTileCut / mm << ","
+            << fFiberCut / mm << "," << fSipmCut / mm;
+        return key.str();
+    }
+
+    G4String PhysicsList::TableCachePath() const
+    {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(Fnv1a(ConfigurationKey())));
+        return fTableCache + "/" + hash;
+    }
+
+    void PhysicsList::RetrieveTableCache()
+    {
+        if (fTableCache.empty()) return;
+        const G4String path = TableCachePath();
+        if (std::filesystem::exists((path + "/configuration.txt").c_str())) {
+            SetPhysicsTableRetrieved(path);
+            fTablesRetrieved = true;
+            G4cout << "Retrieving physics tables from " << path << G4endl;
+        }
+    }
+
+    void PhysicsList::StoreTableCache()
+    {
+        if (fTableCache.empty() || fTablesRetrieved || fTablesStored) return;
+        fTablesStored = true;
+
+        const G4String path = TableCachePath();
+        std::error_code error;
+        std::filesystem::create_directories(path.c_str(), error);
+        if (error || !StorePhysicsTable(path)) {
+            G4ExceptionDescription msg;
+            msg << "Could not store the physics tables in " << path;
+            G4Exception("PhysicsList::StoreTableCache()", "Physics_W002", JustWarning, msg);
+            return;
+        }
+
+        // Written last: marks the directory as complete
+        std::ofstream configuration(path + "/configuration.txt");
+        configuration << ConfigurationKey() << std::endl;
+        G4cout << "Physics tables stored in " << path << G4endl;
+    }
 
     void PhysicsList::ConstructParticle()
     {
@@ -55,5 +213,19 @@ namespace G4_BREMS
         G4VModularPhysicsList::ConstructProcess();
     }
 
+    void PhysicsList::SetCuts()
+    {
+        SetDefaultCutValue(fWorldCut);
+        G4VModularPhysicsList::SetCuts();
+
+        // Regions and tables are shared with the workers
+        if (!G4Threading::IsMasterThread()) return;
+
+        ApplyRegionCut("Tiles", fTileCut);
+        ApplyRegionCut("Fibers", fFiberCut);
+        ApplyRegionCut("Sipms", fSipmCut);
+        RetrieveTableCache();
+    }
+
 
 }
\ No newline at end of file
@@ -6,16 +6,54 @@
 
 namespace G4_BREMS
 {
+	class PhysicsMessenger;
+
+	// Optical physics configured by a named profile plus an EM constructor chosen before
+	// /run/initialize, with production cuts per detector region and an optional on-disk cache
+	// of the built physics tables
 	class PhysicsList : public G4VModularPhysicsList
 	{
 	public:
 		PhysicsList();
-		virtual ~PhysicsList() override = default;
+		virtual ~PhysicsList() override;
 
 		// Mandatory methods to override;
 		virtual void ConstructParticle() override;
 		virtual void ConstructProcess() override;
+		virtual void SetCuts() override;
+
+		// none, standard, option1..option4, livermore, penelope, wvi, ss or gs; false if unknown
+		G4bool SetEmPhysics(const G4String& name);
+		const G4String& GetEmPhysics() const { return fEmName; }
+
+		// production, wls-study or full (default), see OpticalProfile; false if unknown
+		G4bool SetOpticalProfile(const G4String& name);
+
+		// Region names as created by DetectorConstruction: World, Tiles, Fibers, Sipms
+		G4bool SetRegionCut(const G4String& region, G4double cut);
+
+		// Tables are kept in <directory>/<hash of the configuration>
+		void SetTableCache(const G4String& directory) { fTableCache = directory; }
+		// Writes the tables after the first build; called by the master at the start of a run
+		void StoreTableCache();
+
+	private:
+		G4String ConfigurationKey() const;
+		G4String TableCachePath() const;
+		// Points the next table build at the cache of the current configuration, if it exists
+		void RetrieveTableCache();
+
+		G4String fEmName;
+		G4double fWorldCut;
+		G4double fTileCut;
+		G4double fFiberCut;
+		G4double fSipmCut;
+
+		G4String fTableCache;
+		G4bool fTablesRetrieved;
+		G4bool fTablesStored;
 
+		PhysicsMessenger* fMessenger;
 	};
 }
 
@@ -0,0 +1,162 @@
+
+#include "PhysicsMessenger.hh"
+#include "PhysicsList.hh"
+#include "OpticalProfile.hh"
+#include "OutputPaths.hh"
+#include "SteppingAction.hh"
+#include "ChannelHistograms.hh"
+#include "G4RunManager.hh"
+#include "G4Timer.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include <iomanip>
+
+namespace G4_BREMS {
+
+    namespace {
+        G4UIcmdWithADoubleAndUnit* CreateCutCommand(const G4String& path, const G4String& region,
+            G4UImessenger* messenger)
+        {
+            auto* command = new G4UIcmdWithADoubleAndUnit(path, messenger);
+            G4String guidance = "Production cut of the " + region + " region (gamma, e-, e+, proton).";
+            command->SetGuidance(guidance.c_str());
+            command->SetParameterName("cut", false);
+            command->SetRange("cut > 0");
+            command->SetUnitCategory("Length");
+            command->SetDefaultUnit("mm");
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+            return command;
+        }
+    }
+
+    PhysicsMessenger::PhysicsMessenger(PhysicsList* physicsList)
+        : G4UImessenger(), fPhysicsList(physicsList)
+    {
+        fPhysicsDirectory = new G4UIdirectory("/snf/physics/", false);
+        fPhysicsDirectory->SetGuidance("Optical profile, EM physics, production cuts and physics-table cache.");
+
+        fOpticalProfileCmd = new G4UIcmdWithAString("/snf/physics/opticalProfile", this);
+        fOpticalProfileCmd->SetGuidance("Optical process switches and region vetoes (default full).");
+        fOpticalProfileCmd->SetGuidance("  production: no Rayleigh/Mie, no Cerenkov or scintillation born in the SiPMs,");
+        fOpticalProfileCmd->SetGuidance("              no scintillation in the fibers, coarser Cerenkov steps");
+        fOpticalProfileCmd->SetGuidance("  wls-study:  exponential WLS time profile, no Rayleigh/Mie, no Cerenkov in the SiPMs");
+        fOpticalProfileCmd->SetGuidance("  full:       every optical process, WLS delta time profile");
+        fOpticalProfileCmd->SetParameterName("profile", false);
+        fOpticalProfileCmd->SetCandidates("production wls-study full");
+        fOpticalProfileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fOpticalProfileCmd->SetToBeBroadcasted(false);
+
+        fCompareProfilesCmd = new G4UIcmdWithAnInteger("/snf/physics/compareProfiles", this);
+        fCompareProfilesCmd->SetGuidance("Run the given number of events with every optical profile and print the");
+        fCompareProfilesCmd->SetGuidance("event-loop throughput and SiPM hits per event. Outputs are tagged profile_<name>.");
+        fCompareProfilesCmd->SetParameterName("events", false);
+        fCompareProfilesCmd->SetRange("events > 0");
+        fCompareProfilesCmd->AvailableForStates(G4State_Idle);
+        fCompareProfilesCmd->SetToBeBroadcasted(false);
+
+        fEmCmd = new G4UIcmdWithAString("/snf/physics/em", this);
+        fEmCmd->SetGuidance("EM constructor registered next to the optical physics (default standard).");
+        fEmCmd->SetParameterName("name", false);
+        fEmCmd->SetCandidates("none standard option1 option2 option3 option4 livermore penelope wvi ss gs");
+        fEmCmd->AvailableForStates(G4State_PreInit);
+        fEmCmd->SetToBeBroadcasted(false);
+
+        fWorldCutCmd = CreateCutCommand("/snf/physics/worldCut", "world (default)", this);
+        fTileCutCmd = CreateCutCommand("/snf/physics/tileCut", "Tiles", this);
+        fFiberCutCmd = CreateCutCommand("/snf/physics/fiberCut", "Fibers (core and cladding)", this);
+        fSipmCutCmd = CreateCutCommand("/snf/physics/sipmCut", "Sipms", this);
+
+        fTableCacheCmd = new G4UIcmdWithAString("/snf/physics/tableCache", this);
+        fTableCacheCmd->SetGuidance("Directory of stored physics tables, one subdirectory per configuration hash.");
+        fTableCacheCmd->SetGuidance("Tables are retrieved when present and stored after the first build otherwise.");
+        fTableCacheCmd->SetParameterName("directory", false);
+        fTableCacheCmd->AvailableForStates(G4State_PreInit);
+        fTableCacheCmd->SetToBeBroadcasted(false);
+    }
+
+    PhysicsMessenger::~PhysicsMessenger()
+    {
+        delete fOpticalProfileCmd;
+        delete fCompareProfilesCmd;
+        delete fEmCmd;
+        delete fWorldCutCmd;
+        delete fTileCutCmd;
+        delete fFiberCutCmd;
+        delete fSipmCutCmd;
+        delete fTableCacheCmd;
+        delete fPhysicsDirectory;
+    }
+
+    void PhysicsMessenger::CompareProfiles(G4int events)
+    {
+        struct Result {
+            G4String name;
+            G4double seconds;
+            G4double hitsPerEvent;
+        };
+        std::vector<Result> results;
+
+        const G4String baseTag = OutputPaths::GetTag();
+        const G4String startProfile = OpticalProfile::Active().name;
+        G4RunManager* runManager = G4RunManager::GetRunManager();
+
+        for (const auto& profile : OpticalProfile::All()) {
+            fPhysicsList->SetOpticalProfile(profile.name);
+            G4String tag = "profile_" + profile.name;
+            OutputPaths::SetTag(baseTag.empty() ? tag : baseTag + "_" + tag);
+
+            // Physics tables are rebuilt by an empty run so that only the event loop is timed
+            runManager->BeamOn(0);
+
+            G4Timer timer;
+            timer.Start();
+            runManager->BeamOn(events);
+            timer.Stop();
+            results.push_back({ profile.name, timer.GetRealElapsed(),
+                (ChannelHistograms::IsEnabled() ? ChannelHistograms::GetRunHits() : static_cast<G4double>(gSipmHits.size())) / events });
+        }
+
+        OutputPaths::SetTag(baseTag);
+        fPhysicsList->SetOpticalProfile(startProfile);
+
+        G4cout << "\nOptical profile comparison, " << events << " events each:" << G4endl;
+        G4cout << std::setw(12) << "profile" << std::setw(12) << "seconds" << std::setw(12) << "events/s"
+            << std::setw(14) << "hits/event" << G4endl;
+        for (const auto& result : results) {
+            G4cout << std::setw(12) << result.name << std::setw(12) << result.seconds << std::setw(12)
+                << (result.seconds > 0. ? events / result.seconds : 0.) << std::setw(14)
+                << result.hitsPerEvent << G4endl;
+        }
+    }
+
+    void PhysicsMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        if (command == fOpticalProfileCmd) {
+            fPhysicsList->SetOpticalProfile(newValue);
+        }
+        else if (command == fCompareProfilesCmd) {
+            CompareProfiles(fCompareProfilesCmd->GetNewIntValue(newValue));
+        }
+        else if (command == fEmCmd) {
+            fPhysicsList->SetEmPhysics(newValue);
+        }
+        else if (command == fWorldCutCmd) {
+            fPhysicsList->SetRegionCut("World", fWorldCutCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fTileCutCmd) {
+            fPhysicsList->SetRegionCut("Tiles", fTileCutCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fFiberCutCmd) {
+            fPhysicsList->SetRegionCut("Fibers", fFiberCutCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fSipmCutCmd) {
+            fPhysicsList->SetRegionCut("Sipms", fSipmCutCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fTableCacheCmd) {
+            fPhysicsList->SetTableCache(newValue);
+        }
+    }
+}
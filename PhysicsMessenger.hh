@@ -0,0 +1,45 @@
+
+#ifndef G4_BREMS_PHYSICS_MESSENGER_H
+#define G4_BREMS_PHYSICS_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithAnInteger;
+
+namespace G4_BREMS {
+    class PhysicsList;
+
+    // /snf/physics/: optical profile, EM constructor, per-region production cuts and the
+    // physics-table cache
+    class PhysicsMessenger : public G4UImessenger
+    {
+    public:
+        PhysicsMessenger(PhysicsList* physicsList);
+        ~PhysicsMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        // One run per optical profile with the same event count, then the starting profile is
+        // restored. Prints event-loop throughput and SiPM hits per event for each profile.
+        void CompareProfiles(G4int events);
+
+        PhysicsList* fPhysicsList;
+
+        G4UIdirectory* fPhysicsDirectory;
+        G4UIcmdWithAString* fOpticalProfileCmd;
+        G4UIcmdWithAnInteger* fCompareProfilesCmd;
+        G4UIcmdWithAString* fEmCmd;
+        G4UIcmdWithADoubleAndUnit* fWorldCutCmd;
+        G4UIcmdWithADoubleAndUnit* fTileCutCmd;
+        G4UIcmdWithADoubleAndUnit* fFiberCutCmd;
+        G4UIcmdWithADoubleAndUnit* fSipmCutCmd;
+        G4UIcmdWithAString* fTableCacheCmd;
+    };
+}
+
+#endif
@@ -1,17 +1,28 @@
 #include "PrimaryGeneratorAction.hh"
+#include "PrimaryGeneratorMessenger.hh"
+#include "EventSeeder.hh"
+#include "SobolSampler.hh"
+#include "ResponseMatrix.hh"
 
 #include "G4Event.hh"
 #include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4Threading.hh"
 
 #include "Randomize.hh"
+#include "G4PhysicalConstants.hh"
 
 #include "G4UnitsTable.hh"
 
 
 namespace G4_BREMS
 {
-	PrimaryGeneratorAction::PrimaryGeneratorAction() {
+	PrimaryGeneratorAction::PrimaryGeneratorAction()
+		: fMode("gun"), fSpectrum("reactor"), fFissionFractions{ 0.58, 0.07, 0.30, 0.05 },
+		fSpectrumChanged(true), fSampler("pseudo"), fReplicas(8), fCurrentReplica(-1),
+		fTileSampler("Tile"), fCosmicMinEnergy(0.), fCosmicMaxEnergy(10. * TeV), fCosmicChanged(true) {
 		// set up particle gun
 		G4int nParticles = 1;
 		fParticleGun = new G4ParticleGun(nParticles);
@@ -28,6 +39,9 @@ namespace G4_BREMS
 
 		// Set the particle type to the particle gun
 		fParticleGun->SetParticleDefinition(particle);
+		fPositron = particle;
+		fMuonPlus = particleTable->FindParticle("mu+");
+		fMuonMinus = particleTable->FindParticle("mu-");
 
 		
 		G4ThreeVector momentumDirection = G4ThreeVector(1, 0, 0);
@@ -42,18 +56,180 @@ namespace G4_BREMS
 
 		fParticleGun->SetParticleEnergy(energy);
 
+		fMessenger = new PrimaryGeneratorMessenger(this);
 	}
 
 	PrimaryGeneratorAction::~PrimaryGeneratorAction() {
+		delete fMessenger;
 		delete fParticleGun;
 	}
 
+	void PrimaryGeneratorAction::SetMode(const G4String& mode) {
+		if (mode == "gun" && fMode != "gun") {
+			// back to the fixed gun of the constructor
+			fParticleGun->SetParticleMomentumDirection(G4ThreeVector(1, 0, 0));
+			fParticleGun->SetParticleEnergy(10.0 * MeV);
+		}
+		// the cosmic mode picks the muon charge per event
+		if (mode != "cosmic" && fMode == "cosmic") fParticleGun->SetParticleDefinition(fPositron);
+		fMode = mode;
+	}
+
+	void PrimaryGeneratorAction::SetCosmicEnergyRange(G4double minEnergy, G4double maxEnergy) {
+		if (minEnergy < 0. || maxEnergy <= minEnergy) {
+			G4Exception("PrimaryGeneratorAction::SetCosmicEnergyRange()", "Gun_W002", JustWarning,
+				"Cosmic muon energy range is empty, keeping the previous one");
+			return;
+		}
+		fCosmicMinEnergy = minEnergy;
+		fCosmicMaxEnergy = maxEnergy;
+		fCosmicChanged = true;
+	}
+
+	void PrimaryGeneratorAction::SetSpectrum(const G4String& spectrum) {
+		fSpectrum = spectrum;
+		fSpectrumChanged = true;
+	}
+
+	void PrimaryGeneratorAction::SetFissionFractions(const IbdSpectrum::FissionFractions& fractions) {
+		G4double sum = 0.;
+		for (auto fraction : fractions) sum += fraction;
+		if (sum <= 0.) {
+			G4Exception("PrimaryGeneratorAction::SetFissionFractions()", "Gun_W001", JustWarning,
+				"Fission fractions sum to zero, keeping the previous ones");
+			return;
+		}
+		for (std::size_t i = 0; i < fractions.size(); i++) {
+			fFissionFractions[i] = fractions[i] / sum;
+		}
+		fSpectrumChanged = true;
+	}
+
+	void PrimaryGeneratorAction::BuildSpectrum() {
+		fSpectrumChanged = false;
+
+		std::vector<G4double> edges;
+		std::vector<G4double> weights;
+		if (!IbdSpectrum::Build(fSpectrum, fFissionFractions, edges, weights)) {
+			G4Exception("PrimaryGeneratorAction::BuildSpectrum()", "Gun_F001", FatalException,
+				("Unknown antineutrino spectrum " + fSpectrum).c_str());
+			return;
+		}
+		fPositronEnergy.Build(edges, weights);
+	}
+
+	void PrimaryGeneratorAction::GenerateIbd(G4int eventID) {
+		if (fSpectrumChanged) BuildSpectrum();
+
+		// u[0] energy, u[1..3] vertex, u[4..5] direction
+		G4double u[6];
+		DrawUniforms(eventID, 6, u);
+
+		// positron kinetic energy from the alias table, vertex inside a tile, isotropic
+		G4double energy = fPositronEnergy.Sample(u[0]);
+		G4ThreeVector position;
+		if (!fTileSampler.Sample(u[1], u[2], u[3], position)) {
+			// the few points in grooves and layer gaps are redrawn pseudo-randomly
+			position = fTileSampler.Sample();
+		}
+
+		fParticleGun->SetParticleEnergy(energy);
+		fParticleGun->SetParticlePosition(position);
+		SetIsotropicDirection(u[4], u[5]);
+	}
+
+	void PrimaryGeneratorAction::GenerateCosmic(G4int eventID) {
+		// the stack's box follows geometry changes, so the table is rebuilt when it moves
+		G4ThreeVector min, max;
+		if (!fTileSampler.GetBounds(min, max)) {
+			// without a target every event would fire whatever the gun last held
+			G4Exception("PrimaryGeneratorAction::GenerateCosmic()", "Gun_F002", FatalException,
+				"No tiles found for the bounding box of the layer stack; cosmic muons cannot be aimed.");
+			return;
+		}
+		if (fCosmicChanged || !fCosmicSampler.IsBuiltFor(min, max)) {
+			fCosmicSampler.Build(min, max, fCosmicMinEnergy, fCosmicMaxEnergy);
+			fCosmicChanged = false;
+			if (G4Threading::G4GetThreadId() <= 0) {
+				G4cout << "Cosmic muons: " << fCosmicSampler.GetRate() / hertz << " Hz through the layer stack box, "
+					<< "one event = " << 1. / fCosmicSampler.GetRate() / ms << " ms of exposure" << G4endl;
+			}
+		}
+
+		static_assert(CosmicMuonSampler::kUniforms <= SobolSampler::kDimensions, "one Sobol dimension per uniform");
+		G4double u[CosmicMuonSampler::kUniforms];
+		DrawUniforms(eventID, CosmicMuonSampler::kUniforms, u);
+		CosmicMuonSampler::Muon muon;
+		fCosmicSampler.Sample(u, muon);
+
+		fParticleGun->SetParticleDefinition(muon.positive ? fMuonPlus : fMuonMinus);
+		fParticleGun->SetParticleEnergy(muon.kineticEnergy);
+		fParticleGun->SetParticlePosition(muon.position);
+		fParticleGun->SetParticleMomentumDirection(muon.direction);
+	}
+
+	G4bool PrimaryGeneratorAction::UsesReplicas() const {
+		return fSampler == "sobol" && !ResponseMatrix::IsActive() && (fMode == "ibd" || fMode == "cosmic");
+	}
+
+	void PrimaryGeneratorAction::DrawUniforms(G4int eventID, G4int count, G4double* u) {
+		fCurrentReplica = -1;
+		if (fSampler == "sobol") {
+			// global event number, so shards and threads continue one sequence
+			std::uint64_t global = static_cast<std::uint64_t>(EventSeeder::GetEventOffset() + eventID);
+			fCurrentReplica = static_cast<G4int>(global % fReplicas);
+			auto point = static_cast<std::uint32_t>(global / fReplicas);
+			auto seed = static_cast<std::uint32_t>(EventSeeder::Mix(
+				static_cast<std::uint64_t>(EventSeeder::GetMasterSeed()) ^ (0xC0FFEEULL + fCurrentReplica)));
+			for (G4int i = 0; i < count; i++) u[i] = SobolSampler::Sample(point, i, seed);
+		}
+		else {
+			for (G4int i = 0; i < count; i++) u[i] = G4UniformRand();
+		}
+	}
+
+	void PrimaryGeneratorAction::GenerateResponsePoint(G4int eventID) {
+		// grid point from the event number, so every thread knows its point without bookkeeping
+		const ResponseGrid& grid = ResponseMatrix::Grid();
+		G4int point = ResponseMatrix::PointOfEvent(eventID);
+		if (point < 0) point = 0;
+		std::size_t positions = grid.positions.size();
+
+		fCurrentReplica = -1;
+		fParticleGun->SetParticleEnergy(grid.energies[point / positions]);
+		fParticleGun->SetParticlePosition(grid.positions[point % positions]);
+		SetIsotropicDirection(G4UniformRand(), G4UniformRand());
+	}
+
+	void PrimaryGeneratorAction::SetIsotropicDirection(G4double u0, G4double u1) {
+		G4double cosTheta = 2. * u0 - 1.;
+		G4double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+		G4double phi = twopi * u1;
+		fParticleGun->SetParticleMomentumDirection(
+			G4ThreeVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta));
+	}
+
 	void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
 	{
-		
-		G4ThreeVector position = G4ThreeVector(-200.0 * mm, 0 * mm, 0 * mm);
-		
-		fParticleGun->SetParticlePosition(position);
+		// first user hook of the event: reseed from (master seed, run, event)
+		const G4Run* run = G4RunManager::GetRunManager()->GetCurrentRun();
+		EventSeeder::SeedEvent(run ? run->GetRunID() : 0, event->GetEventID());
+
+		if (ResponseMatrix::IsActive()) {
+			GenerateResponsePoint(event->GetEventID());
+		}
+		else if (fMode == "ibd") {
+			GenerateIbd(event->GetEventID());
+		}
+		else if (fMode == "cosmic") {
+			GenerateCosmic(event->GetEventID());
+		}
+		else {
+			fCurrentReplica = -1;
+			G4ThreeVector position = G4ThreeVector(-200.0 * mm, 0 * mm, 0 * mm);
+
+			fParticleGun->SetParticlePosition(position);
+		}
 
 		fParticleGun->GeneratePrimaryVertex(event);
 	}
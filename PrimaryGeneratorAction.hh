@@ -7,11 +7,16 @@
 #include "globals.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleGun.hh"
+#include "AliasTable.hh"
+#include "IbdSpectrum.hh"
+#include "CosmicMuonSampler.hh"
+#include "TileSampler.hh"
 
 
 
 namespace G4_BREMS
 {
+	class PrimaryGeneratorMessenger;
 
 	class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 	{
@@ -21,7 +26,51 @@ namespace G4_BREMS
 
 		virtual void GeneratePrimaries(G4Event*);
 
+		// "gun" (default), "ibd" or "cosmic"
+		void SetMode(const G4String& mode);
+		void SetSpectrum(const G4String& spectrum);
+		void SetFissionFractions(const IbdSpectrum::FissionFractions& fractions);
+		// Kinetic energy range of the cosmic mode
+		void SetCosmicEnergyRange(G4double minEnergy, G4double maxEnergy);
+
+		// "pseudo" (default) or "sobol": scrambled Sobol points for the ibd and cosmic modes,
+		// spread round-robin over independently scrambled replicas
+		void SetSampler(const G4String& sampler) { fSampler = sampler; }
+		void SetReplicas(G4int replicas) { fReplicas = replicas; }
+		G4int GetReplicas() const { return fReplicas; }
+		// Whether events are dealt to replicas: Sobol points in the ibd or cosmic mode
+		G4bool UsesReplicas() const;
+		// Replica of the event being generated, -1 for pseudo-random events
+		G4int GetCurrentReplica() const { return fCurrentReplica; }
+
 		G4ParticleGun* fParticleGun;
+
+	private:
+		void GenerateIbd(G4int eventID);
+		void GenerateCosmic(G4int eventID);
+		// count uniforms of the event from the configured sampler, sets the current replica
+		void DrawUniforms(G4int eventID, G4int count, G4double* u);
+		void GenerateResponsePoint(G4int eventID);
+		void SetIsotropicDirection(G4double u0, G4double u1);
+		void BuildSpectrum();
+
+		G4String fMode;
+		G4String fSpectrum;
+		IbdSpectrum::FissionFractions fFissionFractions;
+		AliasTable fPositronEnergy;
+		G4bool fSpectrumChanged;
+		G4String fSampler;
+		G4int fReplicas;
+		G4int fCurrentReplica;
+		TileSampler fTileSampler;
+		CosmicMuonSampler fCosmicSampler;
+		G4double fCosmicMinEnergy;
+		G4double fCosmicMaxEnergy;
+		G4bool fCosmicChanged;
+		G4ParticleDefinition* fPositron;
+		G4ParticleDefinition* fMuonPlus;
+		G4ParticleDefinition* fMuonMinus;
+		PrimaryGeneratorMessenger* fMessenger;
 	};
 }
 
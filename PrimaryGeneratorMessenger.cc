@@ -0,0 +1,109 @@
+
+#include "PrimaryGeneratorMessenger.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "SobolSampler.hh"
+#include "G4UIparameter.hh"
+#include <sstream>
+
+namespace G4_BREMS {
+
+    PrimaryGeneratorMessenger::PrimaryGeneratorMessenger(PrimaryGeneratorAction* generator)
+        : G4UImessenger(), fGenerator(generator)
+    {
+        fGunDirectory = new G4UIdirectory("/snf/gun/");
+        fGunDirectory->SetGuidance("Primary generator control.");
+
+        fModeCmd = new G4UIcmdWithAString("/snf/gun/mode", this);
+        fModeCmd->SetGuidance("gun: the particle gun as configured (default 10 MeV e+ along +x).");
+        fModeCmd->SetGuidance("ibd: inverse beta decay positrons, energy from /snf/gun/spectrum,");
+        fModeCmd->SetGuidance("     vertex uniform inside the tiles, isotropic direction.");
+        fModeCmd->SetGuidance("cosmic: sea-level cosmic muons (Guan et al. parametrization), all aimed");
+        fModeCmd->SetGuidance("        at the box of the layer stack; the rate per event is printed.");
+        fModeCmd->SetParameterName("mode", false);
+        fModeCmd->SetCandidates("gun ibd cosmic");
+        fModeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+        fSpectrumCmd = new G4UIcmdWithAString("/snf/gun/spectrum", this);
+        fSpectrumCmd->SetGuidance("Antineutrino spectrum of the ibd mode: reactor, spentfuel or a csv file");
+        fSpectrumCmd->SetGuidance("with columns E_nu(MeV),flux. It is multiplied by the IBD cross section.");
+        fSpectrumCmd->SetParameterName("spectrum", false);
+        fSpectrumCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+        fFissionFractionsCmd = new G4UIcommand("/snf/gun/fissionFractions", this);
+        fFissionFractionsCmd->SetGuidance("Fission fractions of the reactor spectrum (normalised internally).");
+        const char* isotopes[] = { "U235", "U238", "Pu239", "Pu241" };
+        for (auto isotope : isotopes) {
+            auto parameter = new G4UIparameter(isotope, 'd', false);
+            parameter->SetParameterRange((G4String(isotope) + " >= 0").c_str());
+            fFissionFractionsCmd->SetParameter(parameter);
+        }
+        fFissionFractionsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+        fSamplerCmd = new G4UIcmdWithAString("/snf/gun/sampler", this);
+        fSamplerCmd->SetGuidance("pseudo: pseudo-random numbers for the ibd and cosmic modes.");
+        fSamplerCmd->SetGuidance("sobol: scrambled Sobol points; events are dealt round-robin to");
+        fSamplerCmd->SetGuidance("       /snf/gun/replicas independent scramblings for error estimates.");
+        fSamplerCmd->SetParameterName("sampler", false);
+        fSamplerCmd->SetCandidates("pseudo sobol");
+        fSamplerCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+        fReplicasCmd = new G4UIcmdWithAnInteger("/snf/gun/replicas", this);
+        fReplicasCmd->SetGuidance("Number of randomized Sobol replicas (default 8).");
+        fReplicasCmd->SetParameterName("replicas", false);
+        fReplicasCmd->SetRange(("replicas >= 1 && replicas <= " + std::to_string(SobolSampler::kMaxReplicas)).c_str());
+        fReplicasCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+        fCosmicEnergyCmd = new G4UIcommand("/snf/gun/cosmicEnergy", this);
+        fCosmicEnergyCmd->SetGuidance("Kinetic energy range of the cosmic mode (default 0 to 10 TeV).");
+        fCosmicEnergyCmd->SetParameter(new G4UIparameter("min", 'd', false));
+        fCosmicEnergyCmd->SetParameter(new G4UIparameter("max", 'd', false));
+        auto unit = new G4UIparameter("unit", 's', true);
+        unit->SetDefaultValue("GeV");
+        fCosmicEnergyCmd->SetParameter(unit);
+        fCosmicEnergyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    }
+
+    PrimaryGeneratorMessenger::~PrimaryGeneratorMessenger()
+    {
+        delete fModeCmd;
+        delete fSpectrumCmd;
+        delete fFissionFractionsCmd;
+        delete fSamplerCmd;
+        delete fReplicasCmd;
+        delete fCosmicEnergyCmd;
+        delete fGunDirectory;
+    }
+
+    void PrimaryGeneratorMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        if (command == fModeCmd) {
+            fGenerator->SetMode(newValue);
+        }
+        else if (command == fSpectrumCmd) {
+            fGenerator->SetSpectrum(newValue);
+        }
+        else if (command == fFissionFractionsCmd) {
+            IbdSpectrum::FissionFractions fractions{};
+            std::istringstream iss(newValue);
+            for (auto& fraction : fractions) iss >> fraction;
+            fGenerator->SetFissionFractions(fractions);
+        }
+        else if (command == fSamplerCmd) {
+            fGenerator->SetSampler(newValue);
+        }
+        else if (command == fReplicasCmd) {
+            fGenerator->SetReplicas(fReplicasCmd->GetNewIntValue(newValue));
+        }
+        else if (command == fCosmicEnergyCmd) {
+            G4double minEnergy = 0., maxEnergy = 0.;
+            G4String unit;
+            std::istringstream iss(newValue);
+            iss >> minEnergy >> maxEnergy >> unit;
+            G4double scale = G4UIcommand::ValueOf(unit);
+            fGenerator->SetCosmicEnergyRange(minEnergy * scale, maxEnergy * scale);
+        }
+    }
+}
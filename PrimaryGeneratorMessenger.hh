@@ -0,0 +1,37 @@
+
+#ifndef G4_BREMS_PRIMARY_GENERATOR_MESSENGER_H
+#define G4_BREMS_PRIMARY_GENERATOR_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+class G4UIcommand;
+
+namespace G4_BREMS {
+    class PrimaryGeneratorAction;
+
+    class PrimaryGeneratorMessenger : public G4UImessenger
+    {
+    public:
+        PrimaryGeneratorMessenger(PrimaryGeneratorAction* generator);
+        ~PrimaryGeneratorMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        PrimaryGeneratorAction* fGenerator;
+
+        G4UIdirectory* fGunDirectory;
+        G4UIcmdWithAString* fModeCmd;
+        G4UIcmdWithAString* fSpectrumCmd;
+        G4UIcommand* fFissionFractionsCmd;
+        G4UIcmdWithAString* fSamplerCmd;
+        G4UIcmdWithAnInteger* fReplicasCmd;
+        G4UIcommand* fCosmicEnergyCmd;
+    };
+}
+
+#endif
@@ -0,0 +1,72 @@
+
+#include "ReconstructionMessenger.hh"
+#include "EventReconstructor.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4SystemOfUnits.hh"
+
+namespace G4_BREMS {
+
+    ReconstructionMessenger::ReconstructionMessenger()
+        : G4UImessenger()
+    {
+        fRecoDirectory = new G4UIdirectory("/snf/reco/", false);
+        fRecoDirectory->SetGuidance("Vertex, energy and annihilation-topology reconstruction from the SiPM hits.");
+
+        fEnableCmd = new G4UIcmdWithABool("/snf/reco/enable", this);
+        fEnableCmd->SetGuidance("Reconstruct every triggered event; results go to reco_run<N>.csv.");
+        fEnableCmd->SetParameterName("enable", true);
+        fEnableCmd->SetDefaultValue(true);
+
+        fLightYieldCmd = new G4UIcmdWithADouble("/snf/reco/lightYield", this);
+        fLightYieldCmd->SetGuidance("Photoelectrons per MeV deposited, for the energy (default 100).");
+        fLightYieldCmd->SetParameterName("yield", false);
+        fLightYieldCmd->SetRange("yield > 0");
+
+        fShareLengthCmd = new G4UIcmdWithADoubleAndUnit("/snf/reco/shareLength", this);
+        fShareLengthCmd->SetGuidance("Decay length of the light shared with grooves away from the vertex (default 40 mm).");
+        fShareLengthCmd->SetParameterName("length", false);
+        fShareLengthCmd->SetRange("length > 0");
+        fShareLengthCmd->SetUnitCategory("Length");
+        fShareLengthCmd->SetDefaultUnit("mm");
+
+        fClusterThresholdCmd = new G4UIcmdWithADouble("/snf/reco/clusterThreshold", this);
+        fClusterThresholdCmd->SetGuidance("Photoelectrons for a layer outside the vertex to count as a gamma cluster (default 3).");
+        fClusterThresholdCmd->SetParameterName("photoelectrons", false);
+        fClusterThresholdCmd->SetRange("photoelectrons >= 0");
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fEnableCmd, fLightYieldCmd, fShareLengthCmd,
+            fClusterThresholdCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+    }
+
+    ReconstructionMessenger::~ReconstructionMessenger()
+    {
+        delete fEnableCmd;
+        delete fLightYieldCmd;
+        delete fShareLengthCmd;
+        delete fClusterThresholdCmd;
+        delete fRecoDirectory;
+    }
+
+    void ReconstructionMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        ReconstructionParameters& parameters = EventReconstructor::Parameters();
+        if (command == fEnableCmd) {
+            parameters.enabled = fEnableCmd->GetNewBoolValue(newValue);
+        }
+        else if (command == fLightYieldCmd) {
+            parameters.fit.lightYield = fLightYieldCmd->GetNewDoubleValue(newValue);
+        }
+        else if (command == fShareLengthCmd) {
+            parameters.fit.shareLength = fShareLengthCmd->GetNewDoubleValue(newValue) / mm;
+        }
+        else if (command == fClusterThresholdCmd) {
+            parameters.fit.clusterThreshold = fClusterThresholdCmd->GetNewDoubleValue(newValue);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+
+#ifndef G4_BREMS_RECONSTRUCTION_MESSENGER_H
+#define G4_BREMS_RECONSTRUCTION_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithADouble;
+class G4UIcmdWithADoubleAndUnit;
+
+namespace G4_BREMS {
+
+    // /snf/reco/: vertex and energy reconstruction (master only, see EventReconstructor)
+    class ReconstructionMessenger : public G4UImessenger
+    {
+    public:
+        ReconstructionMessenger();
+        ~ReconstructionMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fRecoDirectory;
+        G4UIcmdWithABool* fEnableCmd;
+        G4UIcmdWithADouble* fLightYieldCmd;
+        G4UIcmdWithADoubleAndUnit* fShareLengthCmd;
+        G4UIcmdWithADouble* fClusterThresholdCmd;
+    };
+}
+
+#endif
@@ -0,0 +1,152 @@
+
+#include "ResponseMatrix.hh"
+#include "SipmChannel.hh"
+#include "OutputPaths.hh"
+#include "G4AccumulableManager.hh"
+#include "G4SystemOfUnits.hh"
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace G4_BREMS {
+
+    ResponseGrid ResponseMatrix::fGrid;
+    G4bool ResponseMatrix::fActive = false;
+    G4String ResponseMatrix::fOutputFile;
+
+    namespace {
+        const char kResponseMagic[8] = { 'S', 'N', 'F', 'R', 'E', 'S', 'P', '1' };
+
+        template <typename T>
+        void WriteValue(std::ofstream& out, const T& value) {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    ResponseMatrix::ResponseMatrix()
+        : fEvents("ResponseEvents"), fHitEvents("ResponseHitEvents"), fSumPe("ResponseSumPe"),
+        fSumPe2("ResponseSumPe2"), fPeHist("ResponsePeHist"), fTimeHist("ResponseTimeHist")
+    {
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(&fEvents);
+        accumulableManager->RegisterAccumulable(&fHitEvents);
+        accumulableManager->RegisterAccumulable(&fSumPe);
+        accumulableManager->RegisterAccumulable(&fSumPe2);
+        accumulableManager->RegisterAccumulable(&fPeHist);
+        accumulableManager->RegisterAccumulable(&fTimeHist);
+    }
+
+    G4String ResponseMatrix::GetOutputFile()
+    {
+        if (!fOutputFile.empty()) return fOutputFile;
+        return OutputPaths::ResponseMatrixName();
+    }
+
+    G4int ResponseMatrix::PointOfEvent(G4int eventID)
+    {
+        if (fGrid.eventsPerPoint <= 0) return -1;
+        std::size_t point = static_cast<std::size_t>(eventID / fGrid.eventsPerPoint);
+        return (point < fGrid.NumberOfPoints()) ? static_cast<G4int>(point) : -1;
+    }
+
+    void ResponseMatrix::BeginOfRun()
+    {
+        // Outside response runs the arrays stay empty and cost nothing
+        std::size_t points = fActive ? fGrid.NumberOfPoints() : 0;
+        std::size_t cells = points * SipmChannel::kChannels;
+        fEvents.Resize(points);
+        fHitEvents.Resize(cells);
+        fSumPe.Resize(cells);
+        fSumPe2.Resize(cells);
+        fPeHist.Resize(cells * fGrid.peBins);
+        fTimeHist.Resize(cells * fGrid.timeBins);
+    }
+
+    void ResponseMatrix::AddEvent(G4int eventID, const std::vector<SipmHit>& hits)
+    {
+        G4int point = PointOfEvent(eventID);
+        if (point < 0 || fEvents.size() == 0) return;
+
+        std::array<std::uint32_t, SipmChannel::kChannels> pe{};
+        std::array<G4double, SipmChannel::kChannels> firstTime;
+        firstTime.fill(std::numeric_limits<G4double>::max());
+        for (const auto& hit : hits) {
+            if (hit.sipmID < 0 || hit.sipmID >= SipmChannel::kChannels) continue;
+            pe[hit.sipmID]++;
+            if (hit.time < firstTime[hit.sipmID]) firstTime[hit.sipmID] = hit.time;
+        }
+
+        fEvents[point]++;
+        const std::size_t base = static_cast<std::size_t>(point) * SipmChannel::kChannels;
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            const std::size_t cell = base + channel;
+            const G4double n = pe[channel];
+            fSumPe[cell] += n;
+            fSumPe2[cell] += n * n;
+
+            G4int peBin = std::min<G4int>(pe[channel], fGrid.peBins - 1);
+            fPeHist[cell * fGrid.peBins + peBin]++;
+            if (pe[channel] == 0) continue;
+
+            fHitEvents[cell]++;
+            G4int timeBin = static_cast<G4int>(firstTime[channel] / ns / fGrid.timeMax * fGrid.timeBins);
+            if (timeBin >= 0 && timeBin < fGrid.timeBins) {
+                fTimeHist[cell * fGrid.timeBins + timeBin]++;
+            }
+        }
+    }
+
+    G4bool ResponseMatrix::Write(const G4String& path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return false;
+        }
+
+        const std::uint32_t channels = SipmChannel::kChannels;
+        const std::uint32_t peBins = fGrid.peBins;
+        const std::uint32_t timeBins = fGrid.timeBins;
+        const std::size_t points = fGrid.NumberOfPoints();
+
+        out.write(kResponseMagic, sizeof(kResponseMagic));
+        WriteValue(out, channels);
+        WriteValue(out, static_cast<std::uint32_t>(fGrid.energies.size()));
+        WriteValue(out, static_cast<std::uint32_t>(fGrid.positions.size()));
+        WriteValue(out, peBins);
+        WriteValue(out, timeBins);
+        WriteValue(out, fGrid.timeMax);
+        for (auto energy : fGrid.energies) WriteValue(out, energy / MeV);
+        for (const auto& position : fGrid.positions) {
+            WriteValue(out, position.x() / mm);
+            WriteValue(out, position.y() / mm);
+            WriteValue(out, position.z() / mm);
+        }
+
+        const std::uint64_t blockSize = channels * (3 * sizeof(float) + (peBins + timeBins) * sizeof(std::uint32_t));
+        const std::uint64_t firstBlock = static_cast<std::uint64_t>(out.tellp()) + points * 2 * sizeof(std::uint64_t);
+        for (std::size_t point = 0; point < points; point++) {
+            WriteValue(out, firstBlock + point * blockSize);
+            WriteValue(out, static_cast<std::uint64_t>(fEvents[point]));
+        }
+
+        for (std::size_t point = 0; point < points; point++) {
+            const G4double events = fEvents[point];
+            for (std::uint32_t channel = 0; channel < channels; channel++) {
+                const std::size_t cell = point * channels + channel;
+                G4double mean = (events > 0) ? fSumPe[cell] / events : 0.;
+                G4double variance = (events > 0) ? fSumPe2[cell] / events - mean * mean : 0.;
+                WriteValue(out, static_cast<float>(mean));
+                WriteValue(out, static_cast<float>(std::sqrt(std::max(0., variance))));
+                WriteValue(out, static_cast<float>((events > 0) ? fHitEvents[cell] / events : 0.));
+                out.write(reinterpret_cast<const char*>(fPeHist.data() + cell * peBins), peBins * sizeof(std::uint32_t));
+                out.write(reinterpret_cast<const char*>(fTimeHist.data() + cell * timeBins), timeBins * sizeof(std::uint32_t));
+            }
+        }
+
+        G4cout << "Wrote response matrix of " << fGrid.energies.size() << " energies x "
+            << fGrid.positions.size() << " positions x " << channels << " channels to " << path << G4endl;
+        return static_cast<G4bool>(out);
+    }
+}
@@ -0,0 +1,71 @@
+
+#ifndef G4_BREMS_RESPONSE_MATRIX_H
+#define G4_BREMS_RESPONSE_MATRIX_H 1
+
+#include "ArrayAccumulable.hh"
+#include "SteppingAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Grid swept by the response-matrix mode: every (energy, position) pair is a grid point,
+    // point = energy index * positions + position index, simulated with eventsPerPoint
+    // isotropic positrons. Configured on the master by ResponseMessenger between runs.
+    struct ResponseGrid {
+        std::vector<G4double> energies;
+        std::vector<G4ThreeVector> positions;
+        G4int eventsPerPoint = 1000;
+        G4int peBins = 32;           // photoelectrons per event 0 .. peBins-2, last bin overflow
+        G4int timeBins = 32;         // first photon time per event in [0, timeMax)
+        G4double timeMax = 100.0;    // ns
+
+        std::size_t NumberOfPoints() const { return energies.size() * positions.size(); }
+    };
+
+    // Per-thread response tallies, owned by RunAction. For every grid point and channel:
+    // events with at least one photon, sum and sum of squares of photoelectrons, the
+    // photoelectron histogram and the first-photon time histogram.
+    //
+    // File layout (little endian), one index entry per point so analysis can seek:
+    //   char[8] "SNFRESP1", uint32 channels, energies, positions, peBins, timeBins,
+    //   double timeMax(ns), double energies[MeV], double positions[3][mm],
+    //   { uint64 offset, uint64 events } per point,
+    //   per point, per channel: float meanPe, float rmsPe, float hitFraction,
+    //                           uint32 peHist[peBins], uint32 timeHist[timeBins]
+    class ResponseMatrix
+    {
+    public:
+        ResponseMatrix();
+        ~ResponseMatrix() = default;
+
+        static ResponseGrid& Grid() { return fGrid; }
+        static G4bool IsActive() { return fActive; }
+        static void SetActive(G4bool active) { fActive = active; }
+        static void SetOutputFile(const G4String& path) { fOutputFile = path; }
+        static G4String GetOutputFile();
+
+        // Point of an event of the response run, -1 outside the grid
+        static G4int PointOfEvent(G4int eventID);
+
+        void BeginOfRun();
+        void AddEvent(G4int eventID, const std::vector<SipmHit>& hits);
+        G4bool Write(const G4String& path) const;
+
+    private:
+        static ResponseGrid fGrid;
+        static G4bool fActive;
+        static G4String fOutputFile;
+
+        ArrayAccumulable<std::uint32_t> fEvents;     // [point]
+        ArrayAccumulable<std::uint32_t> fHitEvents;  // [point][channel]
+        ArrayAccumulable<G4double> fSumPe;           // [point][channel]
+        ArrayAccumulable<G4double> fSumPe2;          // [point][channel]
+        ArrayAccumulable<std::uint32_t> fPeHist;     // [point][channel][peBins]
+        ArrayAccumulable<std::uint32_t> fTimeHist;   // [point][channel][timeBins]
+    };
+}
+
+#endif
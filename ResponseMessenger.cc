@@ -0,0 +1,186 @@
+
+#include "ResponseMessenger.hh"
+#include "ResponseMatrix.hh"
+#include "G4RunManager.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWith3VectorAndUnit.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace G4_BREMS {
+
+    ResponseMessenger::ResponseMessenger()
+        : G4UImessenger()
+    {
+        fResponseDirectory = new G4UIdirectory("/snf/response/", false);
+        fResponseDirectory->SetGuidance("Response-matrix mode: sweep positron energies x positions in one run.");
+
+        fEnergiesCmd = new G4UIcmdWithAString("/snf/response/energies", this);
+        fEnergiesCmd->SetGuidance("Positron kinetic energies in MeV, separated by blanks or commas.");
+        fEnergiesCmd->SetParameterName("energies", false);
+        fEnergiesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fEnergiesCmd->SetToBeBroadcasted(false);
+
+        fAddPositionCmd = new G4UIcmdWith3VectorAndUnit("/snf/response/addPosition", this);
+        fAddPositionCmd->SetGuidance("Add a vertex position to the grid.");
+        fAddPositionCmd->SetParameterName("x", "y", "z", false);
+        fAddPositionCmd->SetDefaultUnit("mm");
+        fAddPositionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fAddPositionCmd->SetToBeBroadcasted(false);
+
+        fPositionFileCmd = new G4UIcmdWithAString("/snf/response/positionFile", this);
+        fPositionFileCmd->SetGuidance("Add the vertex positions of a file, one 'x y z' (mm) per line.");
+        fPositionFileCmd->SetParameterName("file", false);
+        fPositionFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fPositionFileCmd->SetToBeBroadcasted(false);
+
+        fClearPositionsCmd = new G4UIcmdWithoutParameter("/snf/response/clearPositions", this);
+        fClearPositionsCmd->SetGuidance("Remove all grid positions.");
+        fClearPositionsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fClearPositionsCmd->SetToBeBroadcasted(false);
+
+        fEventsPerPointCmd = new G4UIcmdWithAnInteger("/snf/response/eventsPerPoint", this);
+        fEventsPerPointCmd->SetGuidance("Isotropic positrons simulated per grid point (default 1000).");
+        fEventsPerPointCmd->SetParameterName("events", false);
+        fEventsPerPointCmd->SetRange("events > 0");
+        fEventsPerPointCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fEventsPerPointCmd->SetToBeBroadcasted(false);
+
+        fPeBinsCmd = new G4UIcmdWithAnInteger("/snf/response/peBins", this);
+        fPeBinsCmd->SetGuidance("Bins of the per-channel photoelectron histogram, last one is overflow (default 32).");
+        fPeBinsCmd->SetParameterName("bins", false);
+        fPeBinsCmd->SetRange("bins > 1");
+        fPeBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fPeBinsCmd->SetToBeBroadcasted(false);
+
+        fTimeBinsCmd = new G4UIcmdWithAnInteger("/snf/response/timeBins", this);
+        fTimeBinsCmd->SetGuidance("Bins of the per-channel first-photon time histogram (default 32).");
+        fTimeBinsCmd->SetParameterName("bins", false);
+        fTimeBinsCmd->SetRange("bins > 0");
+        fTimeBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fTimeBinsCmd->SetToBeBroadcasted(false);
+
+        fTimeMaxCmd = new G4UIcmdWithADoubleAndUnit("/snf/response/timeMax", this);
+        fTimeMaxCmd->SetGuidance("Upper edge of the first-photon time histogram (default 100 ns).");
+        fTimeMaxCmd->SetParameterName("time", false);
+        fTimeMaxCmd->SetDefaultUnit("ns");
+        fTimeMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fTimeMaxCmd->SetToBeBroadcasted(false);
+
+        fOutputCmd = new G4UIcmdWithAString("/snf/response/output", this);
+        fOutputCmd->SetGuidance("Binary response file (default response_matrix.bin or <stem>_response_matrix.bin).");
+        fOutputCmd->SetParameterName("file", false);
+        fOutputCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+        fOutputCmd->SetToBeBroadcasted(false);
+
+        fRunCmd = new G4UIcmdWithoutParameter("/snf/response/run", this);
+        fRunCmd->SetGuidance("Simulate every grid point in one run and write the response file.");
+        fRunCmd->AvailableForStates(G4State_Idle);
+        fRunCmd->SetToBeBroadcasted(false);
+    }
+
+    ResponseMessenger::~ResponseMessenger()
+    {
+        delete fEnergiesCmd;
+        delete fAddPositionCmd;
+        delete fPositionFileCmd;
+        delete fClearPositionsCmd;
+        delete fEventsPerPointCmd;
+        delete fPeBinsCmd;
+        delete fTimeBinsCmd;
+        delete fTimeMaxCmd;
+        delete fOutputCmd;
+        delete fRunCmd;
+        delete fResponseDirectory;
+    }
+
+    G4bool ResponseMessenger::ReadPositionFile(const G4String& path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            G4cerr << "Error: Could not open " << path << G4endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream iss(line);
+            G4double x, y, z;
+            if (iss >> x >> y >> z) {
+                ResponseMatrix::Grid().positions.emplace_back(x * mm, y * mm, z * mm);
+            }
+        }
+        return true;
+    }
+
+    void ResponseMessenger::Run()
+    {
+        auto& grid = ResponseMatrix::Grid();
+        if (grid.NumberOfPoints() == 0) {
+            G4Exception("ResponseMessenger::Run()", "Response_W001", JustWarning,
+                "Response grid is empty, set /snf/response/energies and positions first");
+            return;
+        }
+        G4double events = static_cast<G4double>(grid.NumberOfPoints()) * grid.eventsPerPoint;
+        if (events > std::numeric_limits<G4int>::max()) {
+            G4Exception("ResponseMessenger::Run()", "Response_W002", JustWarning,
+                "Response grid needs more events than one run can hold, reduce eventsPerPoint");
+            return;
+        }
+
+        G4cout << "Response matrix: " << grid.energies.size() << " energies x " << grid.positions.size()
+            << " positions x " << grid.eventsPerPoint << " events" << G4endl;
+
+        // The generator and the run action switch to the grid while the flag is set
+        ResponseMatrix::SetActive(true);
+        G4RunManager::GetRunManager()->BeamOn(static_cast<G4int>(events));
+        ResponseMatrix::SetActive(false);
+    }
+
+    void ResponseMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        auto& grid = ResponseMatrix::Grid();
+        if (command == fEnergiesCmd) {
+            grid.energies.clear();
+            std::replace(newValue.begin(), newValue.end(), ',', ' ');
+            std::istringstream iss(newValue);
+            G4double energy;
+            while (iss >> energy) grid.energies.push_back(energy * MeV);
+        }
+        else if (command == fAddPositionCmd) {
+            grid.positions.push_back(fAddPositionCmd->GetNew3VectorValue(newValue));
+        }
+        else if (command == fPositionFileCmd) {
+            ReadPositionFile(newValue);
+        }
+        else if (command == fClearPositionsCmd) {
+            grid.positions.clear();
+        }
+        else if (command == fEventsPerPointCmd) {
+            grid.eventsPerPoint = fEventsPerPointCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fPeBinsCmd) {
+            grid.peBins = fPeBinsCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fTimeBinsCmd) {
+            grid.timeBins = fTimeBinsCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fTimeMaxCmd) {
+            grid.timeMax = fTimeMaxCmd->GetNewDoubleValue(newValue) / ns;
+        }
+        else if (command == fOutputCmd) {
+            ResponseMatrix::SetOutputFile(newValue);
+        }
+        else if (command == fRunCmd) {
+            Run();
+        }
+    }
+}
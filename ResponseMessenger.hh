@@ -0,0 +1,44 @@
+
+#ifndef G4_BREMS_RESPONSE_MESSENGER_H
+#define G4_BREMS_RESPONSE_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWith3VectorAndUnit;
+class G4UIcmdWithoutParameter;
+
+namespace G4_BREMS {
+
+    // /snf/response/: grid and output of the response-matrix mode (master only, see ResponseMatrix)
+    class ResponseMessenger : public G4UImessenger
+    {
+    public:
+        ResponseMessenger();
+        ~ResponseMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4bool ReadPositionFile(const G4String& path);
+        void Run();
+
+        G4UIdirectory* fResponseDirectory;
+        G4UIcmdWithAString* fEnergiesCmd;
+        G4UIcmdWith3VectorAndUnit* fAddPositionCmd;
+        G4UIcmdWithAString* fPositionFileCmd;
+        G4UIcmdWithoutParameter* fClearPositionsCmd;
+        G4UIcmdWithAnInteger* fEventsPerPointCmd;
+        G4UIcmdWithAnInteger* fPeBinsCmd;
+        G4UIcmdWithAnInteger* fTimeBinsCmd;
+        G4UIcmdWithADoubleAndUnit* fTimeMaxCmd;
+        G4UIcmdWithAString* fOutputCmd;
+        G4UIcmdWithoutParameter* fRunCmd;
+    };
+}
+
+#endif
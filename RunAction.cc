@@ -1,534 +1,600 @@
-
-#include "RunAction.hh"
-#include "SteppingAction.hh"
-#include "G4Run.hh"
-#include "G4RunManager.hh"
-#include "G4UnitsTable.hh"
-#include "G4SystemOfUnits.hh"
-#include "G4Threading.hh"
-#include "G4AnalysisManager.hh"
-#include "G4AccumulableManager.hh"
-#include <iomanip>
-#include <string>
-#include <fstream>
-
-namespace G4_BREMS {
-
-    G4_BREMS::RunAction::RunAction(SteppingAction* steppingAction)
-        : G4UserRunAction(),
-        fTileCount(0), fCladCount(0), fCoreCount(0), fSipmCount(0), fOtherCount(0),
-        fPhotonsEnteredFiber(0), fPhotonsExitedFiber(0), fPhotonsAbsorbedFiber(0),
-        fAccTileCount("TileCount", 0),
-        fAccCladCount("CladCount", 0),
-        fAccCoreCount("CoreCount", 0),
-        fAccSipmCount("SipmCount", 0),
-        fAccOtherCount("OtherCount", 0),
-        fAccPhotonsEnteredFiber("PhotonsEnteredFiber", 0),
-        fAccPhotonsExitedFiber("PhotonsExitedFiber", 0),
-        fAccPhotonsAbsorbedFiber("PhotonsAbsorbedFiber", 0),
-        fSteppingAction(steppingAction)
-    {
-        std::vector<G4String> volumes = { "Tile", "FiberCore", "FiberClad", "Sipm" };
-        for (const auto& volume : volumes) {
-            // Creation process accumulables
-            auto name = volume + "_Creation_Cerenkov";
-            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
-            name = volume + "_Creation_Scintillation";
-            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
-            name = volume + "_Creation_OpWLS";
-            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
-
-            // Interaction process accumulables
-            name = volume + "_Interaction_OpAbsorption";
-            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
-            name = volume + "_Interaction_OpWLS";
-            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
-            name = volume + "_Interaction_Transportation";
-            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
-        }
-
-        // Register all accumulables
-        auto accumulableManager = G4AccumulableManager::Instance();
-        accumulableManager->RegisterAccumulable(fAccTileCount);
-        accumulableManager->RegisterAccumulable(fAccCladCount);
-        accumulableManager->RegisterAccumulable(fAccCoreCount);
-        accumulableManager->RegisterAccumulable(fAccSipmCount);
-        accumulableManager->RegisterAccumulable(fAccOtherCount);
-        accumulableManager->RegisterAccumulable(fAccPhotonsEnteredFiber);
-        accumulableManager->RegisterAccumulable(fAccPhotonsExitedFiber);
-        accumulableManager->RegisterAccumulable(fAccPhotonsAbsorbedFiber);
-
-
-        // Register process accumulables
-        for (auto& pair : fAccCreationCounts) {
-            accumulableManager->RegisterAccumulable(*pair.second);
-        }
-        for (auto& pair : fAccInteractionCounts) {
-            accumulableManager->RegisterAccumulable(*pair.second);
-        }
-
-        auto analysisManager = G4AnalysisManager::Instance();
-        analysisManager->SetVerboseLevel(1);
-        analysisManager->SetFileName("OpticalPhotonAnalysis1");
-        analysisManager->SetDefaultFileType("root");
-        analysisManager->SetNtupleMerging(true);
-
-        // Create histograms
-        analysisManager->CreateH1("edep", "Energy Deposition Distribution",
-            100, 0., 2.0E-5 * CLHEP::MeV);
-        analysisManager->SetH1XAxisTitle(0, "Energy Deposition [MeV]");
-        analysisManager->SetH1YAxisTitle(0, "Counts");
-
-        analysisManager->CreateH1("time", "Time Distribution",
-            100, 0., 3.0);
-        analysisManager->SetH1XAxisTitle(1, "Photon Time [ns]");
-        analysisManager->SetH1YAxisTitle(1, "Counts");
-
-        // Create 2D histograms
-        analysisManager->CreateH2("timing_xy", "XY Timing",
-            100, -400., 300., 100, -400., 300.);
-        analysisManager->SetH2XAxisTitle(0, "x [mm]");
-        analysisManager->SetH2YAxisTitle(0, "y [mm]");
-        analysisManager->SetH2ZAxisTitle(0, "Time [ns]");
-
-        analysisManager->CreateH2("timing_yz", "YZ Timing",
-            //100, -400., 300., 100, -10., 10.);
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(1, "y [mm]");
-        analysisManager->SetH2YAxisTitle(1, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(1, "Time [ns]");
-
-        analysisManager->CreateH2("timing_xz", "XZ Timing",
-            //100, -400., 300., 100, -10., 10.);
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(2, "x [mm]");
-        analysisManager->SetH2YAxisTitle(2, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(2, "Time [ns]");
-
-        analysisManager->CreateH2("edep_xy", "XY Energy Deposition",
-            100, -400., 300., 100, -400., 300.);
-        analysisManager->SetH2XAxisTitle(3, "x [mm]");
-        analysisManager->SetH2YAxisTitle(3, "y [mm]");
-        analysisManager->SetH2ZAxisTitle(3, "Energy [MeV]");
-
-        analysisManager->CreateH2("edep_yz", "YZ Energy Deposition",
-            //100, -400., 300., 100, -10., 10.);
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(4, "y [mm]");
-        analysisManager->SetH2YAxisTitle(4, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(4, "Energy [MeV]");
-
-        analysisManager->CreateH2("edep_xz", "XZ Energy Deposition",
-            //100, -400., 300., 100, -10., 10.);
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(5, "x [mm]");
-        analysisManager->SetH2YAxisTitle(5, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(5, "Energy [MeV]");
-
-        analysisManager->CreateH2("clad_xy", "Cladding XY",
-            100, -400., 300., 100, -400., 300.);
-        analysisManager->SetH2XAxisTitle(6, "x [mm]");
-        analysisManager->SetH2YAxisTitle(6, "y [mm]");
-        analysisManager->SetH2ZAxisTitle(6, "Energy [MeV]");
-
-        analysisManager->CreateH2("clad_yz", "Cladding YZ",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(7, "y [mm]");
-        analysisManager->SetH2YAxisTitle(7, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(7, "Energy [MeV]");
-
-        analysisManager->CreateH2("clad_xz", "Cladding XZ",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(8, "x [mm]");
-        analysisManager->SetH2YAxisTitle(8, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(8, "Energy [MeV]");
-
-        analysisManager->CreateH2("core_xy", "Core XY",
-            100, -400., 300., 100, -400., 300.);
-        analysisManager->SetH2XAxisTitle(9, "x [mm]");
-        analysisManager->SetH2YAxisTitle(9, "y [mm]");
-        analysisManager->SetH2ZAxisTitle(9, "Energy [MeV]");
-
-        analysisManager->CreateH2("core_yz", "Core YZ",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(10, "y [mm]");
-        analysisManager->SetH2YAxisTitle(10, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(10, "Energy [MeV]");
-
-        analysisManager->CreateH2("core_xz", "Core XZ",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(11, "x [mm]");
-        analysisManager->SetH2YAxisTitle(11, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(11, "Energy [MeV]");
-
-        analysisManager->CreateH1("PhotonEnergyBeforeWLS", "Photon Energy Before WLS",
-            100, 2.0, 3.5);
-        analysisManager->SetH1XAxisTitle(2, "Energy [eV]");
-        analysisManager->SetH1YAxisTitle(2, "Counts");
-
-        analysisManager->CreateH1("PhotonEnergyAfterWLS", "Photon Energy After WLS",
-            100, 2.0, 3.5);
-        analysisManager->SetH1XAxisTitle(3, "Energy [eV]");
-        analysisManager->SetH1YAxisTitle(3, "Counts");
-
-        analysisManager->CreateH1("PhotonWavelengthBeforeWLS", "Photon Wavelength Before WLS",
-            100, 350., 600.);
-        analysisManager->SetH1XAxisTitle(4, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(4, "Counts");
-
-        analysisManager->CreateH1("PhotonWavelengthAfterWLS", "Photon Wavelength After WLS",
-            100, 350., 600.);
-        analysisManager->SetH1XAxisTitle(5, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(5, "Counts");
-
-        analysisManager->CreateH1("CladdingWavelength", "Photon Wavelength in Cladding",
-            100, 300., 600.);
-        analysisManager->SetH1XAxisTitle(6, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(6, "Counts");
-
-        analysisManager->CreateH1("CladdingEnergy", "Photon Energy in Cladding",
-            100, 1.5, 4.1);
-        analysisManager->SetH1XAxisTitle(7, "Energy [eV]");
-        analysisManager->SetH1YAxisTitle(7, "Counts");
-
-        analysisManager->CreateH1("CoreWavelength", "Photon Wavelength in Core",
-            100, 300., 600.);
-        analysisManager->SetH1XAxisTitle(8, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(8, "Counts");
-
-        analysisManager->CreateH1("CoreEnergy", "Photon Energy in Core",
-            100, 1.5, 4.1);
-        analysisManager->SetH1XAxisTitle(9, "Energy [eV]");
-        analysisManager->SetH1YAxisTitle(9, "Counts");
-
-        analysisManager->CreateH1("WLSEmissionSpectrum", "WLS Emission Spectrum",
-            200, 300., 600.);
-        analysisManager->SetH1XAxisTitle(10, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(10, "Counts");
-
-        analysisManager->CreateH1("SipmTimeSpectrum", "Sipm Time Spectrum",
-            100, 0., 300.0);
-        analysisManager->SetH1XAxisTitle(11, "Time [ns]");
-        analysisManager->SetH1YAxisTitle(11, "Counts");
-
-        analysisManager->CreateH1("SipmWavelength", "Photon Wavelenght in Sipm",
-            200, 300, 600);
-        analysisManager->SetH1XAxisTitle(12, "Wavelength [nm]");
-        analysisManager->SetH1YAxisTitle(12, "Counts");
-
-        analysisManager->CreateH2("Sipm_Timing_xy", "Sipm XY Timing",
-            100, -400., 300., 100, -400., 300.);
-        analysisManager->SetH2XAxisTitle(12, "x [mm]");
-        analysisManager->SetH2YAxisTitle(12, "y [mm]");
-        analysisManager->SetH2ZAxisTitle(12, "Time [ns]");
-
-        analysisManager->CreateH2("Sipm_Timing_yz", "Sipm YZ Timing",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(13, "y [mm]");
-        analysisManager->SetH2YAxisTitle(13, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(13, "Time [ns]");
-
-        analysisManager->CreateH2("Sipm_Timing_xz", "Sipm XZ Timing",
-            100, -400., 300., 100, -40., 40.);
-        analysisManager->SetH2XAxisTitle(14, "x [mm]");
-        analysisManager->SetH2YAxisTitle(14, "z [mm]");
-        analysisManager->SetH2ZAxisTitle(14, "Time [ns]");
-
-    }
-
-    G4_BREMS::RunAction::~RunAction()
-    {
-        // Clean up accumulables
-        for (auto& pair : fAccCreationCounts) {
-            delete pair.second;
-        }
-        for (auto& pair : fAccInteractionCounts) {
-            delete pair.second;
-        }
-    }
-
-    void G4_BREMS::RunAction::BeginOfRunAction(const G4Run*)
-    {
-        // Reset accumulables
-        G4AccumulableManager::Instance()->Reset();
-
-        // Clear SiPM hits from previous run
-        if (fSteppingAction) {
-            fSteppingAction->ClearHits();
-        }
-
-        if (G4Threading::IsMasterThread()) {
-            gSipmHits.clear();
-        }
-
-
-        auto analysisManager = G4AnalysisManager::Instance();
-        analysisManager->Reset();
-
-        if (!analysisManager->OpenFile()) {
-            G4ExceptionDescription msg;
-            msg << "Failed to open file " << analysisManager->GetFileName();
-            G4Exception("RunAction::BeginOfRunAction()",
-                "Analysis_W001", JustWarning, msg);
-        }
-
-        //auto analysisManager = G4AnalysisManager::Instance();
-        G4String fileName = "Sipm_Hits.root";
-        
-        analysisManager->OpenFile(fileName);
-
-    }
-
-
-    void G4_BREMS::RunAction::AddProcessCount(const G4String& volume,
-        const G4String& processName,
-        bool isCreationProcess)
-    {
-        G4String key = volume + (isCreationProcess ? "_Creation_" : "_Interaction_") + processName;
-
-        if (isCreationProcess) {
-            auto it = fAccCreationCounts.find(key);
-            if (it != fAccCreationCounts.end()) {
-                *(it->second) += 1;
-            }
-        }
-        else {
-            auto it = fAccInteractionCounts.find(key);
-            if (it != fAccInteractionCounts.end()) {
-                *(it->second) += 1;
-            }
-        }
-    }
-
-    G4double G4_BREMS::RunAction::CalculateTrappingEfficiency() const {
-        G4double photonsEntered = fAccPhotonsEnteredFiber.GetValue();
-        G4double photonsExited = fAccPhotonsExitedFiber.GetValue();
-        G4double photonsAbsorbed = fAccPhotonsAbsorbedFiber.GetValue();
-
-        G4cout << "Photons Entered: " << photonsEntered << " " << "Photon Exited: " << photonsExited << " " << "Photons Absorbed: "
-            << photonsAbsorbed << G4endl;
-        if (photonsEntered == 0) return 0.0; // Avoid division by zero
-        return photonsAbsorbed / photonsEntered;
-    }
-
-    void G4_BREMS::RunAction::EndOfRunAction(const G4Run* run)
-    {
-        auto analysisManager = G4AnalysisManager::Instance();
-
-        // Merge all accumulables
-        G4AccumulableManager::Instance()->Merge();
-
-        if (G4Threading::IsMasterThread()) {
-            // Update volume counts from accumulables
-            fTileCount = fAccTileCount.GetValue();
-            fCladCount = fAccCladCount.GetValue();
-            fCoreCount = fAccCoreCount.GetValue();
-            fOtherCount = fAccOtherCount.GetValue();
-            fSipmCount = fAccSipmCount.GetValue();
-            fPhotonsEnteredFiber = fAccPhotonsEnteredFiber.GetValue();
-            fPhotonsExitedFiber = fAccPhotonsExitedFiber.GetValue();
-            fPhotonsAbsorbedFiber = fAccPhotonsAbsorbedFiber.GetValue();
-
-            // Print summary
-            G4cout << "\n=== Final Process Counts Summary ===" << G4endl;
-            G4cout << "\nVolume Hit Counts:" << G4endl;
-            G4cout << "Tile Count: " << fTileCount << G4endl;
-            G4cout << "Cladding Count: " << fCladCount << G4endl;
-            G4cout << "Core Count: " << fCoreCount << G4endl;
-            G4cout << "Sipm Count: " << fSipmCount << G4endl;
-            G4cout << "Other Count: " << fOtherCount << G4endl;
-
-            // Print trapping efficiency
-            G4double trappingEfficiency = CalculateTrappingEfficiency();
-            G4cout << "\nTrapping Efficiency: " << trappingEfficiency * 100.0 << "%" << G4endl;
-
-            // Print process counts for each volume
-            std::vector<G4String> volumes = { "Tile", "FiberCore", "FiberClad", "Sipm" };
-            for (const auto& volume : volumes) {
-                G4cout << "\nVolume: " << volume << G4endl;
-
-                // Creation processes
-                G4cout << "Creation Processes:" << G4endl;
-                std::vector<G4String> creationProcesses = { "Cerenkov", "Scintillation", "OpWLS" };
-                for (const auto& process : creationProcesses) {
-                    G4String key = volume + "_Creation_" + process;
-                    auto it = fAccCreationCounts.find(key);
-                    if (it != fAccCreationCounts.end()) {
-                        G4cout << std::setw(15) << process << ": "
-                            << it->second->GetValue() << G4endl;
-                    }
-                }
-
-                // Interaction processes
-                G4cout << "Interaction Processes:" << G4endl;
-                std::vector<G4String> interactionProcesses = { "OpAbsorption", "OpWLS", "Transportation" };
-                for (const auto& process : interactionProcesses) {
-                    G4String key = volume + "_Interaction_" + process;
-                    auto it = fAccInteractionCounts.find(key);
-                    if (it != fAccInteractionCounts.end()) {
-                        G4cout << std::setw(15) << process << ": "
-                            << it->second->GetValue() << G4endl;
-                    }
-                }
-            }
-            G4cout << "\nAttempting to write " << gSipmHits.size() << " SiPM hits to CSV file." << G4endl;
-            //G4cout << "\nAttempting to write " << gSipmHits.size() << " SiPM hits to ROOT file." << G4endl;
-
-            /*
-           
-            if (!gSipmHits.empty()) {
-                // Generate filename with run number
-                std::string filename = "sipm_hits_run" + std::to_string(run->GetRunID()) + ".csv";
-                //std::string filename = "sipm_hits_run" + std::to_string(run->GetRunID()) + ".root";
-                G4cout << "Creating file: " << filename << G4endl;
-
-                std::ofstream outFile(filename);
-                if (outFile.is_open()) {
-                    // Write header
-                    //outFile << "SipmID,SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm)" << std::endl;
-                    //outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm)" << std::endl;
-                    outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm), TimeWindow(ns),ChargeDepositionCounts" 
-                            << std::endl;
-
-                    // First, sort all hits by SiPM ID and then by time
-                    std::map<G4String, std::vector<SipmHit>> hitsBySipm;
-                    for (const auto& hit : gSipmHits) {
-                        hitsBySipm[hit.sipmName].push_back(hit);
-                    }
-
-                    // Process each SiPM's hits
-                    for (auto& sipmPair : hitsBySipm) {
-                        auto& sipmName = sipmPair.first;
-                        auto& hits = sipmPair.second;
-
-                        // Sort hits by time
-                        std::sort(hits.begin(), hits.end(),
-                            [](const SipmHit& a, const SipmHit& b) {
-                                return a.time < b.time;
-                            });
-                        const G4double timeWindow = 100.0 * ns; // 100 ns time window
-                        //const G4double photonToCharge = 1.602e-7; // pC per photon (adjust based on your SiPM gain)
-
-                        // For each hit, determine its time window and charge contribution
-                        for (size_t i = 0; i < hits.size(); i++) {
-                           const auto& hit = hits[i];
-
-                           // Find the start of the time window for this hit
-                           G4double windowStart = hit.time;
-                           G4double windowEnd = windowStart + timeWindow;
-
-                           // Count photons in this window
-                           G4int photonsInWindow = 0;
-                           for (size_t j = i; j < hits.size(); j++) {
-                                if (hits[j].time >= windowStart && hits[j].time <= windowEnd) {
-                                    photonsInWindow++;
-                                }
-                                if (hits[j].time > windowEnd) break;
-                           }
-
-                           // Calculate charge for this hit
-                           //G4double charge = photonToCharge * photonsInWindow;
-                    
-                           // Write hit data with charge information
-                           outFile << hit.sipmName << ","
-                               << hit.time / ns << ","
-                               << hit.position.x() / mm << ","
-                               << hit.position.y() / mm << ","
-                               << hit.position.z() / mm << ","
-                               << hit.energy / eV << ","
-                               << hit.wavelength << ","
-                               << windowStart / ns << "-" << windowEnd / ns << ","
-                               //<< charge << std::endl;
-                               << photonsInWindow << std::endl;
-                        }
-                    }
-                    outFile.close();
-                    G4cout << "Successfully wrote " << gSipmHits.size() << " SiPM hits with charge information to "
-                        << filename << G4endl;
-                }
-                else {
-                    G4cerr << "Error: Could not open " << filename << " for writing" << G4endl;
-                }
-            }
-            */
-            if (!gSipmHits.empty()) {
-                // Generate filename with run number
-                std::string filename = "sipm_hits_run" + std::to_string(run->GetRunID()) + ".csv";
-                G4cout << "Creating file: " << filename << G4endl;
-
-                std::ofstream outFile(filename);
-                if (outFile.is_open()) {
-                    // Write header
-                    outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm),TimeBin(ns),PhotonsInBin"
-                        << std::endl;
-
-                    // Group hits by SiPM
-                    std::map<G4String, std::vector<SipmHit>> hitsBySipm;
-                    for (const auto& hit : gSipmHits) {
-                        hitsBySipm[hit.sipmName].push_back(hit);
-                    }
-
-                    // Process each SiPM's hits
-                    for (auto& sipmPair : hitsBySipm) {
-                        auto& sipmName = sipmPair.first;
-                        auto& hits = sipmPair.second;
-
-                        // Sort hits by time
-                        std::sort(hits.begin(), hits.end(),
-                            [](const SipmHit& a, const SipmHit& b) {
-                                return a.time < b.time;
-                            });
-
-                        // Define bin size
-                        const G4double binSize = 100.0 * ns; // 100 ns non-overlapping bins
-
-                        // Calculate bins for this SiPM
-                        std::map<G4int, G4int> binCounts; // binIndex -> count
-                        for (const auto& hit : hits) {
-                            G4int binIndex = static_cast<G4int>(hit.time / binSize);
-                            binCounts[binIndex]++;
-                        }
-
-                        // Write hit data with bin information
-                        for (const auto& hit : hits) {
-                            G4int binIndex = static_cast<G4int>(hit.time / binSize);
-                            G4double binStart = binIndex * binSize;
-                            G4double binEnd = (binIndex + 1) * binSize;
-                            G4int photonsInBin = binCounts[binIndex];
-
-                            outFile << hit.sipmName << ","
-                                << hit.time / ns << ","
-                                << hit.position.x() / mm << ","
-                                << hit.position.y() / mm << ","
-                                << hit.position.z() / mm << ","
-                                << hit.energy / eV << ","
-                                << hit.wavelength << ","
-                                << binStart / ns << "-" << binEnd / ns << ","
-                                << photonsInBin << std::endl;
-                        }
-                    }
-                    outFile.close();
-                    G4cout << "Successfully wrote " << gSipmHits.size() << " SiPM hits with binned charge information to "
-                        << filename << G4endl;
-                }
-                else {
-                    G4cerr << "Error: Could not open " << filename << " for writing" << G4endl;
-                }
-            }
-
-
-
-            else {
-                G4cout << "No SiPM hits recorded in this run" << G4endl;
-            }
-
-            G4cout << "\n=================================" << G4endl;
-        }
-
-        // Write and close file
-        analysisManager->Write();
-        analysisManager->CloseFile(false);
-    }
-} // namespace G4_BREMS
-
-
+
+#include "RunAction.hh"
+#include "SteppingAction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "OutputPaths.hh"
+#include "SobolSampler.hh"
+#include "ResponseMessenger.hh"
+#include "AdaptiveMessenger.hh"
+#include "DigitizerMessenger.hh"
+#include "TriggerMessenger.hh"
+#include "ReconstructionMessenger.hh"
+#include "MixingMessenger.hh"
+#include "TapeMessenger.hh"
+#include "HitsMessenger.hh"
+#include "SipmHitsWriter.hh"
+#include "StepAnalysis.hh"
+#include "PhysicsList.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4RunManagerKernel.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4AnalysisManager.hh"
+#include "G4AccumulableManager.hh"
+#include <cmath>
+#include <iomanip>
+#include <string>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        // The per-event tallies of EndOfEvent run when the parent event ends, before the
+        // workers have tracked all of its photons, so they would silently get partial events
+        void RefusePartialEvents()
+        {
+            auto generator = dynamic_cast<const PrimaryGeneratorAction*>(
+                G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+            G4String modes;
+            auto add = [&modes](G4bool active, const char* name) {
+                if (!active) return;
+                if (!modes.empty()) modes += ", ";
+                modes += name;
+            };
+            add(ResponseMatrix::IsActive(), "response matrix");
+            add(AdaptiveStopping::IsEnabled(), "adaptive stopping");
+            add(generator && generator->UsesReplicas(), "Sobol replicas");
+            add(SipmDigitizer::IsEnabled(), "digitizer");
+            add(EventReconstructor::IsEnabled(), "reconstruction");
+            if (modes.empty()) return;
+
+            G4ExceptionDescription msg;
+            msg << "The " << modes << " need whole events, which sub-event mode does not provide; "
+                << "disable them or run without --run-manager subevt.";
+            G4Exception("RunAction::BeginOfRunAction()", "Run_F001", FatalException, msg);
+        }
+    }
+
+    G4bool RunAction::fOutputsWritten = true;
+
+    G4_BREMS::RunAction::RunAction(SteppingAction* steppingAction)
+        : G4UserRunAction(),
+        fTileCount(0), fCladCount(0), fCoreCount(0), fSipmCount(0), fOtherCount(0),
+        fPhotonsEnteredFiber(0), fPhotonsExitedFiber(0), fPhotonsAbsorbedFiber(0),
+        fAccTileCount("TileCount", 0),
+        fAccCladCount("CladCount", 0),
+        fAccCoreCount("CoreCount", 0),
+        fAccSipmCount("SipmCount", 0),
+        fAccOtherCount("OtherCount", 0),
+        fAccPhotonsEnteredFiber("PhotonsEnteredFiber", 0),
+        fAccPhotonsExitedFiber("PhotonsExitedFiber", 0),
+        fAccPhotonsAbsorbedFiber("PhotonsAbsorbedFiber", 0),
+        fEventEntered(0), fEventAbsorbed(0), fResponseMessenger(nullptr),
+        fAdaptiveMessenger(nullptr), fDigitizerMessenger(nullptr), fTriggerMessenger(nullptr),
+        fReconstructionMessenger(nullptr), fMixingMessenger(nullptr), fTapeMessenger(nullptr),
+        fHitsMessenger(nullptr), fSubEventMode(false),
+        fSteppingAction(steppingAction)
+    {
+        std::vector<G4String> volumes = { "Tile", "FiberCore", "FiberClad", "Sipm" };
+        for (const auto& volume : volumes) {
+            // Creation process accumulables
+            auto name = volume + "_Creation_Cerenkov";
+            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
+            name = volume + "_Creation_Scintillation";
+            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
+            name = volume + "_Creation_OpWLS";
+            fAccCreationCounts[name] = new G4Accumulable<G4int>(name, 0);
+
+            // Interaction process accumulables
+            name = volume + "_Interaction_OpAbsorption";
+            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
+            name = volume + "_Interaction_OpWLS";
+            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
+            name = volume + "_Interaction_Transportation";
+            fAccInteractionCounts[name] = new G4Accumulable<G4int>(name, 0);
+        }
+
+        // Register all accumulables
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(fAccTileCount);
+        accumulableManager->RegisterAccumulable(fAccCladCount);
+        accumulableManager->RegisterAccumulable(fAccCoreCount);
+        accumulableManager->RegisterAccumulable(fAccSipmCount);
+        accumulableManager->RegisterAccumulable(fAccOtherCount);
+        accumulableManager->RegisterAccumulable(fAccPhotonsEnteredFiber);
+        accumulableManager->RegisterAccumulable(fAccPhotonsExitedFiber);
+        accumulableManager->RegisterAccumulable(fAccPhotonsAbsorbedFiber);
+
+
+        // Register process accumulables
+        for (auto& pair : fAccCreationCounts) {
+            accumulableManager->RegisterAccumulable(*pair.second);
+        }
+        for (auto& pair : fAccInteractionCounts) {
+            accumulableManager->RegisterAccumulable(*pair.second);
+        }
+
+        // Register Sobol replica accumulables
+        for (G4int r = 0; r < SobolSampler::kMaxReplicas; r++) {
+            auto prefix = "Replica" + std::to_string(r) + "_";
+            fAccReplicaEvents.push_back(new G4Accumulable<G4double>(prefix + "Events", 0.));
+            fAccReplicaHits.push_back(new G4Accumulable<G4double>(prefix + "SipmHits", 0.));
+            fAccReplicaEntered.push_back(new G4Accumulable<G4double>(prefix + "PhotonsEnteredFiber", 0.));
+            fAccReplicaAbsorbed.push_back(new G4Accumulable<G4double>(prefix + "PhotonsAbsorbedFiber", 0.));
+            accumulableManager->RegisterAccumulable(*fAccReplicaEvents.back());
+            accumulableManager->RegisterAccumulable(*fAccReplicaHits.back());
+            accumulableManager->RegisterAccumulable(*fAccReplicaEntered.back());
+            accumulableManager->RegisterAccumulable(*fAccReplicaAbsorbed.back());
+        }
+
+        // The response grid, the adaptive targets, the digitizer, the trigger, the reconstruction,
+        // the background mixing, the step tape and the hit storage are configured once, on the master
+        if (G4Threading::IsMasterThread()) {
+            fResponseMessenger = new ResponseMessenger();
+            fAdaptiveMessenger = new AdaptiveMessenger();
+            fDigitizerMessenger = new DigitizerMessenger();
+            fTriggerMessenger = new TriggerMessenger();
+            fReconstructionMessenger = new ReconstructionMessenger();
+            fMixingMessenger = new MixingMessenger();
+            fTapeMessenger = new TapeMessenger();
+            fHitsMessenger = new HitsMessenger();
+        }
+
+        auto analysisManager = G4AnalysisManager::Instance();
+        analysisManager->SetVerboseLevel(1);
+        analysisManager->SetFileName(OutputPaths::AnalysisFileName());
+        analysisManager->SetDefaultFileType("root");
+        analysisManager->SetNtupleMerging(true);
+
+        // Booked with the analysis that fills them, which G4_Brems_replay shares
+        StepAnalysis::BookHistograms();
+
+    }
+
+    G4_BREMS::RunAction::~RunAction()
+    {
+        // Clean up accumulables
+        for (auto& pair : fAccCreationCounts) {
+            delete pair.second;
+        }
+        for (auto& pair : fAccInteractionCounts) {
+            delete pair.second;
+        }
+        for (G4int r = 0; r < SobolSampler::kMaxReplicas; r++) {
+            delete fAccReplicaEvents[r];
+            delete fAccReplicaHits[r];
+            delete fAccReplicaEntered[r];
+            delete fAccReplicaAbsorbed[r];
+        }
+        delete fResponseMessenger;
+        delete fAdaptiveMessenger;
+        delete fDigitizerMessenger;
+        delete fTriggerMessenger;
+        delete fReconstructionMessenger;
+        delete fMixingMessenger;
+        delete fTapeMessenger;
+        delete fHitsMessenger;
+    }
+
+    void G4_BREMS::RunAction::BeginOfRunAction(const G4Run* run)
+    {
+        // Reset accumulables
+        G4AccumulableManager::Instance()->Reset();
+        fResponseMatrix.BeginOfRun();
+        fChannelHistograms.BeginOfRun();
+
+        // The master's run starts before the workers', so the shared estimate is clean for them
+        if (G4Threading::IsMasterThread()) {
+            if (fSubEventMode) RefusePartialEvents();
+            AdaptiveStopping::ResetShared();
+            TileScorer::ResetShared();
+            if (SipmDigitizer::IsEnabled()) {
+                SipmDigitizer::OpenOutput(OutputPaths::DigitsName(run->GetRunID()), OutputPaths::FeaturesName(run->GetRunID()));
+            }
+            if (EventReconstructor::IsEnabled()) EventReconstructor::OpenOutput(OutputPaths::ReconstructionName(run->GetRunID()));
+            if (BackgroundMixer::IsRecording()) HitLibrary::OpenOutput(OutputPaths::HitLibraryName(run->GetRunID()));
+            if (StepTape::IsEnabled()) StepTape::OpenOutput(OutputPaths::StepTapeName(run->GetRunID()));
+        }
+        fAdaptiveStopping.BeginOfRun();
+        fTileScorer.BeginOfRun();
+        fDigitizer.BeginOfRun();
+        fReconstructor.BeginOfRun();
+
+        // Clear SiPM hits from previous run
+        if (fSteppingAction) {
+            fSteppingAction->ClearHits();
+        }
+
+        if (G4Threading::IsMasterThread()) {
+            gSipmHits.clear();
+            fOutputsWritten = true;
+
+            // The tables of this configuration were built during the run initialization
+            auto physicsList = dynamic_cast<PhysicsList*>(G4RunManagerKernel::GetRunManagerKernel()->GetPhysicsList());
+            if (physicsList) {
+                physicsList->StoreTableCache();
+            }
+            fTimer.Start();
+        }
+
+
+        auto analysisManager = G4AnalysisManager::Instance();
+        analysisManager->Reset();
+        analysisManager->SetFileName(OutputPaths::AnalysisFileName());
+
+        if (!analysisManager->OpenFile()) {
+            G4ExceptionDescription msg;
+            msg << "Failed to open file " << analysisManager->GetFileName();
+            G4Exception("RunAction::BeginOfRunAction()",
+                "Analysis_W001", JustWarning, msg);
+        }
+
+        //auto analysisManager = G4AnalysisManager::Instance();
+        G4String fileName = OutputPaths::SipmHitsFileName();
+        
+        analysisManager->OpenFile(fileName);
+
+    }
+
+
+    void G4_BREMS::RunAction::AddProcessCount(const G4String& volume,
+        const G4String& processName,
+        bool isCreationProcess)
+    {
+        G4String key = volume + (isCreationProcess ? "_Creation_" : "_Interaction_") + processName;
+
+        if (isCreationProcess) {
+            auto it = fAccCreationCounts.find(key);
+            if (it != fAccCreationCounts.end()) {
+                *(it->second) += 1;
+            }
+        }
+        else {
+            auto it = fAccInteractionCounts.find(key);
+            if (it != fAccInteractionCounts.end()) {
+                *(it->second) += 1;
+            }
+        }
+    }
+
+    G4double G4_BREMS::RunAction::CalculateTrappingEfficiency() const {
+        G4double photonsEntered = fAccPhotonsEnteredFiber.GetValue();
+        G4double photonsExited = fAccPhotonsExitedFiber.GetValue();
+        G4double photonsAbsorbed = fAccPhotonsAbsorbedFiber.GetValue();
+
+        G4cout << "Photons Entered: " << photonsEntered << " " << "Photon Exited: " << photonsExited << " " << "Photons Absorbed: "
+            << photonsAbsorbed << G4endl;
+        if (photonsEntered == 0) return 0.0; // Avoid division by zero
+        return photonsAbsorbed / photonsEntered;
+    }
+
+    void G4_BREMS::RunAction::BeginOfEvent()
+    {
+        // Thread-local values before the merge, so the difference at the end is this event's
+        fEventEntered = fAccPhotonsEnteredFiber.GetValue();
+        fEventAbsorbed = fAccPhotonsAbsorbedFiber.GetValue();
+        fTileScorer.BeginOfEvent();
+        if (ChannelHistograms::IsEnabled()) fChannelHistograms.BeginOfEvent();
+    }
+
+    void G4_BREMS::RunAction::MixEvent(G4int eventID, std::vector<SipmHit>& hits)
+    {
+        if (BackgroundMixer::IsRecording()) fMixer.Record(eventID, hits);
+        if (BackgroundMixer::IsMixing()) fMixer.Overlay(hits);
+    }
+
+    void G4_BREMS::RunAction::EndOfEvent(G4int eventID, G4int replica, const std::vector<SipmHit>& hits, G4bool triggered)
+    {
+        if (ResponseMatrix::IsActive()) {
+            fResponseMatrix.AddEvent(eventID, hits);
+        }
+        // The hits themselves were histogrammed at detection; this closes the event's counts. In
+        // sub-event mode they were counted on the workers, so the photoelectron histograms stay empty
+        if (ChannelHistograms::IsEnabled() && !fSubEventMode) fChannelHistograms.EndOfEvent();
+        G4double entered = fAccPhotonsEnteredFiber.GetValue() - fEventEntered;
+        G4double absorbed = fAccPhotonsAbsorbedFiber.GetValue() - fEventAbsorbed;
+        fAdaptiveStopping.AddEvent(entered, absorbed, hits);
+        if (triggered) {
+            fTileScorer.EndOfEvent(eventID);
+            if (SipmDigitizer::IsEnabled()) fDigitizer.DigitizeEvent(eventID, hits, CoincidenceTrigger::IsEnabled());
+            if (EventReconstructor::IsEnabled()) fReconstructor.AddEvent(eventID, hits);
+        }
+
+        if (replica < 0 || replica >= SobolSampler::kMaxReplicas) return;
+
+        *fAccReplicaEvents[replica] += 1.;
+        *fAccReplicaHits[replica] += static_cast<G4double>(hits.size());
+        *fAccReplicaEntered[replica] += entered;
+        *fAccReplicaAbsorbed[replica] += absorbed;
+    }
+
+    void G4_BREMS::RunAction::PrintReplicaSummary() const
+    {
+        std::vector<G4double> hitsPerEvent;
+        std::vector<G4double> trapping;
+        for (G4int r = 0; r < SobolSampler::kMaxReplicas; r++) {
+            G4double events = fAccReplicaEvents[r]->GetValue();
+            if (events <= 0.) continue;
+            hitsPerEvent.push_back(fAccReplicaHits[r]->GetValue() / events);
+            G4double entered = fAccReplicaEntered[r]->GetValue();
+            if (entered > 0.) trapping.push_back(fAccReplicaAbsorbed[r]->GetValue() / entered);
+        }
+        if (hitsPerEvent.empty()) return;
+
+        auto print = [](const char* label, const std::vector<G4double>& values, G4double scale) {
+            if (values.empty()) return;
+            G4double mean = 0.;
+            for (auto v : values) mean += v;
+            mean /= values.size();
+            G4double variance = 0.;
+            for (auto v : values) variance += (v - mean) * (v - mean);
+            G4double error = (values.size() > 1) ? std::sqrt(variance / (values.size() - 1) / values.size()) : 0.;
+            G4cout << label << mean * scale << " +- " << error * scale << G4endl;
+        };
+
+        G4cout << "\n=== Sobol replicas: " << hitsPerEvent.size() << " ===" << G4endl;
+        print("SiPM hits per event: ", hitsPerEvent, 1.);
+        print("Trapping efficiency (%): ", trapping, 100.);
+    }
+
+    G4bool G4_BREMS::RunAction::WriteSummary(const G4Run* run) const
+    {
+        std::string filename = OutputPaths::SummaryCsvName(run->GetRunID());
+        std::ofstream outFile(filename);
+        if (!outFile.is_open()) {
+            G4cerr << "Error: Could not open " << filename << " for writing" << G4endl;
+            return false;
+        }
+
+        outFile << "Key,Value" << std::endl;
+        outFile << "Events," << run->GetNumberOfEvent() << std::endl;
+        // Histogram mode counts hits at detection, before mixing and trigger, so its total goes under
+        // its own key rather than that of the published hits
+        if (ChannelHistograms::IsEnabled()) {
+            outFile << "SipmHitsRaw," << static_cast<long long>(ChannelHistograms::GetRunHits()) << std::endl;
+        }
+        else {
+            outFile << "SipmHits," << gSipmHits.size() << std::endl;
+        }
+        outFile << "TileCount," << fTileCount << std::endl;
+        outFile << "CladCount," << fCladCount << std::endl;
+        outFile << "CoreCount," << fCoreCount << std::endl;
+        outFile << "SipmCount," << fSipmCount << std::endl;
+        outFile << "OtherCount," << fOtherCount << std::endl;
+        outFile << "PhotonsEnteredFiber," << fPhotonsEnteredFiber << std::endl;
+        outFile << "PhotonsExitedFiber," << fPhotonsExitedFiber << std::endl;
+        outFile << "PhotonsAbsorbedFiber," << fPhotonsAbsorbedFiber << std::endl;
+        if (CoincidenceTrigger::IsEnabled()) {
+            outFile << "TriggerAccepted," << fTrigger.GetAcceptedEvents() << std::endl;
+            outFile << "TriggerRawHits," << static_cast<long long>(fTrigger.GetRawHits()) << std::endl;
+        }
+        for (const auto& pair : fAccCreationCounts) {
+            outFile << pair.first << "," << pair.second->GetValue() << std::endl;
+        }
+        for (const auto& pair : fAccInteractionCounts) {
+            outFile << pair.first << "," << pair.second->GetValue() << std::endl;
+        }
+        for (G4int r = 0; r < SobolSampler::kMaxReplicas; r++) {
+            if (fAccReplicaEvents[r]->GetValue() <= 0.) continue;
+            for (const auto* acc : { fAccReplicaEvents[r], fAccReplicaHits[r], fAccReplicaEntered[r], fAccReplicaAbsorbed[r] }) {
+                outFile << acc->GetName() << "," << static_cast<long long>(acc->GetValue()) << std::endl;
+            }
+        }
+        // Derived, recomputed from the summed counters when shards are merged
+        G4double trappingEfficiency = (fPhotonsEnteredFiber > 0)
+            ? static_cast<G4double>(fPhotonsAbsorbedFiber) / fPhotonsEnteredFiber : 0.0;
+        outFile << "TrappingEfficiency," << trappingEfficiency << std::endl;
+        return static_cast<G4bool>(outFile);
+    }
+
+    void G4_BREMS::RunAction::EndOfRunAction(const G4Run* run)
+    {
+        auto analysisManager = G4AnalysisManager::Instance();
+
+        // Merge all accumulables
+        G4AccumulableManager::Instance()->Merge();
+        // Workers end their runs before the master, which then sees every event
+        fAdaptiveStopping.Flush();
+        fTileScorer.Flush();
+        fReconstructor.Flush();
+        if (fSteppingAction) fSteppingAction->FlushTape();
+
+        if (G4Threading::IsMasterThread()) {
+            // Update volume counts from accumulables
+            fTileCount = fAccTileCount.GetValue();
+            fCladCount = fAccCladCount.GetValue();
+            fCoreCount = fAccCoreCount.GetValue();
+            fOtherCount = fAccOtherCount.GetValue();
+            fSipmCount = fAccSipmCount.GetValue();
+            fPhotonsEnteredFiber = fAccPhotonsEnteredFiber.GetValue();
+            fPhotonsExitedFiber = fAccPhotonsExitedFiber.GetValue();
+            fPhotonsAbsorbedFiber = fAccPhotonsAbsorbedFiber.GetValue();
+
+            // Print summary
+            G4cout << "\n=== Final Process Counts Summary ===" << G4endl;
+            G4cout << "\nVolume Hit Counts:" << G4endl;
+            G4cout << "Tile Count: " << fTileCount << G4endl;
+            G4cout << "Cladding Count: " << fCladCount << G4endl;
+            G4cout << "Core Count: " << fCoreCount << G4endl;
+            G4cout << "Sipm Count: " << fSipmCount << G4endl;
+            G4cout << "Other Count: " << fOtherCount << G4endl;
+
+            // Print trapping efficiency
+            G4double trappingEfficiency = CalculateTrappingEfficiency();
+            G4cout << "\nTrapping Efficiency: " << trappingEfficiency * 100.0 << "%" << G4endl;
+
+            // Print process counts for each volume
+            std::vector<G4String> volumes = { "Tile", "FiberCore", "FiberClad", "Sipm" };
+            for (const auto& volume : volumes) {
+                G4cout << "\nVolume: " << volume << G4endl;
+
+                // Creation processes
+                G4cout << "Creation Processes:" << G4endl;
+                std::vector<G4String> creationProcesses = { "Cerenkov", "Scintillation", "OpWLS" };
+                for (const auto& process : creationProcesses) {
+                    G4String key = volume + "_Creation_" + process;
+                    auto it = fAccCreationCounts.find(key);
+                    if (it != fAccCreationCounts.end()) {
+                        G4cout << std::setw(15) << process << ": "
+                            << it->second->GetValue() << G4endl;
+                    }
+                }
+
+                // Interaction processes
+                G4cout << "Interaction Processes:" << G4endl;
+                std::vector<G4String> interactionProcesses = { "OpAbsorption", "OpWLS", "Transportation" };
+                for (const auto& process : interactionProcesses) {
+                    G4String key = volume + "_Interaction_" + process;
+                    auto it = fAccInteractionCounts.find(key);
+                    if (it != fAccInteractionCounts.end()) {
+                        G4cout << std::setw(15) << process << ": "
+                            << it->second->GetValue() << G4endl;
+                    }
+                }
+            }
+            if (!ChannelHistograms::IsEnabled()) {
+                G4cout << "\nAttempting to write " << gSipmHits.size() << " SiPM hits to CSV file." << G4endl;
+            }
+            //G4cout << "\nAttempting to write " << gSipmHits.size() << " SiPM hits to ROOT file." << G4endl;
+
+            /*
+           
+            if (!gSipmHits.empty()) {
+                // Generate filename with run number
+                std::string filename = "sipm_hits_run" + std::to_string(run->GetRunID()) + ".csv";
+                //std::string filename = "sipm_hits_run" + std::to_string(run->GetRunID()) + ".root";
+                G4cout << "Creating file: " << filename << G4endl;
+
+                std::ofstream outFile(filename);
+                if (outFile.is_open()) {
+                    // Write header
+                    //outFile << "SipmID,SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm)" << std::endl;
+                    //outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm)" << std::endl;
+                    outFile << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm), TimeWindow(ns),ChargeDepositionCounts" 
+                            << std::endl;
+
+                    // First, sort all hits by SiPM ID and then by time
+                    std::map<G4String, std::vector<SipmHit>> hitsBySipm;
+                    for (const auto& hit : gSipmHits) {
+                        hitsBySipm[hit.sipmName].push_back(hit);
+                    }
+
+                    // Process each SiPM's hits
+                    for (auto& sipmPair : hitsBySipm) {
+                        auto& sipmName = sipmPair.first;
+                        auto& hits = sipmPair.second;
+
+                        // Sort hits by time
+                        std::sort(hits.begin(), hits.end(),
+                            [](const SipmHit& a, const SipmHit& b) {
+                                return a.time < b.time;
+                            });
+                        const G4double timeWindow = 100.0 * ns; // 100 ns time window
+                        //const G4double photonToCharge = 1.602e-7; // pC per photon (adjust based on your SiPM gain)
+
+                        // For each hit, determine its time window and charge contribution
+                        for (size_t i = 0; i < hits.size(); i++) {
+                           const auto& hit = hits[i];
+
+                           // Find the start of the time window for this hit
+                           G4double windowStart = hit.time;
+                           G4double windowEnd = windowStart + timeWindow;
+
+                           // Count photons in this window
+                           G4int photonsInWindow = 0;
+                           for (size_t j = i; j < hits.size(); j++) {
+                                if (hits[j].time >= windowStart && hits[j].time <= windowEnd) {
+                                    photonsInWindow++;
+                                }
+                                if (hits[j].time > windowEnd) break;
+                           }
+
+                           // Calculate charge for this hit
+                           //G4double charge = photonToCharge * photonsInWindow;
+                    
+                           // Write hit data with charge information
+                           outFile << hit.sipmName << ","
+                               << hit.time / ns << ","
+                               << hit.position.x() / mm << ","
+                               << hit.position.y() / mm << ","
+                               << hit.position.z() / mm << ","
+                               << hit.energy / eV << ","
+                               << hit.wavelength << ","
+                               << windowStart / ns << "-" << windowEnd / ns << ","
+                               //<< charge << std::endl;
+                               << photonsInWindow << std::endl;
+                        }
+                    }
+                    outFile.close();
+                    G4cout << "Successfully wrote " << gSipmHits.size() << " SiPM hits with charge information to "
+                        << filename << G4endl;
+                }
+                else {
+                    G4cerr << "Error: Could not open " << filename << " for writing" << G4endl;
+                }
+            }
+            */
+            if (ChannelHistograms::IsEnabled()) {
+                // Histogram mode keeps no hit list, so there is nothing to sort
+                if (!fChannelHistograms.Write(OutputPaths::ChannelHistogramsName(run->GetRunID()))) fOutputsWritten = false;
+            }
+            else if (!gSipmHits.empty()) {
+                // Generate filename with run number
+                std::string filename = OutputPaths::SipmHitsCsvName(run->GetRunID());
+                G4cout << "Creating file: " << filename << G4endl;
+
+                // Radix partition by channel, per-SiPM sort and binning, and block formatting,
+                // on a thread pool; the workers have finished the event loop
+                SipmHitsWriter writer;
+                if (writer.Write(gSipmHits, filename)) {
+                    const auto& times = writer.GetStageTimes();
+                    G4cout << "Successfully wrote " << gSipmHits.size() << " SiPM hits with binned charge information to "
+                        << filename << " (" << writer.GetThreads() << " threads: partition " << times.partition
+                        << " s, sort " << times.sort << " s, format " << times.format << " s)" << G4endl;
+                }
+                else {
+                    fOutputsWritten = false;
+                }
+            }
+
+
+
+            else {
+                G4cout << "No SiPM hits recorded in this run" << G4endl;
+            }
+
+            fTimer.Stop();
+            G4cout << "Event loop: " << run->GetNumberOfEvent() << " events in " << fTimer.GetRealElapsed()
+                << " s";
+            if (fTimer.GetRealElapsed() > 0.) {
+                G4cout << " (" << run->GetNumberOfEvent() / fTimer.GetRealElapsed() << " events/s)";
+            }
+            G4cout << G4endl;
+
+            PrintReplicaSummary();
+            AdaptiveStopping::PrintSummary();
+            if (ResponseMatrix::IsActive()) {
+                if (!fResponseMatrix.Write(ResponseMatrix::GetOutputFile())) fOutputsWritten = false;
+            }
+            SipmDigitizer::CloseOutput();
+            EventReconstructor::CloseOutput();
+            HitLibrary::CloseOutput();
+            StepTape::CloseOutput();
+            fMixer.PrintSummary();
+            fTrigger.PrintSummary();
+            fTileScorer.PrintSummary();
+            if (!TileScorer::Write(OutputPaths::TileDepositsName(run->GetRunID()))) fOutputsWritten = false;
+            if (!WriteSummary(run)) fOutputsWritten = false;
+
+            G4cout << "\n=================================" << G4endl;
+        }
+
+        // Write and close file
+        analysisManager->Write();
+        analysisManager->CloseFile(false);
+    }
+} // namespace G4_BREMS
+
+
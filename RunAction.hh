@@ -4,14 +4,32 @@
 
 #include "G4UserRunAction.hh"
 #include "G4Accumulable.hh"
+#include "G4Timer.hh"
+#include "ResponseMatrix.hh"
+#include "AdaptiveStopping.hh"
+#include "TileScorer.hh"
+#include "SipmDigitizer.hh"
+#include "CoincidenceTrigger.hh"
+#include "EventReconstructor.hh"
+#include "BackgroundMixer.hh"
+#include "ChannelHistograms.hh"
 #include "globals.hh"
 #include <map>
+#include <vector>
 
 class G4Run;
 
 namespace G4_BREMS {
 
     class SteppingAction;
+    class ResponseMessenger;
+    class AdaptiveMessenger;
+    class DigitizerMessenger;
+    class TriggerMessenger;
+    class ReconstructionMessenger;
+    class MixingMessenger;
+    class TapeMessenger;
+    class HitsMessenger;
 
     class RunAction : public G4UserRunAction
     {
@@ -35,7 +53,35 @@ namespace G4_BREMS {
         void AddProcessCount(const G4String& volume, const G4String& processName, bool isCreationProcess);
         G4double CalculateTrappingEfficiency() const;
 
+        // Hit library recording of the event's own hits, then background and dark-count pile-up
+        void MixEvent(G4int eventID, std::vector<SipmHit>& hits);
+
+        // Coincidence trigger and zero suppression, before the hits reach any output; false when
+        // the event is rejected
+        G4bool TriggerEvent(std::vector<SipmHit>& hits) { return !CoincidenceTrigger::IsEnabled() || fTrigger.Apply(hits); }
+
+        // Per-event tallies: Sobol replicas (replica < SobolSampler::kMaxReplicas, -1 for none),
+        // the response matrix and the adaptive-stopping estimators; the tile deposits, the
+        // digitizer and the reconstruction only for triggered events
+        void BeginOfEvent();
+        void EndOfEvent(G4int eventID, G4int replica, const std::vector<SipmHit>& hits, G4bool triggered);
+
+        // Sub-event mode: the photons of an event are tracked outside its EndOfEvent
+        void SetSubEventMode(G4bool subEventMode) { fSubEventMode = subEventMode; }
+
+        // False once an output of the last run on the master could not be written, so the
+        // multi-process workers can report it through their exit status
+        static G4bool OutputsWritten() { return fOutputsWritten; }
+
+        TileScorer& GetTileScorer() { return fTileScorer; }
+        ChannelHistograms& GetChannelHistograms() { return fChannelHistograms; }
+
     private:
+        // Merged counters as key,value csv, so shards can be summed by G4_Brems_merge
+        G4bool WriteSummary(const G4Run* run) const;
+        // Mean and standard error over the replicas that received events
+        void PrintReplicaSummary() const;
+
         G4int fTileCount;
         G4int fCladCount;
         G4int fCoreCount;
@@ -59,6 +105,43 @@ namespace G4_BREMS {
         std::map<G4String, G4Accumulable<G4int>*> fAccCreationCounts;
         std::map<G4String, G4Accumulable<G4int>*> fAccInteractionCounts;
 
+        std::vector<G4Accumulable<G4double>*> fAccReplicaEvents;
+        std::vector<G4Accumulable<G4double>*> fAccReplicaHits;
+        std::vector<G4Accumulable<G4double>*> fAccReplicaEntered;
+        std::vector<G4Accumulable<G4double>*> fAccReplicaAbsorbed;
+        G4int fEventEntered;
+        G4int fEventAbsorbed;
+
+        ResponseMatrix fResponseMatrix;
+        ResponseMessenger* fResponseMessenger;
+
+        AdaptiveStopping fAdaptiveStopping;
+        AdaptiveMessenger* fAdaptiveMessenger;
+
+        TileScorer fTileScorer;
+
+        SipmDigitizer fDigitizer;
+        DigitizerMessenger* fDigitizerMessenger;
+
+        CoincidenceTrigger fTrigger;
+        TriggerMessenger* fTriggerMessenger;
+
+        EventReconstructor fReconstructor;
+        ReconstructionMessenger* fReconstructionMessenger;
+
+        BackgroundMixer fMixer;
+        MixingMessenger* fMixingMessenger;
+        TapeMessenger* fTapeMessenger;
+
+        ChannelHistograms fChannelHistograms;
+        HitsMessenger* fHitsMessenger;
+
+        G4bool fSubEventMode;
+        static G4bool fOutputsWritten;
+
+        // Wall time of the event loop on the master, for throughput comparisons
+        G4Timer fTimer;
+
         SteppingAction* fSteppingAction;
     };
 
@@ -0,0 +1,273 @@
+
+#include "ScanMessenger.hh"
+#include "DetectorConstruction.hh"
+#include "OutputPaths.hh"
+#include "G4RunManager.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        // Grid file columns and the units their values are given in
+        struct ScanColumn {
+            const char* name;
+            G4double OpticalParameters::* member;
+            G4double unit;
+        };
+
+        const std::array<ScanColumn, 7> kColumns = { {
+            { "fiberReflectivity", &OpticalParameters::fiberReflectivity, 1. },
+            { "fiberTransmittance", &OpticalParameters::fiberTransmittance, 1. },
+            { "sipmReflectivity", &OpticalParameters::sipmReflectivity, 1. },
+            { "sipmTransmittance", &OpticalParameters::sipmTransmittance, 1. },
+            { "scintillationYield", &OpticalParameters::scintillationYield, 1. / MeV },
+            { "wlsTimeConstant", &OpticalParameters::wlsTimeConstant, ns },
+            { "layerSpacing", &OpticalParameters::layerSpacing, mm }
+        } };
+
+        G4int FindColumn(const G4String& name)
+        {
+            for (std::size_t i = 0; i < kColumns.size(); i++) {
+                if (name == kColumns[i].name) return static_cast<G4int>(i);
+            }
+            return -1;
+        }
+
+        G4bool IsValid(const OpticalParameters& parameters)
+        {
+            if (parameters.fiberReflectivity + parameters.fiberTransmittance > 1. + 1e-9 ||
+                parameters.sipmReflectivity + parameters.sipmTransmittance > 1. + 1e-9) {
+                G4Exception("ScanMessenger", "Scan_W003", JustWarning,
+                    "Reflectivity + transmittance exceeds 1, point skipped");
+                return false;
+            }
+            if (parameters.layerSpacing < 0.) {
+                G4Exception("ScanMessenger", "Scan_W004", JustWarning,
+                    "Negative layer spacing would overlap the first two layers, point skipped");
+                return false;
+            }
+            return true;
+        }
+    }
+
+    ScanMessenger::ScanMessenger(DetectorConstruction* detector)
+        : G4UImessenger(), fDetector(detector), fEventsPerPoint(1000)
+    {
+        fScanDirectory = new G4UIdirectory("/snf/scan/", false);
+        fScanDirectory->SetGuidance("Optical parameters changed in place between runs, and grid scans.");
+
+        fFiberReflectivityCmd = new G4UIcmdWithADouble("/snf/scan/fiberReflectivity", this);
+        fFiberReflectivityCmd->SetGuidance("REFLECTIVITY of the fiber and tile-fiber surfaces (default 0.5).");
+        fFiberReflectivityCmd->SetParameterName("value", false);
+        fFiberReflectivityCmd->SetRange("value >= 0 && value <= 1");
+
+        fFiberTransmittanceCmd = new G4UIcmdWithADouble("/snf/scan/fiberTransmittance", this);
+        fFiberTransmittanceCmd->SetGuidance("TRANSMITTANCE of the fiber and tile-fiber surfaces (default 0.5).");
+        fFiberTransmittanceCmd->SetParameterName("value", false);
+        fFiberTransmittanceCmd->SetRange("value >= 0 && value <= 1");
+
+        fSipmReflectivityCmd = new G4UIcmdWithADouble("/snf/scan/sipmReflectivity", this);
+        fSipmReflectivityCmd->SetGuidance("REFLECTIVITY of the fiber-SiPM surface (default 0.1).");
+        fSipmReflectivityCmd->SetParameterName("value", false);
+        fSipmReflectivityCmd->SetRange("value >= 0 && value <= 1");
+
+        fSipmTransmittanceCmd = new G4UIcmdWithADouble("/snf/scan/sipmTransmittance", this);
+        fSipmTransmittanceCmd->SetGuidance("TRANSMITTANCE of the fiber-SiPM surface (default 0.9).");
+        fSipmTransmittanceCmd->SetParameterName("value", false);
+        fSipmTransmittanceCmd->SetRange("value >= 0 && value <= 1");
+
+        fScintillationYieldCmd = new G4UIcmdWithADouble("/snf/scan/scintillationYield", this);
+        fScintillationYieldCmd->SetGuidance("SCINTILLATIONYIELD of the tiles in photons/MeV (default 12000).");
+        fScintillationYieldCmd->SetParameterName("yield", false);
+        fScintillationYieldCmd->SetRange("yield >= 0");
+
+        fWlsTimeConstantCmd = new G4UIcmdWithADoubleAndUnit("/snf/scan/wlsTimeConstant", this);
+        fWlsTimeConstantCmd->SetGuidance("WLSTIMECONSTANT of the fiber core (default 0.5 ns).");
+        fWlsTimeConstantCmd->SetParameterName("time", false);
+        fWlsTimeConstantCmd->SetDefaultUnit("ns");
+
+        fLayerSpacingCmd = new G4UIcmdWithADoubleAndUnit("/snf/scan/layerSpacing", this);
+        fLayerSpacingCmd->SetGuidance("Extra gap between the first bottom and top layers (default 0.1 mm).");
+        fLayerSpacingCmd->SetGuidance("The layers above move rigidly; the placements are shifted, not rebuilt.");
+        fLayerSpacingCmd->SetParameterName("spacing", false);
+        fLayerSpacingCmd->SetDefaultUnit("mm");
+
+        fGridFileCmd = new G4UIcmdWithAString("/snf/scan/gridFile", this);
+        fGridFileCmd->SetGuidance("Scan grid: a header of parameter names, then one line of values per point.");
+        fGridFileCmd->SetGuidance("Units: photons/MeV, ns and mm; parameters without a column keep their value.");
+        fGridFileCmd->SetParameterName("file", false);
+
+        fEventsPerPointCmd = new G4UIcmdWithAnInteger("/snf/scan/eventsPerPoint", this);
+        fEventsPerPointCmd->SetGuidance("Events simulated at every scan point (default 1000).");
+        fEventsPerPointCmd->SetParameterName("events", false);
+        fEventsPerPointCmd->SetRange("events > 0");
+
+        fRunCmd = new G4UIcmdWithoutParameter("/snf/scan/run", this);
+        fRunCmd->SetGuidance("One run per grid point, outputs tagged scan<point>; restores the parameters after.");
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fFiberReflectivityCmd,
+            fFiberTransmittanceCmd, fSipmReflectivityCmd, fSipmTransmittanceCmd, fScintillationYieldCmd,
+            fWlsTimeConstantCmd, fLayerSpacingCmd, fGridFileCmd, fEventsPerPointCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+        fRunCmd->AvailableForStates(G4State_Idle);
+        fRunCmd->SetToBeBroadcasted(false);
+    }
+
+    ScanMessenger::~ScanMessenger()
+    {
+        delete fFiberReflectivityCmd;
+        delete fFiberTransmittanceCmd;
+        delete fSipmReflectivityCmd;
+        delete fSipmTransmittanceCmd;
+        delete fScintillationYieldCmd;
+        delete fWlsTimeConstantCmd;
+        delete fLayerSpacingCmd;
+        delete fGridFileCmd;
+        delete fEventsPerPointCmd;
+        delete fRunCmd;
+        delete fScanDirectory;
+    }
+
+    G4bool ScanMessenger::ReadGridFile(const G4String& path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            G4cerr << "Error: Could not open " << path << G4endl;
+            return false;
+        }
+
+        fColumns.clear();
+        fPoints.clear();
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream iss(line);
+
+            if (fColumns.empty()) {
+                std::string name;
+                while (iss >> name) {
+                    G4int column = FindColumn(name);
+                    if (column < 0) {
+                        G4cerr << "Error: Unknown scan parameter " << name << " in " << path << G4endl;
+                        fColumns.clear();
+                        return false;
+                    }
+                    fColumns.push_back(column);
+                }
+                continue;
+            }
+
+            std::vector<G4double> values;
+            G4double value;
+            while (iss >> value) values.push_back(value);
+            if (values.size() != fColumns.size()) {
+                G4cerr << "Error: Expected " << fColumns.size() << " values in line '" << line
+                    << "' of " << path << G4endl;
+                fPoints.clear();
+                return false;
+            }
+            for (std::size_t i = 0; i < values.size(); i++) values[i] *= kColumns[fColumns[i]].unit;
+            fPoints.push_back(values);
+        }
+
+        G4cout << "Scan grid: " << fPoints.size() << " points over " << fColumns.size()
+            << " parameters from " << path << G4endl;
+        return true;
+    }
+
+    void ScanMessenger::SetParameter(G4int column, G4double value)
+    {
+        OpticalParameters parameters = fDetector->GetOpticalParameters();
+        parameters.*(kColumns[column].member) = value;
+        if (IsValid(parameters)) fDetector->SetOpticalParameters(parameters);
+    }
+
+    void ScanMessenger::Run()
+    {
+        if (fPoints.empty()) {
+            G4Exception("ScanMessenger::Run()", "Scan_W005", JustWarning,
+                "Scan grid is empty, set /snf/scan/gridFile first");
+            return;
+        }
+
+        const OpticalParameters baseline = fDetector->GetOpticalParameters();
+        const G4String baseTag = OutputPaths::GetTag();
+
+        std::ofstream index(OutputPaths::ScanIndexName());
+        index << "Point,Tag";
+        for (const auto& column : kColumns) index << "," << column.name;
+        index << std::endl;
+
+        for (std::size_t point = 0; point < fPoints.size(); point++) {
+            OpticalParameters parameters = baseline;
+            for (std::size_t i = 0; i < fColumns.size(); i++) {
+                parameters.*(kColumns[fColumns[i]].member) = fPoints[point][i];
+            }
+            if (!IsValid(parameters)) continue;
+            fDetector->SetOpticalParameters(parameters);
+
+            char number[16];
+            std::snprintf(number, sizeof(number), "scan%03zu", point);
+            G4String tag = baseTag.empty() ? G4String(number) : baseTag + "_" + number;
+            OutputPaths::SetTag(tag);
+
+            index << point << "," << tag;
+            for (const auto& column : kColumns) index << "," << parameters.*(column.member) / column.unit;
+            index << std::endl;
+
+            G4cout << "Scan point " << point + 1 << "/" << fPoints.size() << ": " << tag << G4endl;
+            G4RunManager::GetRunManager()->BeamOn(fEventsPerPoint);
+        }
+
+        OutputPaths::SetTag(baseTag);
+        fDetector->SetOpticalParameters(baseline);
+    }
+
+    void ScanMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        if (command == fFiberReflectivityCmd) {
+            SetParameter(0, fFiberReflectivityCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fFiberTransmittanceCmd) {
+            SetParameter(1, fFiberTransmittanceCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fSipmReflectivityCmd) {
+            SetParameter(2, fSipmReflectivityCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fSipmTransmittanceCmd) {
+            SetParameter(3, fSipmTransmittanceCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fScintillationYieldCmd) {
+            SetParameter(4, fScintillationYieldCmd->GetNewDoubleValue(newValue) / MeV);
+        }
+        else if (command == fWlsTimeConstantCmd) {
+            SetParameter(5, fWlsTimeConstantCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fLayerSpacingCmd) {
+            SetParameter(6, fLayerSpacingCmd->GetNewDoubleValue(newValue));
+        }
+        else if (command == fGridFileCmd) {
+            ReadGridFile(newValue);
+        }
+        else if (command == fEventsPerPointCmd) {
+            fEventsPerPoint = fEventsPerPointCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fRunCmd) {
+            Run();
+        }
+    }
+}
@@ -0,0 +1,56 @@
+
+#ifndef G4_BREMS_SCAN_MESSENGER_H
+#define G4_BREMS_SCAN_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+#include <vector>
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADouble;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithoutParameter;
+
+namespace G4_BREMS {
+    class DetectorConstruction;
+    struct OpticalParameters;
+
+    // /snf/scan/: optical parameters changed between runs on the constructed detector, and
+    // scans over a grid file with one run per point (master only)
+    class ScanMessenger : public G4UImessenger
+    {
+    public:
+        ScanMessenger(DetectorConstruction* detector);
+        ~ScanMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        // Header line of column names followed by one line of values per scan point
+        G4bool ReadGridFile(const G4String& path);
+        void SetParameter(G4int column, G4double value);
+        void Run();
+
+        DetectorConstruction* fDetector;
+
+        std::vector<G4int> fColumns;
+        std::vector<std::vector<G4double>> fPoints;
+        G4int fEventsPerPoint;
+
+        G4UIdirectory* fScanDirectory;
+        G4UIcmdWithADouble* fFiberReflectivityCmd;
+        G4UIcmdWithADouble* fFiberTransmittanceCmd;
+        G4UIcmdWithADouble* fSipmReflectivityCmd;
+        G4UIcmdWithADouble* fSipmTransmittanceCmd;
+        G4UIcmdWithADouble* fScintillationYieldCmd;
+        G4UIcmdWithADoubleAndUnit* fWlsTimeConstantCmd;
+        G4UIcmdWithADoubleAndUnit* fLayerSpacingCmd;
+        G4UIcmdWithAString* fGridFileCmd;
+        G4UIcmdWithAnInteger* fEventsPerPointCmd;
+        G4UIcmdWithoutParameter* fRunCmd;
+    };
+}
+
+#endif
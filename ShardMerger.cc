@@ -0,0 +1,827 @@
+
+#include "ShardMerger.hh"
+#include "OutputPaths.hh"
+#include "G4RootAnalysisReader.hh"
+#include "tools/histo/h1d"
+#include "tools/histo/h2d"
+#include "tools/wroot/file"
+#include "tools/wroot/to"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+
+namespace G4_BREMS {
+
+    namespace {
+        // Histograms booked by RunAction
+        const std::vector<G4String> kH1Names = {
+            "edep", "time", "PhotonEnergyBeforeWLS", "PhotonEnergyAfterWLS",
+            "PhotonWavelengthBeforeWLS", "PhotonWavelengthAfterWLS", "CladdingWavelength",
+            "CladdingEnergy", "CoreWavelength", "CoreEnergy", "WLSEmissionSpectrum",
+            "SipmTimeSpectrum", "SipmWavelength"
+        };
+        const std::vector<G4String> kH2Names = {
+            "timing_xy", "timing_yz", "timing_xz", "edep_xy", "edep_yz", "edep_xz",
+            "clad_xy", "clad_yz", "clad_xz", "core_xy", "core_yz", "core_xz",
+            "Sipm_Timing_xy", "Sipm_Timing_yz", "Sipm_Timing_xz"
+        };
+
+        G4bool FileExists(const G4String& path) {
+            std::ifstream in(path);
+            return in.good();
+        }
+
+        G4String WithRootExtension(const G4String& name) {
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".root") == 0) return name;
+            return name + ".root";
+        }
+
+        // One row of a hits csv: SipmName,Time(ns),...,TimeBin(ns),PhotonsInBin[,extra columns]
+        struct HitRow {
+            std::string line;
+            std::string sipmName;
+            G4double time = 0.;
+            std::size_t shard = 0;
+        };
+
+        G4bool ParseHitRow(const std::string& line, HitRow& row) {
+            std::size_t first = line.find(',');
+            if (first == std::string::npos) return false;
+            std::size_t second = line.find(',', first + 1);
+            row.line = line;
+            row.sipmName = line.substr(0, first);
+            row.time = std::stod(line.substr(first + 1, second - first - 1));
+            return true;
+        }
+
+        // Column 7 is the time bin label, column 8 the photon count in that bin
+        std::string Field(const std::string& line, std::size_t index) {
+            std::size_t begin = 0;
+            for (std::size_t i = 0; i < index; i++) {
+                begin = line.find(',', begin);
+                if (begin == std::string::npos) return "";
+                begin++;
+            }
+            std::size_t end = line.find(',', begin);
+            return line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        }
+
+        std::string ReplaceField(const std::string& line, std::size_t index, const std::string& value) {
+            std::size_t begin = 0;
+            for (std::size_t i = 0; i < index; i++) {
+                begin = line.find(',', begin);
+                if (begin == std::string::npos) return line;
+                begin++;
+            }
+            std::size_t end = line.find(',', begin);
+            return line.substr(0, begin) + value + (end == std::string::npos ? "" : line.substr(end));
+        }
+
+        template <typename T>
+        G4bool ReadValue(std::istream& in, T& value) {
+            return static_cast<G4bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        template <typename T>
+        void WriteValue(std::ostream& out, const T& value) {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        // Layout of response_matrix.bin, see ResponseMatrix.hh
+        const char kResponseMagic[8] = { 'S', 'N', 'F', 'R', 'E', 'S', 'P', '1' };
+
+        struct ResponseHeader {
+            std::string bytes;          // magic, sizes and grid, compared between shards
+            std::uint32_t channels = 0;
+            std::uint32_t peBins = 0;
+            std::uint32_t timeBins = 0;
+            std::size_t points = 0;
+        };
+
+        G4bool ReadResponseHeader(std::istream& in, ResponseHeader& header) {
+            char magic[8];
+            std::uint32_t energies = 0;
+            std::uint32_t positions = 0;
+            G4double timeMax = 0.;
+            if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kResponseMagic, sizeof(magic)) != 0) return false;
+            if (!ReadValue(in, header.channels) || !ReadValue(in, energies) || !ReadValue(in, positions)
+                || !ReadValue(in, header.peBins) || !ReadValue(in, header.timeBins) || !ReadValue(in, timeMax)) return false;
+            header.points = static_cast<std::size_t>(energies) * positions;
+            const std::size_t gridBytes = (energies + 3 * positions) * sizeof(G4double);
+            const std::size_t fixedBytes = sizeof(magic) + 5 * sizeof(std::uint32_t) + sizeof(G4double);
+            header.bytes.resize(fixedBytes + gridBytes);
+            in.seekg(0);
+            return static_cast<G4bool>(in.read(header.bytes.data(), header.bytes.size()));
+        }
+
+        // Layouts of the per-event outputs, see TileScorer.hh, SipmDigitizer.hh, HitLibrary.hh
+        // and StepTape.hh. The headers must agree between shards.
+        const char kTileMagic[8] = { 'S', 'N', 'F', 'T', 'I', 'L', 'E', '1' };
+        const char kDigiMagic[8] = { 'S', 'N', 'F', 'D', 'I', 'G', 'I', '1' };
+        const char kLibraryMagic[8] = { 'S', 'N', 'F', 'H', 'L', 'I', 'B', '1' };
+        const char kTapeMagic[8] = { 'S', 'N', 'F', 'T', 'A', 'P', 'E', '2' };
+        constexpr std::size_t kTileHeaderBytes = 8 + 3 * sizeof(std::uint32_t);     // record count follows
+        constexpr std::size_t kTileRecordBytes = 2 * sizeof(std::uint32_t) + 4 * sizeof(float);
+        constexpr std::size_t kDigiHeaderBytes = 8 + 2 * sizeof(std::uint32_t) + 2 * sizeof(float) + sizeof(std::uint32_t);
+        constexpr std::size_t kLibraryHeaderBytes = 8 + sizeof(std::uint32_t);
+        constexpr std::size_t kLibraryHitBytes = sizeof(std::int32_t) + 6 * sizeof(float);
+        constexpr std::size_t kTapeHeaderBytes = 8;
+        // Columns of a step after its event number: track, four codes, channel, ten floats
+        constexpr std::size_t kTapeStepBytes = sizeof(std::uint32_t) + 4 + sizeof(std::int16_t) + 10 * sizeof(float);
+
+        // A shard's per-event file and the number of events of the shards before it, which
+        // is added to its (shard-local) event numbers
+        struct EventFile {
+            std::unique_ptr<std::ifstream> in;
+            G4String path;
+            std::uint32_t eventOffset = 0;
+        };
+
+        // Opens the files that exist; false with a message if a header differs from the first
+        G4bool OpenEventFiles(const std::vector<G4String>& paths, const std::vector<std::uint32_t>& offsets,
+            const char (&magic)[8], std::size_t headerBytes, std::vector<EventFile>& files, std::string& header) {
+            for (std::size_t shard = 0; shard < paths.size(); shard++) {
+                auto in = std::make_unique<std::ifstream>(paths[shard], std::ios::binary);
+                if (!in->is_open()) continue;
+                std::string bytes(headerBytes, '\0');
+                if (!in->read(bytes.data(), bytes.size()) || bytes.compare(0, sizeof(magic), magic, sizeof(magic)) != 0) {
+                    G4cerr << "Error: " << paths[shard] << " has no valid header" << G4endl;
+                    return false;
+                }
+                if (files.empty()) {
+                    header = bytes;
+                }
+                else if (bytes != header) {
+                    G4cerr << "Error: the header of " << paths[shard] << " differs from the other shards" << G4endl;
+                    return false;
+                }
+                files.push_back(EventFile{ std::move(in), paths[shard], offsets[shard] });
+            }
+            return true;
+        }
+
+        G4bool CopyBytes(std::istream& in, std::ostream& out, std::uint64_t count, std::vector<char>& buffer) {
+            buffer.resize(1 << 20);
+            while (count > 0) {
+                const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(count, buffer.size()));
+                if (!in.read(buffer.data(), chunk)) return false;
+                out.write(buffer.data(), chunk);
+                count -= chunk;
+            }
+            return true;
+        }
+
+        // Adds offset to the event number in the first column of a csv row
+        std::string OffsetEvent(const std::string& line, std::uint32_t offset) {
+            const std::size_t comma = line.find(',');
+            return std::to_string(std::stoull(line.substr(0, comma)) + offset)
+                + (comma == std::string::npos ? "" : line.substr(comma));
+        }
+
+        struct LaterRow {
+            bool operator()(const HitRow& a, const HitRow& b) const {
+                if (a.sipmName != b.sipmName) return a.sipmName > b.sipmName;
+                if (a.time != b.time) return a.time > b.time;
+                return a.shard > b.shard;
+            }
+        };
+    }
+
+    ShardMerger::ShardMerger(const std::vector<G4String>& shardStems, const G4String& outputStem, G4int runID)
+        : fShardStems(shardStems), fOutputStem(outputStem), fRunID(runID)
+    {
+    }
+
+    G4bool ShardMerger::Merge() const
+    {
+        auto summaries = std::async(std::launch::async, [this]() { return MergeSummaries(); });
+        auto hits = std::async(std::launch::async, [this]() { return MergeHits(); });
+        auto response = std::async(std::launch::async, [this]() { return MergeResponseMatrices(); });
+        auto channels = std::async(std::launch::async, [this]() { return MergeChannelHistograms(); });
+        auto events = std::async(std::launch::async, [this]() { return MergeEventOutputs(); });
+
+        G4bool ok = MergeHistograms();
+        ok = summaries.get() && ok;
+        ok = hits.get() && ok;
+        ok = response.get() && ok;
+        ok = channels.get() && ok;
+        ok = events.get() && ok;
+        return ok;
+    }
+
+    G4bool ShardMerger::MergeHistograms() const
+    {
+        std::vector<G4String> analysisFiles;
+        std::vector<G4String> hitsFiles;
+        for (const auto& stem : fShardStems) {
+            analysisFiles.push_back(WithRootExtension(OutputPaths::AnalysisFileName(stem)));
+            hitsFiles.push_back(OutputPaths::SipmHitsFileName(stem));
+        }
+
+        G4bool ok = MergeHistogramFile(analysisFiles, WithRootExtension(OutputPaths::AnalysisFileName(fOutputStem)));
+        ok = MergeHistogramFile(hitsFiles, OutputPaths::SipmHitsFileName(fOutputStem)) && ok;
+        return ok;
+    }
+
+    G4bool ShardMerger::MergeHistogramFile(const std::vector<G4String>& inputs, const G4String& output) const
+    {
+        std::vector<G4String> existing;
+        for (const auto& input : inputs) {
+            if (FileExists(input)) existing.push_back(input);
+        }
+        if (existing.empty()) return true;
+
+        auto reader = G4RootAnalysisReader::Instance();
+        reader->SetVerboseLevel(0);
+
+        std::vector<std::pair<G4String, std::unique_ptr<tools::histo::h1d>>> h1s;
+        std::vector<std::pair<G4String, std::unique_ptr<tools::histo::h2d>>> h2s;
+
+        for (const auto& name : kH1Names) {
+            std::unique_ptr<tools::histo::h1d> merged;
+            for (const auto& input : existing) {
+                G4int id = reader->ReadH1(name, input);
+                if (id < 0) continue;
+                auto histo = reader->GetH1(id);
+                if (!histo) continue;
+                if (!merged) {
+                    merged = std::make_unique<tools::histo::h1d>(*histo);
+                }
+                else if (!merged->add(*histo)) {
+                    G4cerr << "Error: incompatible binning of " << name << " in " << input << G4endl;
+                    return false;
+                }
+            }
+            if (merged) h1s.emplace_back(name, std::move(merged));
+        }
+
+        for (const auto& name : kH2Names) {
+            std::unique_ptr<tools::histo::h2d> merged;
+            for (const auto& input : existing) {
+                G4int id = reader->ReadH2(name, input);
+                if (id < 0) continue;
+                auto histo = reader->GetH2(id);
+                if (!histo) continue;
+                if (!merged) {
+                    merged = std::make_unique<tools::histo::h2d>(*histo);
+                }
+                else if (!merged->add(*histo)) {
+                    G4cerr << "Error: incompatible binning of " << name << " in " << input << G4endl;
+                    return false;
+                }
+            }
+            if (merged) h2s.emplace_back(name, std::move(merged));
+        }
+
+        tools::wroot::file rootFile(G4cout, output);
+        if (!rootFile.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        for (const auto& entry : h1s) {
+            tools::wroot::to(rootFile.dir(), *entry.second, entry.first);
+        }
+        for (const auto& entry : h2s) {
+            tools::wroot::to(rootFile.dir(), *entry.second, entry.first);
+        }
+        unsigned int nbytes = 0;
+        G4bool ok = rootFile.write(nbytes);
+        rootFile.close();
+
+        G4cout << "Merged " << h1s.size() << " H1 and " << h2s.size() << " H2 from "
+            << existing.size() << " shards into " << output << G4endl;
+        return ok;
+    }
+
+    G4bool ShardMerger::MergeSummaries() const
+    {
+        std::vector<std::string> keys;
+        std::map<std::string, long long> sums;
+
+        for (const auto& stem : fShardStems) {
+            G4String path = OutputPaths::SummaryCsvName(stem, fRunID);
+            std::ifstream in(path);
+            if (!in.is_open()) {
+                G4cerr << "Warning: missing summary " << path << G4endl;
+                continue;
+            }
+            std::string line;
+            std::getline(in, line); // header
+            while (std::getline(in, line)) {
+                std::size_t comma = line.find(',');
+                if (comma == std::string::npos) continue;
+                std::string key = line.substr(0, comma);
+                if (key == "TrappingEfficiency") continue;
+                if (sums.find(key) == sums.end()) keys.push_back(key);
+                sums[key] += std::stoll(line.substr(comma + 1));
+            }
+        }
+        if (keys.empty()) return true;
+
+        G4String output = OutputPaths::SummaryCsvName(fOutputStem, fRunID);
+        std::ofstream out(output);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out << "Key,Value" << std::endl;
+        for (const auto& key : keys) {
+            out << key << "," << sums[key] << std::endl;
+        }
+        long long entered = sums["PhotonsEnteredFiber"];
+        long long absorbed = sums["PhotonsAbsorbedFiber"];
+        G4double trappingEfficiency = (entered > 0) ? static_cast<G4double>(absorbed) / entered : 0.0;
+        out << "TrappingEfficiency," << trappingEfficiency << std::endl;
+
+        G4cout << "Merged summaries: trapping efficiency " << trappingEfficiency * 100.0 << "% ("
+            << absorbed << " / " << entered << ")" << G4endl;
+        return true;
+    }
+
+    G4bool ShardMerger::MergeHits() const
+    {
+        std::vector<std::unique_ptr<std::ifstream>> inputs;
+        std::string header;
+        for (const auto& stem : fShardStems) {
+            auto in = std::make_unique<std::ifstream>(OutputPaths::SipmHitsCsvName(stem, fRunID));
+            if (!in->is_open()) continue;
+            std::string line;
+            if (std::getline(*in, line) && header.empty()) header = line;
+            inputs.push_back(std::move(in));
+        }
+        if (inputs.empty()) return true;
+
+        G4String output = OutputPaths::SipmHitsCsvName(fOutputStem, fRunID);
+        std::ofstream out(output);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out << header << std::endl;
+
+        // Every shard is already ordered by (SiPM name, time), so a k-way merge keeps the global
+        // order and the hits of one (SiPM, time bin) are contiguous: only that group is buffered.
+        std::priority_queue<HitRow, std::vector<HitRow>, LaterRow> queue;
+        auto advance = [&](std::size_t shard) {
+            std::string line;
+            HitRow row;
+            while (std::getline(*inputs[shard], line)) {
+                if (ParseHitRow(line, row)) {
+                    row.shard = shard;
+                    queue.push(std::move(row));
+                    return;
+                }
+            }
+        };
+        for (std::size_t shard = 0; shard < inputs.size(); shard++) advance(shard);
+
+        std::vector<std::string> group;
+        std::string groupSipm;
+        std::string groupBin;
+        std::size_t written = 0;
+        auto flush = [&]() {
+            const std::string count = std::to_string(group.size());
+            for (const auto& line : group) {
+                out << ReplaceField(line, 8, count) << '\n';
+            }
+            written += group.size();
+            group.clear();
+        };
+
+        while (!queue.empty()) {
+            HitRow row = queue.top();
+            queue.pop();
+            advance(row.shard);
+
+            std::string bin = Field(row.line, 7);
+            if (row.sipmName != groupSipm || bin != groupBin) {
+                flush();
+                groupSipm = row.sipmName;
+                groupBin = bin;
+            }
+            group.push_back(std::move(row.line));
+        }
+        flush();
+
+        G4cout << "Merged " << written << " SiPM hits from " << inputs.size() << " shards into "
+            << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeResponseMatrices() const
+    {
+        ResponseHeader header;
+        std::vector<std::uint64_t> events;
+        std::vector<G4double> sumPe, sumPe2, hitEvents;
+        std::vector<std::uint32_t> peHist, timeHist;
+        std::size_t merged = 0;
+
+        for (const auto& stem : fShardStems) {
+            const G4String path = OutputPaths::ResponseMatrixName(stem);
+            std::ifstream in(path, std::ios::binary);
+            if (!in.is_open()) continue;
+            ResponseHeader shardHeader;
+            if (!ReadResponseHeader(in, shardHeader)) {
+                G4cerr << "Error: " << path << " is not a response matrix" << G4endl;
+                return false;
+            }
+            if (merged == 0) {
+                header = shardHeader;
+                const std::size_t cells = header.points * header.channels;
+                events.assign(header.points, 0);
+                sumPe.assign(cells, 0.);
+                sumPe2.assign(cells, 0.);
+                hitEvents.assign(cells, 0.);
+                peHist.assign(cells * header.peBins, 0);
+                timeHist.assign(cells * header.timeBins, 0);
+            }
+            else if (shardHeader.bytes != header.bytes) {
+                G4cerr << "Error: the response grid of " << path << " differs from the other shards" << G4endl;
+                return false;
+            }
+
+            std::vector<std::uint64_t> offsets(header.points);
+            std::vector<std::uint64_t> shardEvents(header.points);
+            for (std::size_t point = 0; point < header.points; point++) {
+                ReadValue(in, offsets[point]);
+                ReadValue(in, shardEvents[point]);
+            }
+            for (std::size_t point = 0; point < header.points && in; point++) {
+                in.seekg(static_cast<std::streamoff>(offsets[point]));
+                const G4double n = static_cast<G4double>(shardEvents[point]);
+                events[point] += shardEvents[point];
+                for (std::uint32_t channel = 0; channel < header.channels; channel++) {
+                    const std::size_t cell = point * header.channels + channel;
+                    float mean = 0.f, rms = 0.f, hitFraction = 0.f;
+                    ReadValue(in, mean);
+                    ReadValue(in, rms);
+                    ReadValue(in, hitFraction);
+                    // Back to the sums the mean, rms and fraction were made from
+                    sumPe[cell] += mean * n;
+                    sumPe2[cell] += (static_cast<G4double>(rms) * rms + static_cast<G4double>(mean) * mean) * n;
+                    hitEvents[cell] += hitFraction * n;
+                    for (std::uint32_t bin = 0; bin < header.peBins; bin++) {
+                        std::uint32_t count = 0;
+                        ReadValue(in, count);
+                        peHist[cell * header.peBins + bin] += count;
+                    }
+                    for (std::uint32_t bin = 0; bin < header.timeBins; bin++) {
+                        std::uint32_t count = 0;
+                        ReadValue(in, count);
+                        timeHist[cell * header.timeBins + bin] += count;
+                    }
+                }
+            }
+            if (!in) {
+                G4cerr << "Error: " << path << " is truncated" << G4endl;
+                return false;
+            }
+            merged++;
+        }
+        if (merged == 0) return true;
+
+        const G4String output = OutputPaths::ResponseMatrixName(fOutputStem);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out.write(header.bytes.data(), header.bytes.size());
+        const std::uint64_t blockSize = header.channels
+            * (3 * sizeof(float) + (header.peBins + header.timeBins) * sizeof(std::uint32_t));
+        const std::uint64_t firstBlock = header.bytes.size() + header.points * 2 * sizeof(std::uint64_t);
+        for (std::size_t point = 0; point < header.points; point++) {
+            WriteValue(out, firstBlock + point * blockSize);
+            WriteValue(out, events[point]);
+        }
+        for (std::size_t point = 0; point < header.points; point++) {
+            const G4double n = static_cast<G4double>(events[point]);
+            for (std::uint32_t channel = 0; channel < header.channels; channel++) {
+                const std::size_t cell = point * header.channels + channel;
+                const G4double mean = (n > 0) ? sumPe[cell] / n : 0.;
+                const G4double variance = (n > 0) ? sumPe2[cell] / n - mean * mean : 0.;
+                WriteValue(out, static_cast<float>(mean));
+                WriteValue(out, static_cast<float>(std::sqrt(std::max(0., variance))));
+                WriteValue(out, static_cast<float>((n > 0) ? hitEvents[cell] / n : 0.));
+                out.write(reinterpret_cast<const char*>(peHist.data() + cell * header.peBins),
+                    header.peBins * sizeof(std::uint32_t));
+                out.write(reinterpret_cast<const char*>(timeHist.data() + cell * header.timeBins),
+                    header.timeBins * sizeof(std::uint32_t));
+            }
+        }
+
+        G4cout << "Merged response matrices of " << header.points << " grid points from " << merged
+            << " shards into " << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeChannelHistograms() const
+    {
+        // Rows in the order of the first shard; the edges of a bin must agree in every shard
+        struct Bin {
+            std::string low;
+            std::string high;
+            unsigned long long count = 0;
+        };
+        std::vector<std::string> keys;
+        std::map<std::string, Bin> bins;
+        std::string header;
+        std::size_t merged = 0;
+
+        for (const auto& stem : fShardStems) {
+            const G4String path = OutputPaths::ChannelHistogramsName(stem, fRunID);
+            std::ifstream in(path);
+            if (!in.is_open()) continue;
+            std::string line;
+            if (std::getline(in, line) && header.empty()) header = line;
+            while (std::getline(in, line)) {
+                if (line.empty()) continue;
+                // Channel,Histogram,Bin identify the bin
+                std::size_t keyEnd = line.find(',');
+                if (keyEnd != std::string::npos) keyEnd = line.find(',', keyEnd + 1);
+                if (keyEnd != std::string::npos) keyEnd = line.find(',', keyEnd + 1);
+                if (keyEnd == std::string::npos) continue;
+                const std::string key = line.substr(0, keyEnd);
+                const std::string low = Field(line, 3);
+                const std::string high = Field(line, 4);
+                auto found = bins.find(key);
+                if (found == bins.end()) {
+                    keys.push_back(key);
+                    found = bins.emplace(key, Bin{ low, high, 0 }).first;
+                }
+                else if (found->second.low != low || found->second.high != high) {
+                    G4cerr << "Error: bin " << key << " of " << path << " spans " << low << "-" << high
+                        << ", other shards " << found->second.low << "-" << found->second.high << G4endl;
+                    return false;
+                }
+                found->second.count += std::stoull(Field(line, 5));
+            }
+            merged++;
+        }
+        if (merged == 0) return true;
+
+        const G4String output = OutputPaths::ChannelHistogramsName(fOutputStem, fRunID);
+        std::ofstream out(output);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out << header << '\n';
+        for (const auto& key : keys) {
+            const Bin& bin = bins[key];
+            out << key << ',' << bin.low << ',' << bin.high << ',' << bin.count << '\n';
+        }
+
+        G4cout << "Merged " << keys.size() << " channel histogram bins from " << merged << " shards into "
+            << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    std::vector<std::uint32_t> ShardMerger::EventOffsets() const
+    {
+        // Shards number their events from 0; in the merged files they follow each other
+        std::vector<std::uint32_t> offsets;
+        std::uint64_t events = 0;
+        for (const auto& stem : fShardStems) {
+            offsets.push_back(static_cast<std::uint32_t>(events));
+            const G4String path = OutputPaths::SummaryCsvName(stem, fRunID);
+            std::ifstream in(path);
+            if (!in.is_open()) continue;
+            std::string line;
+            while (std::getline(in, line)) {
+                if (line.rfind("Events,", 0) == 0) {
+                    events += std::stoull(line.substr(7));
+                    break;
+                }
+            }
+        }
+        return offsets;
+    }
+
+    G4bool ShardMerger::MergeEventOutputs() const
+    {
+        const auto offsets = EventOffsets();
+        G4bool ok = MergeTileDeposits(offsets);
+        ok = MergeDigits(offsets) && ok;
+        ok = MergeEventCsv(offsets, OutputPaths::FeaturesName, "digitized features") && ok;
+        ok = MergeEventCsv(offsets, OutputPaths::ReconstructionName, "reconstructed events") && ok;
+        ok = MergeHitLibraries(offsets) && ok;
+        ok = MergeStepTapes(offsets) && ok;
+        return ok;
+    }
+
+    G4bool ShardMerger::MergeTileDeposits(const std::vector<std::uint32_t>& offsets) const
+    {
+        std::vector<G4String> paths;
+        for (const auto& stem : fShardStems) paths.push_back(OutputPaths::TileDepositsName(stem, fRunID));
+        std::vector<EventFile> files;
+        std::string header;
+        if (!OpenEventFiles(paths, offsets, kTileMagic, kTileHeaderBytes, files, header)) return false;
+        if (files.empty()) return true;
+
+        std::vector<std::uint64_t> records(files.size(), 0);
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < files.size(); i++) {
+            ReadValue(*files[i].in, records[i]);
+            total += records[i];
+        }
+
+        const G4String output = OutputPaths::TileDepositsName(fOutputStem, fRunID);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out.write(header.data(), header.size());
+        WriteValue(out, total);
+        // Each shard is sorted by (event, cell) and the offsets grow, so the merged file is too
+        std::vector<char> record(kTileRecordBytes);
+        for (std::size_t i = 0; i < files.size(); i++) {
+            for (std::uint64_t r = 0; r < records[i]; r++) {
+                if (!files[i].in->read(record.data(), record.size())) {
+                    G4cerr << "Error: " << files[i].path << " is truncated" << G4endl;
+                    return false;
+                }
+                std::uint32_t event = 0;
+                std::memcpy(&event, record.data(), sizeof(event));
+                event += files[i].eventOffset;
+                std::memcpy(record.data(), &event, sizeof(event));
+                out.write(record.data(), record.size());
+            }
+        }
+
+        G4cout << "Merged " << total << " tile deposits from " << files.size() << " shards into " << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeDigits(const std::vector<std::uint32_t>& offsets) const
+    {
+        std::vector<G4String> paths;
+        for (const auto& stem : fShardStems) paths.push_back(OutputPaths::DigitsName(stem, fRunID));
+        std::vector<EventFile> files;
+        std::string header;
+        if (!OpenEventFiles(paths, offsets, kDigiMagic, kDigiHeaderBytes, files, header)) return false;
+        if (files.empty()) return true;
+
+        const G4String output = OutputPaths::DigitsName(fOutputStem, fRunID);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out.write(header.data(), header.size());
+        // Events are uint32 size (bytes, these two words included), uint32 event, mask and samples
+        std::vector<char> buffer;
+        std::size_t events = 0;
+        for (auto& file : files) {
+            std::uint32_t eventSize = 0;
+            std::uint32_t eventID = 0;
+            while (ReadValue(*file.in, eventSize)) {
+                if (eventSize < 2 * sizeof(std::uint32_t) || !ReadValue(*file.in, eventID)) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                WriteValue(out, eventSize);
+                WriteValue(out, eventID + file.eventOffset);
+                if (!CopyBytes(*file.in, out, eventSize - 2 * sizeof(std::uint32_t), buffer)) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                events++;
+            }
+        }
+
+        G4cout << "Merged " << events << " digitized events from " << files.size() << " shards into " << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeEventCsv(const std::vector<std::uint32_t>& offsets,
+        G4String (*name)(const G4String&, G4int), const G4String& what) const
+    {
+        std::vector<std::unique_ptr<std::ifstream>> inputs;
+        std::vector<std::uint32_t> inputOffsets;
+        std::string header;
+        for (std::size_t shard = 0; shard < fShardStems.size(); shard++) {
+            auto in = std::make_unique<std::ifstream>(name(fShardStems[shard], fRunID));
+            if (!in->is_open()) continue;
+            std::string line;
+            if (std::getline(*in, line) && header.empty()) header = line;
+            inputs.push_back(std::move(in));
+            inputOffsets.push_back(offsets[shard]);
+        }
+        if (inputs.empty()) return true;
+
+        const G4String output = name(fOutputStem, fRunID);
+        std::ofstream out(output);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out << header << '\n';
+        // Shard after shard, the rows of one shard in the order they were written
+        std::size_t rows = 0;
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            std::string line;
+            while (std::getline(*inputs[i], line)) {
+                if (line.empty()) continue;
+                out << OffsetEvent(line, inputOffsets[i]) << '\n';
+                rows++;
+            }
+        }
+
+        G4cout << "Merged " << rows << " rows of " << what << " from " << inputs.size() << " shards into "
+            << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeHitLibraries(const std::vector<std::uint32_t>& offsets) const
+    {
+        std::vector<G4String> paths;
+        for (const auto& stem : fShardStems) paths.push_back(OutputPaths::HitLibraryName(stem, fRunID));
+        std::vector<EventFile> files;
+        std::string header;
+        if (!OpenEventFiles(paths, offsets, kLibraryMagic, kLibraryHeaderBytes, files, header)) return false;
+        if (files.empty()) return true;
+
+        const G4String output = OutputPaths::HitLibraryName(fOutputStem, fRunID);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out.write(header.data(), header.size());
+        std::vector<char> buffer;
+        std::size_t events = 0;
+        for (auto& file : files) {
+            std::uint32_t eventID = 0;
+            std::uint32_t hits = 0;
+            while (ReadValue(*file.in, eventID)) {
+                if (!ReadValue(*file.in, hits)) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                WriteValue(out, eventID + file.eventOffset);
+                WriteValue(out, hits);
+                if (!CopyBytes(*file.in, out, static_cast<std::uint64_t>(hits) * kLibraryHitBytes, buffer)) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                events++;
+            }
+        }
+
+        G4cout << "Merged " << events << " hit library events from " << files.size() << " shards into "
+            << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    G4bool ShardMerger::MergeStepTapes(const std::vector<std::uint32_t>& offsets) const
+    {
+        std::vector<G4String> paths;
+        for (const auto& stem : fShardStems) paths.push_back(OutputPaths::StepTapeName(stem, fRunID));
+        std::vector<EventFile> files;
+        std::string header;
+        if (!OpenEventFiles(paths, offsets, kTapeMagic, kTapeHeaderBytes, files, header)) return false;
+        if (files.empty()) return true;
+
+        const G4String output = OutputPaths::StepTapeName(fOutputStem, fRunID);
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << output << " for writing" << G4endl;
+            return false;
+        }
+        out.write(header.data(), header.size());
+        // Blocks are copied whole, only their event column is offset
+        std::vector<char> buffer;
+        std::vector<std::uint32_t> events;
+        std::uint64_t steps = 0;
+        for (auto& file : files) {
+            std::uint32_t n = 0;
+            while (ReadValue(*file.in, n)) {
+                events.resize(n);
+                if (!file.in->read(reinterpret_cast<char*>(events.data()), n * sizeof(std::uint32_t))) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                for (auto& event : events) event += file.eventOffset;
+                WriteValue(out, n);
+                out.write(reinterpret_cast<const char*>(events.data()), n * sizeof(std::uint32_t));
+                if (!CopyBytes(*file.in, out, static_cast<std::uint64_t>(n) * kTapeStepBytes, buffer)) {
+                    G4cerr << "Error: " << file.path << " is truncated" << G4endl;
+                    return false;
+                }
+                steps += n;
+            }
+        }
+
+        G4cout << "Merged " << steps << " taped steps from " << files.size() << " shards into " << output << G4endl;
+        return static_cast<G4bool>(out);
+    }
+}
@@ -0,0 +1,58 @@
+
+#ifndef G4_BREMS_SHARD_MERGER_H
+#define G4_BREMS_SHARD_MERGER_H 1
+
+#include "globals.hh"
+#include <cstdint>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Merges the outputs of sharded jobs (see OutputPaths) into one set of files:
+    //  - histograms of <stem>.root and <stem>_sipm_hits.root are added bin by bin,
+    //  - summary csv counters are summed and the trapping efficiency recomputed from the
+    //    summed numerator and denominator,
+    //  - hit csv files are k-way merged on (SiPM, time), streaming, with PhotonsInBin recounted,
+    //  - response matrices of the same grid are added point by point: events and histograms are
+    //    summed, mean, rms and hit fraction recombined weighted by each shard's events,
+    //  - channel histogram csv files are summed per (channel, histogram, bin), whose edges must
+    //    agree between shards,
+    //  - per-event outputs (tile deposits, digits and features, reconstruction csv, hit library,
+    //    step tape) are appended shard after shard. Shards number their events from 0, so the
+    //    event numbers of a shard are offset by the Events of the shards before it (their
+    //    summary csv files).
+    // Everything but the ROOT histograms is merged on background threads, the histograms on the
+    // calling thread (the Geant4 analysis reader is thread-local).
+    class ShardMerger
+    {
+    public:
+        ShardMerger(const std::vector<G4String>& shardStems, const G4String& outputStem, G4int runID);
+        ~ShardMerger() = default;
+
+        G4bool Merge() const;
+
+        G4bool MergeHistograms() const;
+        G4bool MergeSummaries() const;
+        G4bool MergeHits() const;
+        G4bool MergeResponseMatrices() const;
+        G4bool MergeChannelHistograms() const;
+        G4bool MergeEventOutputs() const;
+
+    private:
+        // Event number offset of every shard
+        std::vector<std::uint32_t> EventOffsets() const;
+        G4bool MergeTileDeposits(const std::vector<std::uint32_t>& offsets) const;
+        G4bool MergeDigits(const std::vector<std::uint32_t>& offsets) const;
+        G4bool MergeEventCsv(const std::vector<std::uint32_t>& offsets, G4String (*name)(const G4String&, G4int),
+            const G4String& what) const;
+        G4bool MergeHitLibraries(const std::vector<std::uint32_t>& offsets) const;
+        G4bool MergeStepTapes(const std::vector<std::uint32_t>& offsets) const;
+        G4bool MergeHistogramFile(const std::vector<G4String>& inputs, const G4String& output) const;
+
+        std::vector<G4String> fShardStems;
+        G4String fOutputStem;
+        G4int fRunID;
+    };
+}
+
+#endif
@@ -0,0 +1,36 @@
+
+#ifndef G4_BREMS_SIPM_CHANNEL_H
+#define G4_BREMS_SIPM_CHANNEL_H 1
+
+#include "globals.hh"
+#include <string>
+
+namespace G4_BREMS {
+
+    // Readout channel numbering, used as SiPM copy number. Layers are counted along z
+    // (Bottom_Layer<k> is layer 2k, Top_Layer<k> is layer 2k+1), each layer has 8 grooved
+    // fibers read out at both ends:
+    //   channel = (layer * kGrooves + groove) * kEnds + end
+    namespace SipmChannel {
+        constexpr G4int kLayers = 8;
+        constexpr G4int kGrooves = 8;
+        constexpr G4int kEnds = 2;
+        constexpr G4int kChannels = kLayers * kGrooves * kEnds;
+
+        constexpr G4int Id(G4int layer, G4int groove, G4int end) { return (layer * kGrooves + groove) * kEnds + end; }
+        constexpr G4int Layer(G4int channel) { return channel / (kGrooves * kEnds); }
+        constexpr G4int Groove(G4int channel) { return (channel / kEnds) % kGrooves; }
+        constexpr G4int End(G4int channel) { return channel % kEnds; }
+        // Bottom layers have fibers along y, top layers along x
+        constexpr G4bool IsTopLayer(G4int channel) { return Layer(channel) % 2 == 1; }
+
+        // Name of the SiPM placement, SiPM_<Bottom|Top>_<k>_<groove>_<end>
+        inline G4String Name(G4int channel)
+        {
+            return G4String(IsTopLayer(channel) ? "SiPM_Top_" : "SiPM_Bottom_") + std::to_string(Layer(channel) / 2)
+                + "_" + std::to_string(Groove(channel)) + "_" + std::to_string(End(channel));
+        }
+    }
+}
+
+#endif
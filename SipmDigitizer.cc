@@ -0,0 +1,244 @@
+
+#include "SipmDigitizer.hh"
+#include "G4AutoLock.hh"
+#include "G4Poisson.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    DigitizerParameters SipmDigitizer::fParameters;
+
+    namespace {
+        G4Mutex digitizerMutex = G4MUTEX_INITIALIZER;
+        std::ofstream gDigitsFile;
+        std::ofstream gFeaturesFile;
+
+        const char kDigiMagic[8] = { 'S', 'N', 'F', 'D', 'I', 'G', 'I', '1' };
+        constexpr std::size_t kMaskWords = (SipmChannel::kChannels + 31) / 32;
+
+        template <typename T>
+        void Append(std::vector<char>& buffer, const T& value) {
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        // out[i] += a * in[i] for n a multiple of kLanes; the fixed inner loop is one SIMD
+        // operation per lane block (SSE/AVX/NEON) once the compiler vectorizes it
+        inline void ScaledAdd(float* __restrict out, const float* __restrict in, float a, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i += SipmDigitizer::kLanes) {
+                for (std::size_t lane = 0; lane < SipmDigitizer::kLanes; lane++) {
+                    out[i + lane] += a * in[i + lane];
+                }
+            }
+        }
+
+        // Single-photoelectron pulse normalised to a peak of 1, t in ns
+        G4double PulseShape(G4double t, G4double rise, G4double fall)
+        {
+            if (t <= 0.) return 0.;
+            G4double peakTime = std::log(fall / rise) * rise * fall / (fall - rise);
+            G4double peak = std::exp(-peakTime / fall) - std::exp(-peakTime / rise);
+            return (std::exp(-t / fall) - std::exp(-t / rise)) / peak;
+        }
+    }
+
+    void SipmDigitizer::OpenOutput(const G4String& path, const G4String& featuresPath)
+    {
+        G4AutoLock lock(&digitizerMutex);
+        if (gFeaturesFile.is_open()) gFeaturesFile.close();
+        gFeaturesFile.open(featuresPath, std::ios::trunc);
+        if (gFeaturesFile.is_open()) {
+            gFeaturesFile << "event,channel,baseline,time_ns,charge,peak,tot_ns\n";
+        }
+        else {
+            G4cerr << "Error: Could not open " << featuresPath << " for writing" << G4endl;
+        }
+
+        if (gDigitsFile.is_open()) gDigitsFile.close();
+        gDigitsFile.open(path, std::ios::binary | std::ios::trunc);
+        if (!gDigitsFile.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return;
+        }
+
+        const std::uint32_t channels = SipmChannel::kChannels;
+        const std::uint32_t samples = fParameters.samples;
+        const float samplingPeriod = static_cast<float>(fParameters.samplingPeriod);
+        const float windowStart = static_cast<float>(fParameters.windowStart);
+        const std::uint32_t adcBits = fParameters.adcBits;
+        gDigitsFile.write(kDigiMagic, sizeof(kDigiMagic));
+        gDigitsFile.write(reinterpret_cast<const char*>(&channels), sizeof(channels));
+        gDigitsFile.write(reinterpret_cast<const char*>(&samples), sizeof(samples));
+        gDigitsFile.write(reinterpret_cast<const char*>(&samplingPeriod), sizeof(samplingPeriod));
+        gDigitsFile.write(reinterpret_cast<const char*>(&windowStart), sizeof(windowStart));
+        gDigitsFile.write(reinterpret_cast<const char*>(&adcBits), sizeof(adcBits));
+        G4cout << "Writing digitized traces to " << path << " and their features to " << featuresPath << G4endl;
+    }
+
+    void SipmDigitizer::CloseOutput()
+    {
+        G4AutoLock lock(&digitizerMutex);
+        if (gDigitsFile.is_open()) gDigitsFile.close();
+        if (gFeaturesFile.is_open()) gFeaturesFile.close();
+    }
+
+    void SipmDigitizer::BeginOfRun()
+    {
+        if (!fParameters.enabled) return;
+
+        // A tail of 7 fall times is below 0.1% of the peak
+        const G4double period = fParameters.samplingPeriod;
+        const G4double fall = fParameters.fallTime;
+        const G4double rise = std::min(fParameters.riseTime, 0.99 * fall);
+        std::size_t length = static_cast<std::size_t>(std::ceil(7. * fall / period)) + 1;
+        fKernelLength = (length + kLanes - 1) / kLanes * kLanes;
+
+        fKernel.assign(kPhases * fKernelLength, 0.f);
+        for (G4int phase = 0; phase < kPhases; phase++) {
+            for (std::size_t k = 0; k < fKernelLength; k++) {
+                G4double t = (k + static_cast<G4double>(phase) / kPhases) * period;
+                fKernel[phase * fKernelLength + k] = static_cast<float>(PulseShape(t, rise, fall));
+            }
+        }
+        fTrace.assign(fParameters.samples + fKernelLength, 0.f);
+        fNoise.assign(fParameters.samples, 0.);
+        fAdc.assign(static_cast<std::size_t>(SipmChannel::kChannels) * fParameters.samples, 0);
+    }
+
+    void SipmDigitizer::AddPulse(G4double time, G4double amplitude)
+    {
+        // Sample 'first' is the first one at or after the pulse start, delayed by 'phase'/kPhases
+        G4double x = (time - fParameters.windowStart) / fParameters.samplingPeriod;
+        G4double first = std::ceil(x);
+        G4int phase = static_cast<G4int>(std::lround((first - x) * kPhases));
+        if (phase == kPhases) {
+            first -= 1.;
+            phase = 0;
+        }
+        if (first >= fParameters.samples) return;
+
+        const float* kernel = &fKernel[phase * fKernelLength];
+        if (first >= 0.) {
+            // The trace is padded by a kernel length, no bounds checks needed
+            ScaledAdd(&fTrace[static_cast<std::size_t>(first)], kernel, static_cast<float>(amplitude), fKernelLength);
+            return;
+        }
+
+        // Tail of a pulse that started before the window
+        std::size_t skip = static_cast<std::size_t>(-first);
+        for (std::size_t k = skip; k < fKernelLength; k++) {
+            fTrace[k - skip] += static_cast<float>(amplitude) * kernel[k];
+        }
+    }
+
+    void SipmDigitizer::AddAvalanche(G4double time)
+    {
+        // Prompt crosstalk fires further cells at the same time (geometric chain)
+        G4int cells = 1;
+        while (cells < 100 && G4UniformRand() < fParameters.crosstalk) cells++;
+
+        G4double amplitude = 0.;
+        for (G4int cell = 0; cell < cells; cell++) {
+            G4double cellAmplitude = fParameters.gain * std::max(0., 1. + fParameters.gainSpread * G4RandGauss::shoot());
+            amplitude += cellAmplitude;
+
+            // Delayed avalanche in the same, partially recharged cell
+            if (G4UniformRand() < fParameters.afterpulse) {
+                G4double delay = G4RandExponential::shoot(fParameters.afterpulseTime);
+                AddPulse(time + delay, cellAmplitude * (1. - std::exp(-delay / fParameters.recoveryTime)));
+            }
+        }
+        AddPulse(time, amplitude);
+    }
+
+    void SipmDigitizer::DigitizeEvent(G4int eventID, const std::vector<SipmHit>& hits, G4bool zeroSuppress)
+    {
+        if (fKernel.empty()) return;
+
+        for (auto& times : fTimes) times.clear();
+        for (const auto& hit : hits) {
+            if (hit.sipmID < 0 || hit.sipmID >= SipmChannel::kChannels) continue;
+            fTimes[hit.sipmID].push_back(hit.time / ns);
+        }
+
+        std::array<std::uint32_t, kMaskWords> mask;
+        mask.fill(zeroSuppress ? 0u : ~std::uint32_t(0));
+        std::size_t maskedChannels = zeroSuppress ? 0 : SipmChannel::kChannels;
+        if (zeroSuppress) {
+            for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+                if (fTimes[channel].empty()) continue;
+                mask[channel / 32] |= 1u << (channel % 32);
+                maskedChannels++;
+            }
+        }
+        auto inMask = [&mask](G4int channel) { return (mask[channel / 32] >> (channel % 32) & 1u) != 0; };
+
+        // Dark counts up to a kernel length before the window still leave a tail in it
+        const std::size_t samples = fParameters.samples;
+        const G4double period = fParameters.samplingPeriod;
+        const G4double darkStart = fParameters.windowStart - fKernelLength * period;
+        const G4double darkSpan = (samples + fKernelLength) * period;
+        const G4double darkMean = fParameters.darkRate * darkSpan * 1.e-9;
+        const G4double maxAdc = static_cast<G4double>((1u << fParameters.adcBits) - 1);
+        const auto flat = static_cast<std::uint16_t>(std::clamp(std::round(fParameters.baseline), 0., maxAdc));
+
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            std::uint16_t* adc = &fAdc[channel * samples];
+            if (!inMask(channel)) {
+                // Suppressed channels read as a flat baseline for later stages
+                std::fill(adc, adc + samples, flat);
+                continue;
+            }
+
+            std::fill(fTrace.begin(), fTrace.end(), 0.f);
+            for (G4double time : fTimes[channel]) AddAvalanche(time);
+            G4long darkCounts = G4Poisson(darkMean);
+            for (G4long i = 0; i < darkCounts; i++) AddAvalanche(darkStart + G4UniformRand() * darkSpan);
+
+            G4RandGauss::shootArray(static_cast<G4int>(samples), fNoise.data(), fParameters.baseline, fParameters.noise);
+            for (std::size_t i = 0; i < samples; i++) {
+                G4double value = std::round(fNoise[i] + fTrace[i]);
+                adc[i] = static_cast<std::uint16_t>(std::clamp(value, 0., maxAdc));
+            }
+        }
+
+        // Whole event written at once; without zero suppression every channel is in the mask
+        fBuffer.clear();
+        const std::uint32_t eventSize = static_cast<std::uint32_t>(
+            (2 + kMaskWords) * sizeof(std::uint32_t) + maskedChannels * samples * sizeof(std::uint16_t));
+        Append(fBuffer, eventSize);
+        Append(fBuffer, static_cast<std::uint32_t>(eventID));
+        for (std::uint32_t word : mask) Append(fBuffer, word);
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            if (!inMask(channel)) continue;
+            const char* bytes = reinterpret_cast<const char*>(&fAdc[channel * samples]);
+            fBuffer.insert(fBuffer.end(), bytes, bytes + samples * sizeof(std::uint16_t));
+        }
+
+        FeatureSettings settings;
+        settings.baselineSamples = fParameters.baselineSamples;
+        settings.cfdFraction = fParameters.cfdFraction;
+        settings.threshold = fParameters.featureThreshold;
+        settings.samplingPeriod = period;
+        settings.windowStart = fParameters.windowStart;
+        fExtractor.Extract(fAdc.data(), SipmChannel::kChannels, samples, settings, fFeatures);
+
+        fFeatureLines.clear();
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            if (!inMask(channel) || fFeatures.peak[channel] <= settings.threshold) continue;
+            fFeatureLines += std::to_string(eventID) + "," + std::to_string(channel) + ","
+                + std::to_string(fFeatures.baseline[channel]) + "," + std::to_string(fFeatures.time[channel]) + ","
+                + std::to_string(fFeatures.charge[channel]) + "," + std::to_string(fFeatures.peak[channel]) + ","
+                + std::to_string(fFeatures.timeOverThreshold[channel]) + "\n";
+        }
+
+        G4AutoLock lock(&digitizerMutex);
+        if (gDigitsFile.is_open()) gDigitsFile.write(fBuffer.data(), fBuffer.size());
+        if (gFeaturesFile.is_open()) gFeaturesFile << fFeatureLines;
+    }
+}
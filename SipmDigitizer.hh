@@ -0,0 +1,100 @@
+
+#ifndef G4_BREMS_SIPM_DIGITIZER_H
+#define G4_BREMS_SIPM_DIGITIZER_H 1
+
+#include "SipmChannel.hh"
+#include "SteppingAction.hh"
+#include "WaveformFeatures.hh"
+#include "globals.hh"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // SiPM and front-end model of the digitizer; configured on the master by DigitizerMessenger
+    // between runs. Every SiPM hit is one photoelectron.
+    struct DigitizerParameters {
+        G4bool enabled = false;
+        G4double samplingPeriod = 2.;    // ns, 500 MS/s
+        G4int samples = 256;             // per trace
+        G4double windowStart = 0.;       // ns, time of sample 0 in the event
+        G4double riseTime = 1.;          // ns, single-photoelectron pulse (A e^-t/fall - A e^-t/rise)
+        G4double fallTime = 40.;         // ns
+        G4double gain = 20.;             // ADC counts at the peak of one photoelectron
+        G4double gainSpread = 0.1;       // relative sigma of the avalanche amplitude
+        G4double crosstalk = 0.1;        // probability of each avalanche to fire a neighbour cell
+        G4double afterpulse = 0.05;      // probability per avalanche
+        G4double afterpulseTime = 20.;   // ns, mean delay of an afterpulse
+        G4double recoveryTime = 15.;     // ns, cell recharge; scales the afterpulse amplitude
+        G4double darkRate = 1.e5;        // Hz per channel
+        G4double baseline = 200.;        // ADC counts
+        G4double noise = 1.;             // ADC counts, white electronics noise
+        G4int adcBits = 12;
+        // Waveform features, see FeatureExtractor
+        G4int baselineSamples = 16;
+        G4double cfdFraction = 0.3;
+        G4double featureThreshold = 10.; // ADC counts above baseline
+    };
+
+    // Per-thread digitizer, owned by RunAction: turns the SiPM hits of an event into one sampled
+    // trace per channel. Pulses are added from a template tabulated at kPhases sub-sample
+    // offsets, so placing a photoelectron is a scaled add of a contiguous block, done in
+    // fixed-width lanes that compilers map onto SIMD registers.
+    //
+    // File layout (little endian), modelled on a waveform digitizer readout:
+    //   char[8] "SNFDIGI1", uint32 channels, uint32 samples, float samplingPeriod[ns],
+    //   float windowStart[ns], uint32 adcBits, then per event in completion order:
+    //   uint32 eventSize (bytes, header included), uint32 eventID, uint32 channelMask[channels/32]
+    //   (all channels, or those with hits when the trigger zero-suppresses),
+    //   per channel set in the mask, in channel order: uint16 adc[samples]
+    // The features of every channel whose peak passes the feature threshold go to a csv next to
+    // it: event,channel,baseline,time_ns,charge,peak,tot_ns.
+    class SipmDigitizer
+    {
+    public:
+        SipmDigitizer() = default;
+        ~SipmDigitizer() = default;
+
+        static DigitizerParameters& Parameters() { return fParameters; }
+        static G4bool IsEnabled() { return fParameters.enabled; }
+
+        // Master: opens and closes the run's output files; workers append whole events to them
+        static void OpenOutput(const G4String& path, const G4String& featuresPath);
+        static void CloseOutput();
+
+        // Tabulates the pulse template from the parameters of this run
+        void BeginOfRun();
+        // With zero suppression only the channels that have hits are digitized and written
+        void DigitizeEvent(G4int eventID, const std::vector<SipmHit>& hits, G4bool zeroSuppress);
+
+        static constexpr G4int kPhases = 16;
+        static constexpr std::size_t kLanes = 8;
+
+        // Last event, [channel][sample], for later stages of the same thread
+        const std::vector<std::uint16_t>& GetTraces() const { return fAdc; }
+        const ChannelFeatures& GetFeatures() const { return fFeatures; }
+
+    private:
+        // Adds one avalanche at time t (ns, in the event) with the given peak amplitude
+        void AddPulse(G4double time, G4double amplitude);
+        // Prompt crosstalk and afterpulses of one avalanche, then the avalanche itself
+        void AddAvalanche(G4double time);
+
+        static DigitizerParameters fParameters;
+
+        std::size_t fKernelLength = 0;        // multiple of kLanes
+        std::vector<float> fKernel;           // [phase][fKernelLength], peak normalised to 1
+        std::vector<float> fTrace;            // samples + fKernelLength, one channel at a time
+        std::vector<G4double> fNoise;         // baseline plus noise of one channel
+        std::array<std::vector<G4double>, SipmChannel::kChannels> fTimes;
+        std::vector<std::uint16_t> fAdc;      // [channel][sample]
+        std::vector<char> fBuffer;            // serialized event
+        FeatureExtractor fExtractor;
+        ChannelFeatures fFeatures;
+        std::string fFeatureLines;            // csv rows of the event
+    };
+}
+
+#endif
@@ -0,0 +1,261 @@
+
+#include "SipmHitsWriter.hh"
+#include "SipmChannel.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace G4_BREMS {
+
+    namespace {
+        // One per channel and one for SiPM_Unknown, the name of out-of-range channels
+        constexpr G4int kBuckets = SipmChannel::kChannels + 1;
+
+        // Rank of each channel's name among all names, so that partitioning by rank lays the
+        // SiPMs out in the name order of the csv
+        const std::array<G4int, kBuckets>& BucketRanks()
+        {
+            static const std::array<G4int, kBuckets> ranks = [] {
+                std::array<G4String, kBuckets> names;
+                for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) names[channel] = SipmChannel::Name(channel);
+                names[SipmChannel::kChannels] = "SiPM_Unknown";
+                std::array<G4int, kBuckets> order;
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(), order.end(), [&names](G4int a, G4int b) { return names[a] < names[b]; });
+                std::array<G4int, kBuckets> rank;
+                for (G4int i = 0; i < kBuckets; i++) rank[order[i]] = i;
+                return rank;
+            }();
+            return ranks;
+        }
+
+        inline G4int Bucket(G4int channel)
+        {
+            return BucketRanks()[(channel >= 0 && channel < SipmChannel::kChannels) ? channel : SipmChannel::kChannels];
+        }
+
+        inline G4int BinIndex(G4double time)
+        {
+            return static_cast<G4int>(time / (SipmHitsWriter::kBinSize * ns));
+        }
+
+        // Runs function(task) for every task in [0, tasks) on up to threads threads, the
+        // calling one included; tasks are handed out in order as threads become free
+        template <class Function>
+        void ParallelFor(unsigned threads, std::size_t tasks, Function&& function)
+        {
+            std::atomic<std::size_t> next{ 0 };
+            auto work = [&]() {
+                for (std::size_t task; (task = next++) < tasks;) function(task);
+            };
+            std::vector<std::future<void>> helpers;
+            for (std::size_t t = 1; t < std::min<std::size_t>(threads, tasks); t++) {
+                helpers.push_back(std::async(std::launch::async, work));
+            }
+            work();
+            for (auto& helper : helpers) helper.get();
+        }
+
+        // Same text as operator<< with the default stream format (%g, 6 digits)
+        template <class T>
+        inline void Append(std::string& out, T value)
+        {
+            char buffer[32];
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>) result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+            else result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+
+        G4double Seconds(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    SipmHitsWriter::SipmHitsWriter(unsigned threads)
+        : fThreads(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    G4bool SipmHitsWriter::Write(const std::vector<SipmHit>& hits, const G4String& path)
+    {
+        fTimes = StageTimes();
+        if (hits.size() > std::numeric_limits<std::uint32_t>::max()) {
+            G4cerr << "Error: " << hits.size() << " SiPM hits are too many for " << path << G4endl;
+            return false;
+        }
+        // Text mode, so rows end like std::endl ones on every platform
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return false;
+        }
+        out << "SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm),TimeBin(ns),PhotonsInBin,"
+            << "History,TilePath(mm),CladPath(mm),CorePath(mm)\n";
+
+        auto start = std::chrono::steady_clock::now();
+        Partition(hits);
+        fTimes.partition = Seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        SortAndBin(hits);
+        fTimes.sort = Seconds(start);
+
+        // Blocks are formatted ahead of the writer, up to two per thread, and written in order
+        start = std::chrono::steady_clock::now();
+        const std::size_t rows = fKeys.size();
+        const std::size_t blocks = (rows + kBlockRows - 1) / kBlockRows;
+        std::size_t next = 0;
+        auto launch = [&]() {
+            const std::size_t begin = next++ * kBlockRows;
+            return std::async(std::launch::async, [this, &hits, begin, rows]() {
+                std::string text;
+                FormatBlock(hits, begin, std::min(begin + kBlockRows, rows), text);
+                return text;
+            });
+        };
+        std::deque<std::future<std::string>> pending;
+        while (next < blocks && pending.size() < 2 * fThreads) pending.push_back(launch());
+        while (!pending.empty()) {
+            const std::string text = pending.front().get();
+            pending.pop_front();
+            if (next < blocks) pending.push_back(launch());
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+        out.close();
+        fTimes.format = Seconds(start);
+
+        // The keys are only needed while writing
+        std::vector<Key>().swap(fKeys);
+        if (out.fail()) {
+            G4cerr << "Error: Writing " << path << " failed" << G4endl;
+            return false;
+        }
+        return true;
+    }
+
+    void SipmHitsWriter::Partition(const std::vector<SipmHit>& hits)
+    {
+        // Counting sort on the bucket: each chunk of hits counts its buckets, the counts are
+        // turned into per-chunk write positions (bucket-major, so a bucket keeps the order of
+        // the hits) and each chunk scatters its keys
+        const std::size_t n = hits.size();
+        const std::size_t chunks = std::clamp<std::size_t>(n / kBlockRows, 1, fThreads);
+        std::vector<std::array<std::size_t, kBuckets>> positions(chunks);
+        auto chunkBegin = [n, chunks](std::size_t chunk) { return n * chunk / chunks; };
+
+        ParallelFor(fThreads, chunks, [&](std::size_t chunk) {
+            auto& counts = positions[chunk];
+            counts.fill(0);
+            for (std::size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) counts[Bucket(hits[i].sipmID)]++;
+        });
+
+        fBucketBegin.assign(kBuckets + 1, 0);
+        std::size_t offset = 0;
+        for (G4int bucket = 0; bucket < kBuckets; bucket++) {
+            fBucketBegin[bucket] = offset;
+            for (auto& counts : positions) {
+                const std::size_t count = counts[bucket];
+                counts[bucket] = offset;
+                offset += count;
+            }
+        }
+        fBucketBegin[kBuckets] = offset;
+
+        fKeys.resize(n);
+        ParallelFor(fThreads, chunks, [&](std::size_t chunk) {
+            auto& next = positions[chunk];
+            for (std::size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) {
+                fKeys[next[Bucket(hits[i].sipmID)]++] = Key{ hits[i].time, static_cast<std::uint32_t>(i), 0 };
+            }
+        });
+    }
+
+    void SipmHitsWriter::SortAndBin(const std::vector<SipmHit>& hits)
+    {
+        // Ties on time are broken on the remaining fields so the output does not depend on the
+        // order in which workers published hits
+        auto earlier = [&hits](const Key& a, const Key& b) {
+            if (a.time != b.time) return a.time < b.time;
+            const SipmHit& x = hits[a.index];
+            const SipmHit& y = hits[b.index];
+            if (x.energy != y.energy) return x.energy < y.energy;
+            if (x.position.x() != y.position.x()) return x.position.x() < y.position.x();
+            if (x.position.y() != y.position.y()) return x.position.y() < y.position.y();
+            return x.position.z() < y.position.z();
+        };
+
+        // Largest SiPMs first, so a busy channel does not start last and hold up the stage
+        std::array<G4int, kBuckets> order;
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](G4int a, G4int b) {
+            return fBucketBegin[a + 1] - fBucketBegin[a] > fBucketBegin[b + 1] - fBucketBegin[b];
+        });
+
+        ParallelFor(fThreads, kBuckets, [&](std::size_t task) {
+            Key* first = fKeys.data() + fBucketBegin[order[task]];
+            Key* last = fKeys.data() + fBucketBegin[order[task] + 1];
+            std::sort(first, last, earlier);
+            // Sorted by time, the hits of a bin are consecutive
+            for (Key* run = first; run != last;) {
+                const G4int bin = BinIndex(run->time);
+                Key* end = run + 1;
+                while (end != last && BinIndex(end->time) == bin) ++end;
+                for (Key* key = run; key != end; ++key) key->photonsInBin = static_cast<std::uint32_t>(end - run);
+                run = end;
+            }
+        });
+    }
+
+    void SipmHitsWriter::FormatBlock(const std::vector<SipmHit>& hits, std::size_t begin, std::size_t end,
+        std::string& out) const
+    {
+        const G4double binSize = kBinSize * ns;
+        out.reserve((end - begin) * 160);
+        for (std::size_t row = begin; row < end; row++) {
+            const Key& key = fKeys[row];
+            const SipmHit& hit = hits[key.index];
+            const G4int binIndex = BinIndex(hit.time);
+            out += hit.sipmName;
+            out += ',';
+            Append(out, hit.time / ns);
+            out += ',';
+            Append(out, hit.position.x() / mm);
+            out += ',';
+            Append(out, hit.position.y() / mm);
+            out += ',';
+            Append(out, hit.position.z() / mm);
+            out += ',';
+            Append(out, hit.energy / eV);
+            out += ',';
+            Append(out, hit.wavelength);
+            out += ',';
+            Append(out, binIndex * binSize / ns);
+            out += '-';
+            Append(out, (binIndex + 1) * binSize / ns);
+            out += ',';
+            Append(out, key.photonsInBin);
+            out += ',';
+            Append(out, hit.provenance.history);
+            out += ',';
+            Append(out, hit.provenance.tilePath);
+            out += ',';
+            Append(out, hit.provenance.cladPath);
+            out += ',';
+            Append(out, hit.provenance.corePath);
+            out += '\n';
+        }
+    }
+}
@@ -0,0 +1,63 @@
+
+#ifndef G4_BREMS_SIPM_HITS_WRITER_H
+#define G4_BREMS_SIPM_HITS_WRITER_H 1
+
+#include "SteppingAction.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Writes the SiPM hits of a run to sipm_hits_run<N>.csv, on the master at the end of the run:
+    //   SipmName,Time(ns),X(mm),Y(mm),Z(mm),Energy(eV),Wavelength(nm),TimeBin(ns),PhotonsInBin,
+    //   History,TilePath(mm),CladPath(mm),CorePath(mm)
+    // Rows are grouped by SiPM in name order and sorted by time inside a SiPM (ties on energy,
+    // then position), PhotonsInBin counts the hits of the SiPM in the same 100 ns bin.
+    //
+    // The hits are never copied. A 16-byte key per hit (time, hit index, bin count) is radix
+    // partitioned by channel straight into output order, each channel's keys are sorted and
+    // binned on their own, and the rows are formatted in blocks that are written in order as
+    // they complete. Every stage runs on a pool of threads, the workers being idle at this point;
+    // memory beyond the hits is the keys plus a bounded number of formatted blocks.
+    class SipmHitsWriter
+    {
+    public:
+        static constexpr G4double kBinSize = 100.0;      // ns
+        static constexpr std::size_t kBlockRows = 65536; // rows formatted per task
+
+        // Wall time of the stages of the last Write, in s
+        struct StageTimes {
+            G4double partition = 0.;
+            G4double sort = 0.;         // sorting and binning
+            G4double format = 0.;       // formatting and writing, overlapped
+        };
+
+        // 0 threads: one per hardware thread
+        explicit SipmHitsWriter(unsigned threads = 0);
+        ~SipmHitsWriter() = default;
+
+        G4bool Write(const std::vector<SipmHit>& hits, const G4String& path);
+
+        unsigned GetThreads() const { return fThreads; }
+        const StageTimes& GetStageTimes() const { return fTimes; }
+
+    private:
+        struct Key {
+            G4double time;
+            std::uint32_t index;        // into the hits
+            std::uint32_t photonsInBin;
+        };
+
+        void Partition(const std::vector<SipmHit>& hits);
+        void SortAndBin(const std::vector<SipmHit>& hits);
+        void FormatBlock(const std::vector<SipmHit>& hits, std::size_t begin, std::size_t end, std::string& out) const;
+
+        unsigned fThreads;
+        StageTimes fTimes;
+        std::vector<Key> fKeys;                 // in output order after SortAndBin
+        std::vector<std::size_t> fBucketBegin;  // [bucket + 1], bucket = rank of the SiPM name
+    };
+}
+
+#endif
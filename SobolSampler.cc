@@ -0,0 +1,89 @@
+
+#include "SobolSampler.hh"
+#include <array>
+
+namespace G4_BREMS {
+
+    namespace {
+        // Joe & Kuo (new-joe-kuo-6.21201): degree s, coefficients a, initial m_1..m_s of
+        // dimensions 2..8; dimension 1 is the van der Corput sequence
+        struct Primitive {
+            G4int s;
+            std::uint32_t a;
+            std::uint32_t m[5];
+        };
+        const Primitive kPrimitives[SobolSampler::kDimensions - 1] = {
+            { 1, 0, { 1 } },
+            { 2, 1, { 1, 3 } },
+            { 3, 1, { 1, 3, 1 } },
+            { 3, 2, { 1, 1, 1 } },
+            { 4, 1, { 1, 1, 3, 3 } },
+            { 4, 4, { 1, 3, 5, 13 } },
+            { 5, 2, { 1, 1, 5, 5, 17 } }
+        };
+
+        using DirectionTable = std::array<std::array<std::uint32_t, 32>, SobolSampler::kDimensions>;
+
+        DirectionTable BuildDirections() {
+            DirectionTable v{};
+            for (G4int i = 0; i < 32; i++) v[0][i] = 1u << (31 - i);
+
+            for (G4int d = 1; d < SobolSampler::kDimensions; d++) {
+                const Primitive& p = kPrimitives[d - 1];
+                for (G4int i = 0; i < p.s; i++) v[d][i] = p.m[i] << (31 - i);
+                for (G4int i = p.s; i < 32; i++) {
+                    std::uint32_t value = v[d][i - p.s] ^ (v[d][i - p.s] >> p.s);
+                    for (G4int k = 1; k < p.s; k++) {
+                        if ((p.a >> (p.s - 1 - k)) & 1u) value ^= v[d][i - k];
+                    }
+                    v[d][i] = value;
+                }
+            }
+            return v;
+        }
+
+        const DirectionTable kDirections = BuildDirections();
+
+        std::uint32_t ReverseBits(std::uint32_t x) {
+            x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+            x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+            x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+            x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+            return (x >> 16) | (x << 16);
+        }
+
+        std::uint32_t HashCombine(std::uint32_t seed, std::uint32_t value) {
+            return seed ^ (value + 0x9E3779B9u + (seed << 6) + (seed >> 2));
+        }
+    }
+
+    std::uint32_t SobolSampler::Sobol(std::uint32_t index, G4int dimension)
+    {
+        std::uint32_t x = 0;
+        for (G4int bit = 0; index != 0; bit++, index >>= 1) {
+            if (index & 1u) x ^= kDirections[dimension][bit];
+        }
+        return x;
+    }
+
+    std::uint32_t SobolSampler::NestedUniformScramble(std::uint32_t x, std::uint32_t seed)
+    {
+        // Laine-Karras permutation on the reversed bits scrambles every digit conditioned on
+        // the higher ones
+        x = ReverseBits(x);
+        x += seed;
+        x ^= x * 0x6C50B47Cu;
+        x ^= x * 0xB82F1E52u;
+        x ^= x * 0xC7AFE638u;
+        x ^= x * 0x8D22F6E6u;
+        return ReverseBits(x);
+    }
+
+    G4double SobolSampler::Sample(std::uint32_t index, G4int dimension, std::uint32_t seed)
+    {
+        std::uint32_t shuffled = NestedUniformScramble(index, HashCombine(seed, 0x5EED5EEDu));
+        std::uint32_t x = Sobol(shuffled, dimension);
+        x = NestedUniformScramble(x, HashCombine(seed, static_cast<std::uint32_t>(dimension)));
+        return x * (1.0 / 4294967296.0);
+    }
+}
@@ -0,0 +1,30 @@
+
+#ifndef G4_BREMS_SOBOL_SAMPLER_H
+#define G4_BREMS_SOBOL_SAMPLER_H 1
+
+#include "globals.hh"
+#include <cstdint>
+
+namespace G4_BREMS {
+
+    // Owen-scrambled Sobol points (Burley 2020, hash-based nested uniform scrambling of the
+    // point index and of every coordinate). Each seed gives an independent randomization of
+    // the same low-discrepancy set, so replicas with different seeds yield unbiased estimates
+    // whose spread is the error of the quasi-Monte Carlo result. Stateless and thread-safe:
+    // point i of a run is the same whichever thread generates it.
+    class SobolSampler
+    {
+    public:
+        static constexpr G4int kDimensions = 8;
+        static constexpr G4int kMaxReplicas = 16;
+
+        // Coordinate dim (< kDimensions) of point index, in [0,1)
+        static G4double Sample(std::uint32_t index, G4int dimension, std::uint32_t seed);
+
+    private:
+        static std::uint32_t Sobol(std::uint32_t index, G4int dimension);
+        static std::uint32_t NestedUniformScramble(std::uint32_t x, std::uint32_t seed);
+    };
+}
+
+#endif
@@ -0,0 +1,54 @@
+
+#include "StackingAction.hh"
+#include "OpticalProfile.hh"
+#include "G4Track.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4VProcess.hh"
+#include "G4Version.hh"
+
+namespace G4_BREMS {
+
+    void StackingAction::ResolveVetoes(const OpticalProfile& profile)
+    {
+        fResolvedProfile = &profile;
+        fVetoes.clear();
+        for (const auto& [process, regionName] : profile.regionVetoes) {
+            const G4Region* region = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+            if (!region) {
+                G4ExceptionDescription msg;
+                msg << "Region " << regionName << " of optical profile " << profile.name
+                    << " not found, its " << process << " veto is ignored";
+                G4Exception("StackingAction::ResolveVetoes()", "Stacking_W001", JustWarning, msg);
+                continue;
+            }
+            fVetoes.push_back({ process, region });
+        }
+    }
+
+    G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+    {
+        if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return fUrgent;
+
+        const OpticalProfile& profile = OpticalProfile::Active();
+        if (&profile != fResolvedProfile) ResolveVetoes(profile);
+
+        // Secondaries carry the touchable of their parent's pre-step point
+        const G4VProcess* creator = track->GetCreatorProcess();
+        const G4VPhysicalVolume* volume = track->GetVolume();
+        if (!fVetoes.empty() && creator && volume) {
+            const G4Region* region = volume->GetLogicalVolume()->GetRegion();
+            for (const auto& veto : fVetoes) {
+                if (veto.region == region && veto.process == creator->GetProcessName()) return fKill;
+            }
+        }
+
+#if G4VERSION_NUMBER >= 1120
+        if (fSubEventMode) return fSubEvent_0;
+#endif
+        return fUrgent;
+    }
+}
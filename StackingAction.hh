@@ -0,0 +1,43 @@
+
+#ifndef G4_BREMS_STACKING_ACTION_H
+#define G4_BREMS_STACKING_ACTION_H 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+#include <vector>
+
+class G4Region;
+
+namespace G4_BREMS {
+
+    struct OpticalProfile;
+
+    // Applies the region vetoes of the active OpticalProfile to new optical photons. In
+    // sub-event parallel mode the surviving photons are handed to the sub-event stack so that
+    // the master tracks the positron and gammas while workers track photon batches.
+    class StackingAction : public G4UserStackingAction
+    {
+    public:
+        StackingAction(G4bool subEventMode = false) : fSubEventMode(subEventMode) {}
+        ~StackingAction() override = default;
+
+        G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+
+        static constexpr G4int kOpticalSubEventType = 0;
+
+    private:
+        struct Veto {
+            G4String process;
+            const G4Region* region;
+        };
+
+        // Region pointers are looked up once per profile, the store is filled at /run/initialize
+        void ResolveVetoes(const OpticalProfile& profile);
+
+        G4bool fSubEventMode;
+        const OpticalProfile* fResolvedProfile = nullptr;
+        std::vector<Veto> fVetoes;
+    };
+}
+
+#endif
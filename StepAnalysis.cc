@@ -0,0 +1,366 @@
+
+#include "StepAnalysis.hh"
+#include "SteppingAction.hh"
+#include "SipmChannel.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VProcess.hh"
+#include "G4AnalysisManager.hh"
+#include "G4SystemOfUnits.hh"
+#include <vector>
+
+namespace G4_BREMS {
+
+    namespace {
+        const char* const kVolumeNames[StepCode::kVolumes] = { "Tile", "FiberClad", "FiberCore", "Sipm", "World", "Other", "None" };
+        const char* const kProcessNames[StepCode::kProcesses] = { "Primary", "Cerenkov", "Scintillation", "OpWLS",
+            "OpAbsorption", "Transportation", "Other" };
+
+        // Placement names of the SiPMs, built once
+        const G4String& ChannelName(G4int channel)
+        {
+            static const std::vector<G4String> names = [] {
+                std::vector<G4String> list;
+                for (G4int c = 0; c < SipmChannel::kChannels; c++) list.push_back(SipmChannel::Name(c));
+                list.push_back("SiPM_Unknown");
+                return list;
+            }();
+            return names[(channel >= 0 && channel < SipmChannel::kChannels) ? channel : SipmChannel::kChannels];
+        }
+    }
+
+    std::uint8_t StepCode::Volume(const G4String& name)
+    {
+        for (std::uint8_t code = 0; code < kOtherVolume; code++) {
+            if (name == kVolumeNames[code]) return code;
+        }
+        return kOtherVolume;
+    }
+
+    std::uint8_t StepCode::Process(const G4String& name)
+    {
+        for (std::uint8_t code = 0; code < kOtherProcess; code++) {
+            if (name == kProcessNames[code]) return code;
+        }
+        return kOtherProcess;
+    }
+
+    const char* StepCode::VolumeName(std::uint8_t code) { return kVolumeNames[code < kVolumes ? code : kOtherVolume]; }
+    const char* StepCode::ProcessName(std::uint8_t code) { return kProcessNames[code < kProcesses ? code : kOtherProcess]; }
+
+    G4bool StepAnalysis::Extract(const G4Step* step, G4int eventID, StepRecord& record)
+    {
+        const G4Track* track = step->GetTrack();
+        const G4StepPoint* preStepPoint = step->GetPreStepPoint();
+        G4VPhysicalVolume* volume = preStepPoint->GetTouchableHandle()->GetVolume();
+        if (!volume || !volume->GetLogicalVolume()) return false;
+
+        record.event = eventID;
+        record.track = track->GetTrackID();
+        record.preVolume = StepCode::Volume(volume->GetLogicalVolume()->GetName());
+        const G4VProcess* creatorProcess = track->GetCreatorProcess();
+        record.creator = creatorProcess ? StepCode::Process(creatorProcess->GetProcessName()) : StepCode::kPrimary;
+        record.position = preStepPoint->GetPosition();
+        record.time = preStepPoint->GetGlobalTime();
+        record.edep = step->GetTotalEnergyDeposit();
+        record.energy = track->GetTotalEnergy();
+
+        record.process = StepCode::kOtherProcess;
+        record.postVolume = StepCode::kNoVolume;
+        record.channel = -1;
+        const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+        if (postStepPoint) {
+            const G4VProcess* process = postStepPoint->GetProcessDefinedStep();
+            if (process) record.process = StepCode::Process(process->GetProcessName());
+            G4VPhysicalVolume* postVolume = postStepPoint->GetTouchableHandle()->GetVolume();
+            if (postVolume) {
+                record.postVolume = StepCode::Volume(postVolume->GetLogicalVolume()->GetName());
+                if (record.postVolume == StepCode::kSipm) record.channel = postStepPoint->GetTouchableHandle()->GetCopyNumber();
+            }
+            record.postPosition = postStepPoint->GetPosition();
+            record.postTime = postStepPoint->GetGlobalTime();
+        }
+        return true;
+    }
+
+    void StepAnalysis::Analyze(const StepRecord& step, TrackSummary& track, StepSink& sink)
+    {
+        const G4ThreeVector& position = step.position;
+        const G4double globalTime = step.time;
+        const G4double edep = step.edep;
+        const G4double energy = step.energy;
+        const G4double wavelength = (1239.84193 * eV) / energy;
+        const std::uint8_t volume = step.preVolume;
+
+        if (track.steps++ == 0) {
+            track.creator = step.creator;
+            track.creationVolume = volume;
+            track.energy = energy;
+        }
+        track.inCladding = track.inCladding || volume == StepCode::kFiberClad;
+        track.inCore = track.inCore || volume == StepCode::kFiberCore;
+
+        // A photon about to be absorbed by WLS; its last step, so once per photon already
+        if (step.creator != StepCode::kOpWLS && step.process == StepCode::kOpWLS) {
+            sink.FillH1(2, energy / eV);      // Energy before WLS
+            sink.FillH1(4, wavelength);       // Wavelength before WLS
+        }
+
+        // Update process counts
+        sink.CountProcess(volume, step.process, false);
+        sink.CountVolume(volume);
+
+        const std::uint8_t pre = volume;
+        const std::uint8_t post = step.postVolume;
+        if (post != StepCode::kNoVolume && pre != post) {
+            const G4bool fromWLS = (step.creator == StepCode::kOpWLS);
+            const G4bool preFiber = (pre == StepCode::kFiberCore || pre == StepCode::kFiberClad);
+
+            // The WLS condition only applies to photons entering from the tile, as it always has
+            if ((post == StepCode::kFiberCore && pre == StepCode::kFiberClad) ||
+                ((post == StepCode::kFiberClad && pre == StepCode::kTile) && !fromWLS)) {
+                track.enteredFiber = true;
+            }
+
+            if (post != StepCode::kTile && post != StepCode::kWorld && preFiber && fromWLS) {
+                track.absorbedFiber = true;
+            }
+
+            if (post == StepCode::kSipm && preFiber && fromWLS) {
+                SipmHit hit;
+                hit.sipmID = step.channel;
+                hit.sipmName = ChannelName(step.channel);
+                hit.time = step.postTime;
+                hit.position = position;
+                hit.energy = energy;
+                hit.wavelength = wavelength;
+                sink.AddSipmHit(hit, step);
+
+                sink.FillH1(11, hit.time / ns);
+                sink.FillH1(12, hit.wavelength);
+                sink.FillH2(12, step.postPosition.x() / mm, step.postPosition.y() / mm, hit.time);
+                sink.FillH2(13, step.postPosition.y() / mm, step.postPosition.z() / mm, hit.time);
+                sink.FillH2(14, step.postPosition.x() / mm, step.postPosition.z() / mm, hit.time);
+            }
+        }
+
+        // Fill 1D histograms
+        sink.FillH1(0, edep / MeV);
+        sink.FillH1(1, globalTime / ns);
+
+        // Fill 2D histograms with timing
+        sink.FillH2(0, position.x() / mm, position.y() / mm, globalTime / ns);
+        sink.FillH2(1, position.y() / mm, position.z() / mm, globalTime / ns);
+        sink.FillH2(2, position.x() / mm, position.z() / mm, globalTime / ns);
+
+        // Fill 2D histograms with energy deposition
+        sink.FillH2(3, position.x() / mm, position.y() / mm, edep / MeV);
+        sink.FillH2(4, position.y() / mm, position.z() / mm, edep / MeV);
+        sink.FillH2(5, position.x() / mm, position.z() / mm, edep / MeV);
+
+        // Fill volume-specific histograms
+        if (volume == StepCode::kFiberClad) {
+            sink.FillH2(6, position.x() / mm, position.y() / mm, edep / MeV);
+            sink.FillH2(7, position.y() / mm, position.z() / mm, edep / MeV);
+            sink.FillH2(8, position.x() / mm, position.z() / mm, edep / MeV);
+        }
+        else if (volume == StepCode::kFiberCore) {
+            sink.FillH2(9, position.x() / mm, position.y() / mm, edep / MeV);
+            sink.FillH2(10, position.y() / mm, position.z() / mm, edep / MeV);
+            sink.FillH2(11, position.x() / mm, position.z() / mm, edep / MeV);
+        }
+    }
+
+    void StepAnalysis::EndTrack(const TrackSummary& track, StepSink& sink)
+    {
+        if (track.steps == 0) return;
+
+        const G4double wavelength = (1239.84193 * eV) / track.energy;
+        sink.CountProcess(track.creationVolume, track.creator, true);
+
+        if (track.creator == StepCode::kOpWLS) {
+            // This is a re-emitted photon
+            sink.FillH1(3, track.energy / eV);    // Energy after WLS
+            sink.FillH1(5, wavelength);           // Wavelength after WLS
+            sink.FillH1(10, wavelength);
+        }
+        if (track.inCladding) {
+            sink.FillH1(6, wavelength);           // Wavelength in cladding
+            sink.FillH1(7, track.energy / eV);    // Energy in cladding
+        }
+        if (track.inCore) {
+            sink.FillH1(8, wavelength);           // Wavelength in core
+            sink.FillH1(9, track.energy / eV);    // Energy in core
+        }
+
+        if (track.enteredFiber) sink.CountEnteredFiber();
+        if (track.absorbedFiber) sink.CountAbsorbedFiber();
+    }
+
+    void StepAnalysis::BookHistograms()
+    {
+        auto analysisManager = G4AnalysisManager::Instance();
+
+        analysisManager->CreateH1("edep", "Energy Deposition Distribution",
+            100, 0., 2.0E-5 * CLHEP::MeV);
+        analysisManager->SetH1XAxisTitle(0, "Energy Deposition [MeV]");
+        analysisManager->SetH1YAxisTitle(0, "Counts");
+
+        analysisManager->CreateH1("time", "Time Distribution",
+            100, 0., 3.0);
+        analysisManager->SetH1XAxisTitle(1, "Photon Time [ns]");
+        analysisManager->SetH1YAxisTitle(1, "Counts");
+
+        // Create 2D histograms
+        analysisManager->CreateH2("timing_xy", "XY Timing",
+            100, -400., 300., 100, -400., 300.);
+        analysisManager->SetH2XAxisTitle(0, "x [mm]");
+        analysisManager->SetH2YAxisTitle(0, "y [mm]");
+        analysisManager->SetH2ZAxisTitle(0, "Time [ns]");
+
+        analysisManager->CreateH2("timing_yz", "YZ Timing",
+            //100, -400., 300., 100, -10., 10.);
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(1, "y [mm]");
+        analysisManager->SetH2YAxisTitle(1, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(1, "Time [ns]");
+
+        analysisManager->CreateH2("timing_xz", "XZ Timing",
+            //100, -400., 300., 100, -10., 10.);
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(2, "x [mm]");
+        analysisManager->SetH2YAxisTitle(2, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(2, "Time [ns]");
+
+        analysisManager->CreateH2("edep_xy", "XY Energy Deposition",
+            100, -400., 300., 100, -400., 300.);
+        analysisManager->SetH2XAxisTitle(3, "x [mm]");
+        analysisManager->SetH2YAxisTitle(3, "y [mm]");
+        analysisManager->SetH2ZAxisTitle(3, "Energy [MeV]");
+
+        analysisManager->CreateH2("edep_yz", "YZ Energy Deposition",
+            //100, -400., 300., 100, -10., 10.);
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(4, "y [mm]");
+        analysisManager->SetH2YAxisTitle(4, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(4, "Energy [MeV]");
+
+        analysisManager->CreateH2("edep_xz", "XZ Energy Deposition",
+            //100, -400., 300., 100, -10., 10.);
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(5, "x [mm]");
+        analysisManager->SetH2YAxisTitle(5, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(5, "Energy [MeV]");
+
+        analysisManager->CreateH2("clad_xy", "Cladding XY",
+            100, -400., 300., 100, -400., 300.);
+        analysisManager->SetH2XAxisTitle(6, "x [mm]");
+        analysisManager->SetH2YAxisTitle(6, "y [mm]");
+        analysisManager->SetH2ZAxisTitle(6, "Energy [MeV]");
+
+        analysisManager->CreateH2("clad_yz", "Cladding YZ",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(7, "y [mm]");
+        analysisManager->SetH2YAxisTitle(7, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(7, "Energy [MeV]");
+
+        analysisManager->CreateH2("clad_xz", "Cladding XZ",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(8, "x [mm]");
+        analysisManager->SetH2YAxisTitle(8, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(8, "Energy [MeV]");
+
+        analysisManager->CreateH2("core_xy", "Core XY",
+            100, -400., 300., 100, -400., 300.);
+        analysisManager->SetH2XAxisTitle(9, "x [mm]");
+        analysisManager->SetH2YAxisTitle(9, "y [mm]");
+        analysisManager->SetH2ZAxisTitle(9, "Energy [MeV]");
+
+        analysisManager->CreateH2("core_yz", "Core YZ",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(10, "y [mm]");
+        analysisManager->SetH2YAxisTitle(10, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(10, "Energy [MeV]");
+
+        analysisManager->CreateH2("core_xz", "Core XZ",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(11, "x [mm]");
+        analysisManager->SetH2YAxisTitle(11, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(11, "Energy [MeV]");
+
+        analysisManager->CreateH1("PhotonEnergyBeforeWLS", "Photon Energy Before WLS",
+            100, 2.0, 3.5);
+        analysisManager->SetH1XAxisTitle(2, "Energy [eV]");
+        analysisManager->SetH1YAxisTitle(2, "Counts");
+
+        analysisManager->CreateH1("PhotonEnergyAfterWLS", "Photon Energy After WLS",
+            100, 2.0, 3.5);
+        analysisManager->SetH1XAxisTitle(3, "Energy [eV]");
+        analysisManager->SetH1YAxisTitle(3, "Counts");
+
+        analysisManager->CreateH1("PhotonWavelengthBeforeWLS", "Photon Wavelength Before WLS",
+            100, 350., 600.);
+        analysisManager->SetH1XAxisTitle(4, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(4, "Counts");
+
+        analysisManager->CreateH1("PhotonWavelengthAfterWLS", "Photon Wavelength After WLS",
+            100, 350., 600.);
+        analysisManager->SetH1XAxisTitle(5, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(5, "Counts");
+
+        analysisManager->CreateH1("CladdingWavelength", "Photon Wavelength in Cladding",
+            100, 300., 600.);
+        analysisManager->SetH1XAxisTitle(6, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(6, "Counts");
+
+        analysisManager->CreateH1("CladdingEnergy", "Photon Energy in Cladding",
+            100, 1.5, 4.1);
+        analysisManager->SetH1XAxisTitle(7, "Energy [eV]");
+        analysisManager->SetH1YAxisTitle(7, "Counts");
+
+        analysisManager->CreateH1("CoreWavelength", "Photon Wavelength in Core",
+            100, 300., 600.);
+        analysisManager->SetH1XAxisTitle(8, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(8, "Counts");
+
+        analysisManager->CreateH1("CoreEnergy", "Photon Energy in Core",
+            100, 1.5, 4.1);
+        analysisManager->SetH1XAxisTitle(9, "Energy [eV]");
+        analysisManager->SetH1YAxisTitle(9, "Counts");
+
+        analysisManager->CreateH1("WLSEmissionSpectrum", "WLS Emission Spectrum",
+            200, 300., 600.);
+        analysisManager->SetH1XAxisTitle(10, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(10, "Counts");
+
+        analysisManager->CreateH1("SipmTimeSpectrum", "Sipm Time Spectrum",
+            100, 0., 300.0);
+        analysisManager->SetH1XAxisTitle(11, "Time [ns]");
+        analysisManager->SetH1YAxisTitle(11, "Counts");
+
+        analysisManager->CreateH1("SipmWavelength", "Photon Wavelenght in Sipm",
+            200, 300, 600);
+        analysisManager->SetH1XAxisTitle(12, "Wavelength [nm]");
+        analysisManager->SetH1YAxisTitle(12, "Counts");
+
+        analysisManager->CreateH2("Sipm_Timing_xy", "Sipm XY Timing",
+            100, -400., 300., 100, -400., 300.);
+        analysisManager->SetH2XAxisTitle(12, "x [mm]");
+        analysisManager->SetH2YAxisTitle(12, "y [mm]");
+        analysisManager->SetH2ZAxisTitle(12, "Time [ns]");
+
+        analysisManager->CreateH2("Sipm_Timing_yz", "Sipm YZ Timing",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(13, "y [mm]");
+        analysisManager->SetH2YAxisTitle(13, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(13, "Time [ns]");
+
+        analysisManager->CreateH2("Sipm_Timing_xz", "Sipm XZ Timing",
+            100, -400., 300., 100, -40., 40.);
+        analysisManager->SetH2XAxisTitle(14, "x [mm]");
+        analysisManager->SetH2YAxisTitle(14, "z [mm]");
+        analysisManager->SetH2ZAxisTitle(14, "Time [ns]");
+    }
+}
@@ -0,0 +1,112 @@
+
+#ifndef G4_BREMS_STEP_ANALYSIS_H
+#define G4_BREMS_STEP_ANALYSIS_H 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <cstdint>
+
+class G4Step;
+
+namespace G4_BREMS {
+
+    struct SipmHit;
+
+    // Small codes for the volume, process and creator names the optical photon analysis looks
+    // at; every other name maps to the k*Other code of its kind
+    namespace StepCode {
+        // Logical volumes
+        constexpr std::uint8_t kTile = 0;
+        constexpr std::uint8_t kFiberClad = 1;
+        constexpr std::uint8_t kFiberCore = 2;
+        constexpr std::uint8_t kSipm = 3;
+        constexpr std::uint8_t kWorld = 4;
+        constexpr std::uint8_t kOtherVolume = 5;
+        constexpr std::uint8_t kNoVolume = 6;       // post-step point outside the world
+        constexpr std::uint8_t kVolumes = 7;
+        // Processes, for the creator and the one that limited the step
+        constexpr std::uint8_t kPrimary = 0;        // creator only
+        constexpr std::uint8_t kCerenkov = 1;
+        constexpr std::uint8_t kScintillation = 2;
+        constexpr std::uint8_t kOpWLS = 3;
+        constexpr std::uint8_t kOpAbsorption = 4;
+        constexpr std::uint8_t kTransportation = 5;
+        constexpr std::uint8_t kOtherProcess = 6;
+        constexpr std::uint8_t kProcesses = 7;
+
+        std::uint8_t Volume(const G4String& name);
+        std::uint8_t Process(const G4String& name);
+        const char* VolumeName(std::uint8_t code);
+        const char* ProcessName(std::uint8_t code);
+    }
+
+    // What the analysis needs of one optical photon step
+    struct StepRecord {
+        G4int event;
+        G4int track;                  // track ID, unique within the event
+        std::uint8_t preVolume;
+        std::uint8_t postVolume;
+        std::uint8_t creator;
+        std::uint8_t process;         // of the post-step point
+        G4int channel;                // copy number of the post-step SiPM, -1 elsewhere
+        G4ThreeVector position;       // pre-step point
+        G4double time;                // pre-step global time
+        G4double edep;
+        G4double energy;              // photon total energy
+        G4ThreeVector postPosition;
+        G4double postTime;            // post-step global time
+    };
+
+    // What the analysis keeps of one photon between its steps: the quantities that are constant
+    // along the track and whether it ever made the transitions that are counted per photon
+    struct TrackSummary {
+        G4int steps = 0;
+        std::uint8_t creator = StepCode::kPrimary;
+        std::uint8_t creationVolume = StepCode::kOtherVolume;   // pre-step volume of the first step
+        G4double energy = 0.;                                   // optical photons keep theirs
+        G4bool inCladding = false;
+        G4bool inCore = false;
+        G4bool enteredFiber = false;
+        G4bool absorbedFiber = false;
+    };
+
+    // Receives the counts, hits and histogram fills of the analysis: the stepping action during
+    // tracking, G4_Brems_replay when a step tape is read back
+    class StepSink
+    {
+    public:
+        virtual ~StepSink() = default;
+
+        virtual void CountVolume(std::uint8_t volume) = 0;
+        virtual void CountProcess(std::uint8_t volume, std::uint8_t process, G4bool isCreationProcess) = 0;
+        virtual void CountEnteredFiber() = 0;
+        virtual void CountAbsorbedFiber() = 0;
+        // The sink may complete the hit before storing it
+        virtual void AddSipmHit(SipmHit& hit, const StepRecord& step) = 0;
+        virtual void FillH1(G4int id, G4double value) = 0;
+        virtual void FillH2(G4int id, G4double x, G4double y, G4double weight) = 0;
+    };
+
+    // The optical photon analysis of SteppingAction, split into the extraction of a StepRecord
+    // from the G4Step and the counting and histogramming of the record, so that the same code
+    // runs on tracked steps and on steps replayed from a tape.
+    //
+    // Analyze does the per-step work: the step histograms, the interaction and volume counts,
+    // the SiPM hits, and it updates the summary of the photon. EndTrack fills the per-photon
+    // observables once from that summary: the creation process counts, the WLS emission and
+    // the cladding and core spectra, and the photons that entered or were absorbed in a fiber.
+    class StepAnalysis
+    {
+    public:
+        // false when the step has no pre-step volume
+        static G4bool Extract(const G4Step* step, G4int eventID, StepRecord& record);
+        static void Analyze(const StepRecord& step, TrackSummary& track, StepSink& sink);
+        // Nothing for a track without optical photon steps
+        static void EndTrack(const TrackSummary& track, StepSink& sink);
+
+        // H1 and H2 filled by Analyze, on the current G4AnalysisManager
+        static void BookHistograms();
+    };
+}
+
+#endif
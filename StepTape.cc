@@ -0,0 +1,134 @@
+
+#include "StepTape.hh"
+#include "G4AutoLock.hh"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+namespace G4_BREMS {
+
+    namespace {
+        G4Mutex stepTapeMutex = G4MUTEX_INITIALIZER;
+        std::ofstream gTapeFile;
+        G4String gTapePath;
+        std::atomic<long long> gTapeSteps(0);
+        std::atomic<long long> gTapeBlocks(0);
+
+        const char kTapeMagic[8] = { 'S', 'N', 'F', 'T', 'A', 'P', 'E', '2' };
+    }
+
+    TapeParameters StepTape::fParameters;
+
+    void StepTape::OpenOutput(const G4String& path)
+    {
+        G4AutoLock lock(&stepTapeMutex);
+        if (gTapeFile.is_open()) gTapeFile.close();
+        gTapeSteps = 0;
+        gTapeBlocks = 0;
+        gTapePath = path;
+        gTapeFile.open(path, std::ios::binary | std::ios::trunc);
+        if (!gTapeFile.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return;
+        }
+        gTapeFile.write(kTapeMagic, sizeof(kTapeMagic));
+    }
+
+    void StepTape::CloseOutput()
+    {
+        G4AutoLock lock(&stepTapeMutex);
+        if (!gTapeFile.is_open()) return;
+        gTapeFile.close();
+        G4cout << "Step tape: " << gTapeSteps << " steps in " << gTapeBlocks << " blocks written to "
+            << gTapePath << G4endl;
+    }
+
+    void StepTape::Append(const StepRecord& step)
+    {
+        fEvent.push_back(static_cast<std::uint32_t>(step.event));
+        fTrack.push_back(static_cast<std::uint32_t>(step.track));
+        fPreVolume.push_back(step.preVolume);
+        fPostVolume.push_back(step.postVolume);
+        fCreator.push_back(step.creator);
+        fProcess.push_back(step.process);
+        fChannel.push_back(static_cast<std::int16_t>(step.channel));
+        fX.push_back(static_cast<float>(step.position.x()));
+        fY.push_back(static_cast<float>(step.position.y()));
+        fZ.push_back(static_cast<float>(step.position.z()));
+        fTime.push_back(static_cast<float>(step.time));
+        fEdep.push_back(static_cast<float>(step.edep));
+        fEnergy.push_back(static_cast<float>(step.energy));
+        fPostX.push_back(static_cast<float>(step.postPosition.x()));
+        fPostY.push_back(static_cast<float>(step.postPosition.y()));
+        fPostZ.push_back(static_cast<float>(step.postPosition.z()));
+        fPostTime.push_back(static_cast<float>(step.postTime));
+    }
+
+    void StepTape::Flush()
+    {
+        if (fEvent.empty()) return;
+
+        // Serialized outside the lock, so threads only wait for the write itself
+        const auto n = static_cast<std::uint32_t>(fEvent.size());
+        fBuffer.clear();
+        fBuffer.insert(fBuffer.end(), reinterpret_cast<const char*>(&n), reinterpret_cast<const char*>(&n) + sizeof(n));
+        ForEachColumn([this](auto& column) {
+            const char* bytes = reinterpret_cast<const char*>(column.data());
+            fBuffer.insert(fBuffer.end(), bytes, bytes + column.size() * sizeof(column[0]));
+        });
+        {
+            G4AutoLock lock(&stepTapeMutex);
+            if (gTapeFile.is_open()) {
+                gTapeFile.write(fBuffer.data(), fBuffer.size());
+                gTapeSteps += n;
+                gTapeBlocks++;
+            }
+        }
+        Clear();
+    }
+
+    void StepTape::Clear()
+    {
+        ForEachColumn([](auto& column) { column.clear(); });
+    }
+
+    G4bool StepTape::ReadHeader(std::istream& in)
+    {
+        char magic[8];
+        return in.read(magic, sizeof(magic)) && std::memcmp(magic, kTapeMagic, sizeof(magic)) == 0;
+    }
+
+    G4bool StepTape::ReadBlock(std::istream& in)
+    {
+        std::uint32_t n = 0;
+        if (!in.read(reinterpret_cast<char*>(&n), sizeof(n))) return false;
+        G4bool ok = true;
+        ForEachColumn([&](auto& column) {
+            column.resize(n);
+            ok = ok && in.read(reinterpret_cast<char*>(column.data()), n * sizeof(column[0]));
+        });
+        if (!ok) {
+            // A truncated block is an error, unlike the end of the file before a block
+            Clear();
+            in.setstate(std::ios::badbit);
+        }
+        return ok;
+    }
+
+    void StepTape::Get(std::size_t i, StepRecord& step) const
+    {
+        step.event = static_cast<G4int>(fEvent[i]);
+        step.track = static_cast<G4int>(fTrack[i]);
+        step.preVolume = fPreVolume[i];
+        step.postVolume = fPostVolume[i];
+        step.creator = fCreator[i];
+        step.process = fProcess[i];
+        step.channel = fChannel[i];
+        step.position.set(fX[i], fY[i], fZ[i]);
+        step.time = fTime[i];
+        step.edep = fEdep[i];
+        step.energy = fEnergy[i];
+        step.postPosition.set(fPostX[i], fPostY[i], fPostZ[i]);
+        step.postTime = fPostTime[i];
+    }
+}
@@ -0,0 +1,84 @@
+
+#ifndef G4_BREMS_STEP_TAPE_H
+#define G4_BREMS_STEP_TAPE_H 1
+
+#include "StepAnalysis.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Configured on the master by TapeMessenger between runs
+    struct TapeParameters {
+        G4bool enabled = false;
+        std::uint32_t volumes = ~0u;                // bit per StepCode volume of the pre-step point
+    };
+
+    // Optical photon steps as StepRecords in structure-of-arrays blocks, so that the analysis
+    // of SteppingAction can be rerun by G4_Brems_replay without tracking. Every thread fills
+    // its own block and appends it to the run's file at the first track end after kBlockSize
+    // steps and at the end of the run, so the steps of a photon are never split over blocks.
+    //
+    // File layout (little endian): char[8] "SNFTAPE2", then blocks of
+    //   uint32 n, uint32 event[n], uint32 track[n], uint8 preVolume[n], postVolume[n], creator[n], process[n],
+    //   int16 channel[n], float x[n], y[n], z[n], time[n], edep[n], energy[n],
+    //   float postX[n], postY[n], postZ[n], postTime[n]
+    // with codes from StepCode and Geant4 units (mm, ns, MeV). Blocks of different threads
+    // interleave; the event number identifies the event of a step.
+    class StepTape
+    {
+    public:
+        static constexpr std::size_t kBlockSize = 1 << 16;
+
+        static TapeParameters& Parameters() { return fParameters; }
+        static G4bool IsEnabled() { return fParameters.enabled; }
+        static G4bool Selects(const StepRecord& step) { return (fParameters.volumes >> step.preVolume) & 1u; }
+
+        // Recording: the master opens and closes the run's file, every thread appends blocks
+        static void OpenOutput(const G4String& path);
+        static void CloseOutput();
+
+        void Append(const StepRecord& step);
+        void EndTrack() { if (fEvent.size() >= kBlockSize) Flush(); }
+        void Flush();
+
+        // Reading: the header once, then one block at a time; false at the end of the file, or
+        // with the stream's badbit set when the file ends inside a block
+        static G4bool ReadHeader(std::istream& in);
+        G4bool ReadBlock(std::istream& in);
+        std::size_t size() const { return fEvent.size(); }
+        void Get(std::size_t i, StepRecord& step) const;
+
+    private:
+        void Clear();
+
+        // f(column) for every column, in file order
+        template <typename F>
+        void ForEachColumn(F f)
+        {
+            f(fEvent); f(fTrack); f(fPreVolume); f(fPostVolume); f(fCreator); f(fProcess); f(fChannel);
+            f(fX); f(fY); f(fZ); f(fTime); f(fEdep); f(fEnergy); f(fPostX); f(fPostY); f(fPostZ); f(fPostTime);
+        }
+
+        static TapeParameters fParameters;
+
+        std::vector<std::uint32_t> fEvent;
+        std::vector<std::uint32_t> fTrack;
+        std::vector<std::uint8_t> fPreVolume;
+        std::vector<std::uint8_t> fPostVolume;
+        std::vector<std::uint8_t> fCreator;
+        std::vector<std::uint8_t> fProcess;
+        std::vector<std::int16_t> fChannel;
+        std::vector<float> fX, fY, fZ;
+        std::vector<float> fTime;
+        std::vector<float> fEdep;
+        std::vector<float> fEnergy;
+        std::vector<float> fPostX, fPostY, fPostZ;
+        std::vector<float> fPostTime;
+        std::vector<char> fBuffer;
+    };
+}
+
+#endif
@@ -1,10 +1,19 @@
 
 #include "SteppingAction.hh"
 #include "RunAction.hh"
+#include "EventAction.hh"
+#include "TrackingAction.hh"
 #include "G4Step.hh"
 #include "G4Track.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4OpBoundaryProcess.hh"
+#include "G4ProcessManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VProcess.hh"
 #include "G4RunManager.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
 #include "G4AnalysisManager.hh"
 #include "G4Threading.hh"
 #include "G4SystemOfUnits.hh"
@@ -13,6 +22,18 @@
 
 namespace {
     G4Mutex mutex = G4MUTEX_INITIALIZER;
+
+    // Processes are per thread, so is the boundary process whose status tells reflections apart
+    G4OpBoundaryProcess* FindBoundaryProcess()
+    {
+        G4ProcessManager* manager = G4OpticalPhoton::OpticalPhotonDefinition()->GetProcessManager();
+        if (!manager) return nullptr;
+        G4ProcessVector* processes = manager->GetProcessList();
+        for (G4int i = 0; i < static_cast<G4int>(processes->size()); i++) {
+            if (auto boundary = dynamic_cast<G4OpBoundaryProcess*>((*processes)[i])) return boundary;
+        }
+        return nullptr;
+    }
 }
 
 namespace G4_BREMS {
@@ -21,7 +42,11 @@ namespace G4_BREMS {
     G4_BREMS::SteppingAction::SteppingAction(RunAction* runAction)
         : G4UserSteppingAction(),
         fRunAction(runAction),
-        fSensitiveVolume(nullptr)
+        fEventAction(nullptr),
+        fSensitiveVolume(nullptr),
+        fCurrentStep(nullptr),
+        fBoundary(nullptr),
+        fBoundaryResolved(false)
     {
     }
 
@@ -31,206 +56,127 @@ namespace G4_BREMS {
 
     void G4_BREMS::SteppingAction::UserSteppingAction(const G4Step* step)
     {
-        // Skip processing in master thread
-        if (G4Threading::IsMasterThread()) return;
+        // Charged and gamma deposits in the tiles, on whichever thread tracks those particles
+        // (the master in sub-event mode)
+        fRunAction->GetTileScorer().Score(step);
+
+        // Skip processing in the master thread of MT runs (the sequential run manager, used
+        // per process by --processes, tracks everything in the master thread)
+        if (G4Threading::IsMultithreadedApplication() && G4Threading::IsMasterThread()) return;
 
         // Get the track and check if it's an optical photon
         G4Track* track = step->GetTrack();
         if (!track || track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return;
 
-        // Get position and energy information
-        G4ThreeVector position = step->GetPreStepPoint()->GetPosition();
-        G4double globalTime = step->GetPreStepPoint()->GetGlobalTime();
-        G4double edep = step->GetTotalEnergyDeposit();
-        G4double energy = track->GetTotalEnergy();
-        G4double wavelength = (1239.84193 * eV) / energy;
-
-        // Get volume name
-        G4VPhysicalVolume* volume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume();
-        if (!volume) return;
-        G4LogicalVolume* logicalVolume = volume->GetLogicalVolume();
-        if (!logicalVolume) return;
-        G4String volumeName = logicalVolume->GetName();
-
-        G4String creatorName = "Primary";
-        const G4VProcess* creatorProcess = track->GetCreatorProcess();
-        if (creatorProcess != nullptr) {
-            creatorName = creatorProcess->GetProcessName();
-        }
-
-        // Get process names
-        G4String processName = "Unknown";
-        const G4StepPoint* postStepPoint = step->GetPostStepPoint();
-        if (postStepPoint) {
-            const G4VProcess* process = postStepPoint->GetProcessDefinedStep();
-            if (process) {
-                processName = process->GetProcessName();
+        const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+        StepRecord record;
+        if (!StepAnalysis::Extract(step, event ? event->GetEventID() : -1, record)) return;
+        if (StepTape::IsEnabled() && StepTape::Selects(record)) fTape.Append(record);
+
+        // Provenance, before the analysis may turn this step into a hit
+        fProvenance.AddPath(record.preVolume, step->GetStepLength());
+        if (step->GetPostStepPoint()->GetStepStatus() == fGeomBoundary) {
+            if (!fBoundaryResolved) {
+                fBoundary = FindBoundaryProcess();
+                fBoundaryResolved = true;
+            }
+            if (fBoundary) {
+                switch (fBoundary->GetStatus()) {
+                case TotalInternalReflection:
+                    fProvenance.AddTotalInternalReflection();
+                    break;
+                case FresnelReflection:
+                case LambertianReflection:
+                case LobeReflection:
+                case SpikeReflection:
+                case BackScattering:
+                    fProvenance.AddReflection();
+                    break;
+                default:
+                    break;
+                }
             }
         }
 
-        // Track WLS events
-        if (creatorName == "OpWLS") {
-            // This is a re-emitted photon
-            G4double reEmitEnergy = track->GetKineticEnergy();
-            G4double reEmitWavelength = (1239.84193 * eV) / reEmitEnergy;
-
-            auto analysisManager = G4AnalysisManager::Instance();
-            analysisManager->FillH1(3, reEmitEnergy / eV);    // Energy after WLS
-            analysisManager->FillH1(5, reEmitWavelength);   // Wavelength after WLS
-            analysisManager->FillH1(10, reEmitWavelength);
-        }
-        else if (processName == "OpWLS") {
-            // This is a photon about to be absorbed by WLS
-            G4double absorbEnergy = track->GetKineticEnergy();
-            G4double absorbWavelength = (1239.84193 * eV) / absorbEnergy;
-
-            auto analysisManager = G4AnalysisManager::Instance();
-            analysisManager->FillH1(2, absorbEnergy / eV);    // Energy before WLS
-            analysisManager->FillH1(4, absorbWavelength);   // Wavelength before WLS
-        }
+        fCurrentStep = step;
+        StepAnalysis::Analyze(record, fTrack, *this);
+    }
 
-        // Update process counts
-        fRunAction->AddProcessCount(volumeName, creatorName, true);
-        fRunAction->AddProcessCount(volumeName, processName, false);
+    void G4_BREMS::SteppingAction::BeginTrack(const G4Track* track)
+    {
+        fTrack = TrackSummary();
+        if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return;
 
-        if (volumeName == "Tile") {
-            fRunAction->IncrementTileCount();
-        }
-        else if (volumeName == "FiberClad") {
-            fRunAction->IncrementCladCount();
-        }
-        else if (volumeName == "FiberCore") {
-            fRunAction->IncrementCoreCount();
-        }
-        else if (volumeName == "Sipm") {
-            fRunAction->IncrementSipmCount();
-        }
-        else {
-            fRunAction->IncrementOtherCount();
+        // WLS photons continue the provenance of the photon they came from
+        if (auto info = dynamic_cast<const PhotonTrackInfo*>(track->GetUserInformation())) {
+            fProvenance = info->provenance;
+            return;
         }
+        fProvenance = PhotonProvenance();
+        const G4VProcess* creator = track->GetCreatorProcess();
+        const G4VPhysicalVolume* volume = track->GetVolume();
+        fProvenance.SetOrigin(creator ? StepCode::Process(creator->GetProcessName()) : StepCode::kPrimary,
+            volume ? StepCode::Volume(volume->GetLogicalVolume()->GetName()) : PhotonProvenance::kNoVolume);
+    }
 
-        G4VPhysicalVolume* preVolume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume();
-        G4VPhysicalVolume* postVolume = step->GetPostStepPoint()->GetTouchableHandle()->GetVolume();
-        G4double stepNum = step->GetTrack()->GetCurrentStepNumber();
-
-        if (preVolume && postVolume) {
-            G4String preVolumeName = preVolume->GetLogicalVolume()->GetName();
-            G4String postVolumeName = postVolume->GetLogicalVolume()->GetName();
-
-            if (preVolumeName != postVolumeName) {
-
-                if ((postVolumeName == "FiberCore" && preVolumeName == "FiberClad") ||
-                    (postVolumeName == "FiberClad" && preVolumeName == "Tile") && creatorName != "OpWLS") {
-                    G4double initial_energy = track->GetKineticEnergy();
-                    G4double initial_vertex_energy = track->GetVertexKineticEnergy();
-                    G4double initial_Wavelength = (1239.84193 * eV) / initial_energy;
-                    G4ThreeVector initial_momentum = track->GetMomentum();
-                    G4ThreeVector initial_direction = track->GetMomentumDirection();
+    void G4_BREMS::SteppingAction::EndTrack()
+    {
+        StepAnalysis::EndTrack(fTrack, *this);
+        fTrack = TrackSummary();
+        // Blocks end on track boundaries, so a replay sees every photon whole
+        if (StepTape::IsEnabled()) fTape.EndTrack();
+    }
 
-                    fRunAction->IncrementPhotonsEnteredFiber();
-                }
+    void G4_BREMS::SteppingAction::CountVolume(std::uint8_t volume)
+    {
+        switch (volume) {
+        case StepCode::kTile: fRunAction->IncrementTileCount(); break;
+        case StepCode::kFiberClad: fRunAction->IncrementCladCount(); break;
+        case StepCode::kFiberCore: fRunAction->IncrementCoreCount(); break;
+        case StepCode::kSipm: fRunAction->IncrementSipmCount(); break;
+        default: fRunAction->IncrementOtherCount(); break;
+        }
+    }
 
-                if ((postVolumeName != "Tile" && postVolumeName != "World") &&
-                    (preVolumeName == "FiberCore" || preVolumeName == "FiberClad")
-                    && creatorName == "OpWLS") {
+    void G4_BREMS::SteppingAction::CountProcess(std::uint8_t volume, std::uint8_t process, G4bool isCreationProcess)
+    {
+        fRunAction->AddProcessCount(StepCode::VolumeName(volume), StepCode::ProcessName(process), isCreationProcess);
+    }
 
-                    G4double final_energy = track->GetKineticEnergy();
-                    G4double final_vertex_energy = track->GetVertexKineticEnergy();
-                    G4double final_Wavelength = (1239.84193 * eV) / final_energy;
-                    G4ThreeVector final_momentum = track->GetMomentum();
-                    G4ThreeVector final_direction = track->GetMomentumDirection();
+    void G4_BREMS::SteppingAction::CountEnteredFiber()
+    {
+        fRunAction->IncrementPhotonsEnteredFiber();
+    }
 
-                    fRunAction->IncrementPhotonsAbsorbedFiber();
-                }
+    void G4_BREMS::SteppingAction::CountAbsorbedFiber()
+    {
+        fRunAction->IncrementPhotonsAbsorbedFiber();
+    }
 
-                if ((postVolumeName == "Sipm") && (preVolumeName == "FiberCore" || preVolumeName == "FiberClad")
-                    && creatorName == "OpWLS") {
-                
-                    G4double hitTime = step->GetPostStepPoint()->GetGlobalTime();
-                    G4double hitTimeLocal = step->GetPostStepPoint()->GetLocalTime();
-                    G4ThreeVector hitPosition = step->GetPreStepPoint()->GetPosition();
-                    G4ThreeVector hitPositionSipm = step->GetPostStepPoint()->GetPosition();
-
-                    G4double hitEnergy = track->GetTotalEnergy();
-                    G4double hitWavelength = (1239.84193 * eV) / hitEnergy; // Wavelength in nm
-
-                    G4VPhysicalVolume* physVolume = step->GetPostStepPoint()->GetTouchableHandle()->GetVolume();
-                    G4String fullSipmName = physVolume->GetName();
-                    G4int sipmID = step->GetPostStepPoint()->GetTouchableHandle()->GetCopyNumber();
-                    //G4cout << "Hit SiPM with name: " << fullSipmName
-                        //<< ", Copy Number: " << sipmID << G4endl;
-                    // Store hit information
-                    SipmHit hit;
-                    hit.sipmID = sipmID;
-                    hit.sipmName = fullSipmName;
-                    hit.time = hitTime;
-                    hit.position = hitPosition;
-                    hit.energy = hitEnergy;
-                    hit.wavelength = hitWavelength;
-                    fSipmHits.push_back(hit);
-
-                    G4AutoLock lock(&sipmHitsMutex);
-                    gSipmHits.push_back(hit);
-                    lock.unlock();
-
-
-                    G4cout << "Hit SiPM with name: " << fullSipmName << " " << "Hit Time: " << hitTime << " "
-                        << "Hit Local Time: " << hitTimeLocal << " " << "Hit Position: "
-                        << hitPosition << " " << "Hit Wavelength: " << hitWavelength << " " << "Pre Volume: " << preVolumeName
-                        << " " << "Hit Position Sipm: " << hitPositionSipm 
-                        //<< " " << "Energy Deposition in Sipm: "
-                        //<< edepSipm 
-                        << G4endl;
-                    //G4cout << "Hit Time: " << hitTime << " " << "Hit Position: " << hitPosition << " " << "Hit Energy: "
-                        //<< hitEnergy << " " << "Hit Wavelength: " << hitWavelength << " " << "Pre Volume: " << preVolumeName
-                        //<< " Step Number in Sipm: " << stepNum << " SiPM ID: " << sipmID << G4endl;
-
-                    //G4cout << "Adding SiPM hit to collection, current size: " << fSipmHits.size() << G4endl;
-                    fSipmHits.push_back(hit);
-                    //G4cout << "New collection size: " << fSipmHits.size() << G4endl;
-
-                    auto analysisManager = G4AnalysisManager::Instance();
-                    analysisManager->FillH1(11, hitTime / ns);
-                    analysisManager->FillH1(12, hitWavelength);
-                    analysisManager->FillH2(12, hitPositionSipm.x() / mm, hitPositionSipm.y() / mm, hitTime);
-                    analysisManager->FillH2(13, hitPositionSipm.y() / mm, hitPositionSipm.z() / mm, hitTime);
-                    analysisManager->FillH2(14, hitPositionSipm.x() / mm, hitPositionSipm.z() / mm, hitTime);
+    void G4_BREMS::SteppingAction::AddSipmHit(SipmHit& hit, const StepRecord& step)
+    {
+        hit.provenance = fProvenance;
+        if (ChannelHistograms::IsEnabled()) fRunAction->GetChannelHistograms().AddHit(hit.sipmID, hit.time);
+        else fSipmHits.push_back(hit);
+
+        // Published to gSipmHits once per event by the event action
+        fEventAction->AddSipmHit(hit);
+
+        G4cout << "Hit SiPM with name: " << hit.sipmName << " " << "Hit Time: " << hit.time << " "
+            << "Hit Local Time: " << fCurrentStep->GetPostStepPoint()->GetLocalTime() << " " << "Hit Position: "
+            << hit.position << " " << "Hit Wavelength: " << hit.wavelength << " " << "Pre Volume: "
+            << StepCode::VolumeName(step.preVolume) << " " << "Hit Position Sipm: " << step.postPosition
+            << G4endl;
+    }
 
-                }
-            }
-        }
+    void G4_BREMS::SteppingAction::FillH1(G4int id, G4double value)
+    {
+        G4AnalysisManager::Instance()->FillH1(id, value);
+    }
 
-        auto analysisManager = G4AnalysisManager::Instance();
-
-        // Fill 1D histograms
-        analysisManager->FillH1(0, edep / MeV);
-        analysisManager->FillH1(1, globalTime / ns);
-
-        // Fill 2D histograms with timing
-        analysisManager->FillH2(0, position.x() / mm, position.y() / mm, globalTime / ns);
-        analysisManager->FillH2(1, position.y() / mm, position.z() / mm, globalTime / ns);
-        analysisManager->FillH2(2, position.x() / mm, position.z() / mm, globalTime / ns);
-
-        // Fill 2D histograms with energy deposition
-        analysisManager->FillH2(3, position.x() / mm, position.y() / mm, edep / MeV);
-        analysisManager->FillH2(4, position.y() / mm, position.z() / mm, edep / MeV);
-        analysisManager->FillH2(5, position.x() / mm, position.z() / mm, edep / MeV);
-
-        // Fill volume-specific histograms
-        if (volumeName == "FiberClad") {
-            analysisManager->FillH1(6, wavelength);  // Wavelength in cladding
-            analysisManager->FillH1(7, energy / eV); // Energy in cladding
-            analysisManager->FillH2(6, position.x() / mm, position.y() / mm, edep / MeV);
-            analysisManager->FillH2(7, position.y() / mm, position.z() / mm, edep / MeV);
-            analysisManager->FillH2(8, position.x() / mm, position.z() / mm, edep / MeV);
-        }
-        else if (volumeName == "FiberCore") {
-            analysisManager->FillH1(8, wavelength);  // Wavelength in core
-            analysisManager->FillH1(9, energy / eV); // Energy in core
-            analysisManager->FillH2(9, position.x() / mm, position.y() / mm, edep / MeV);
-            analysisManager->FillH2(10, position.y() / mm, position.z() / mm, edep / MeV);
-            analysisManager->FillH2(11, position.x() / mm, position.z() / mm, edep / MeV);
-        }
+    void G4_BREMS::SteppingAction::FillH2(G4int id, G4double x, G4double y, G4double weight)
+    {
+        G4AnalysisManager::Instance()->FillH2(id, x, y, weight);
     }
 
 } // namespace G4_BREMS
@@ -1,49 +1,85 @@
-
-#ifndef SteppingAction_h
-#define SteppingAction_h 1
-
-#include "G4UserSteppingAction.hh"
-#include "G4ThreeVector.hh"
-#include <vector>
-#include "G4LogicalVolume.hh"
-
-class G4Step;
-class G4Event;
-
-namespace G4_BREMS {
-    class RunAction;
-
-    // Structure to store SiPM hit information
-    struct SipmHit {
-        G4int sipmID;
-        G4String sipmName;
-        G4double time;
-        G4ThreeVector position;
-        G4double energy;
-        G4double wavelength;
-    };
-    extern std::vector<SipmHit> gSipmHits;
-
-    class SteppingAction : public G4UserSteppingAction
-    {
-    public:
-        SteppingAction(RunAction* runAction);
-        virtual ~SteppingAction();
-
-        virtual void UserSteppingAction(const G4Step*);
-        void SetRunAction(RunAction* runAction) { fRunAction = runAction; }
-
-        // Methods for SiPM hit handling
-        void ClearHits() { fSipmHits.clear(); }
-        const std::vector<SipmHit>& GetSipmHits() const { return fSipmHits; }
-
-    private:
-        RunAction* fRunAction;
-        G4LogicalVolume* fSensitiveVolume;
-        std::vector<SipmHit> fSipmHits;
-    };
-
-}
-
-#endif
-
+
+#ifndef SteppingAction_h
+#define SteppingAction_h 1
+
+#include "G4UserSteppingAction.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+#include "G4LogicalVolume.hh"
+#include "G4Threading.hh"
+#include "StepAnalysis.hh"
+#include "StepTape.hh"
+#include "PhotonProvenance.hh"
+
+class G4Step;
+class G4Event;
+class G4Track;
+class G4OpBoundaryProcess;
+
+namespace G4_BREMS {
+    class RunAction;
+    class EventAction;
+
+    // Structure to store SiPM hit information
+    struct SipmHit {
+        G4int sipmID;          // readout channel, see SipmChannel
+        G4String sipmName;
+        G4double time;
+        G4ThreeVector position;
+        G4double energy;
+        G4double wavelength;
+        PhotonProvenance provenance;    // of the detected photon and the photons it came from
+    };
+    extern std::vector<SipmHit> gSipmHits;
+    extern G4Mutex sipmHitsMutex;
+
+    // Runs the optical photon analysis of StepAnalysis on tracked steps, as its sink, and
+    // records the steps to the step tape when enabled
+    class SteppingAction : public G4UserSteppingAction, public StepSink
+    {
+    public:
+        SteppingAction(RunAction* runAction);
+        virtual ~SteppingAction();
+
+        virtual void UserSteppingAction(const G4Step*);
+        void SetRunAction(RunAction* runAction) { fRunAction = runAction; }
+        void SetEventAction(EventAction* eventAction) { fEventAction = eventAction; }
+
+        // Methods for SiPM hit handling
+        void ClearHits() { fSipmHits.clear(); }
+        const std::vector<SipmHit>& GetSipmHits() const { return fSipmHits; }
+
+        // Called by TrackingAction around every track: the per-photon part of the analysis and
+        // the provenance, inherited through PhotonTrackInfo for WLS photons
+        void BeginTrack(const G4Track* track);
+        void EndTrack();
+        const PhotonProvenance& GetProvenance() const { return fProvenance; }
+
+        // Appends the steps still buffered for the tape, at the end of the run
+        void FlushTape() { fTape.Flush(); }
+
+        void CountVolume(std::uint8_t volume) override;
+        void CountProcess(std::uint8_t volume, std::uint8_t process, G4bool isCreationProcess) override;
+        void CountEnteredFiber() override;
+        void CountAbsorbedFiber() override;
+        void AddSipmHit(SipmHit& hit, const StepRecord& step) override;
+        void FillH1(G4int id, G4double value) override;
+        void FillH2(G4int id, G4double x, G4double y, G4double weight) override;
+
+    private:
+        RunAction* fRunAction;
+        EventAction* fEventAction;
+        G4LogicalVolume* fSensitiveVolume;
+        std::vector<SipmHit> fSipmHits;
+        StepTape fTape;
+        TrackSummary fTrack;
+        PhotonProvenance fProvenance;
+        const G4Step* fCurrentStep;
+        G4OpBoundaryProcess* fBoundary;
+        G4bool fBoundaryResolved;
+    };
+
+}
+
+#endif
+
@@ -0,0 +1,67 @@
+
+#include "TapeMessenger.hh"
+#include "StepTape.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAString.hh"
+#include <sstream>
+
+namespace G4_BREMS {
+
+    TapeMessenger::TapeMessenger()
+        : G4UImessenger()
+    {
+        fTapeDirectory = new G4UIdirectory("/snf/tape/", false);
+        fTapeDirectory->SetGuidance("Optical photon step tape, replayed by G4_Brems_replay without tracking.");
+
+        fEnableCmd = new G4UIcmdWithABool("/snf/tape/enable", this);
+        fEnableCmd->SetGuidance("Record the optical photon steps of every event to steps_run<N>.tape.");
+        fEnableCmd->SetParameterName("enable", true);
+        fEnableCmd->SetDefaultValue(true);
+
+        fVolumesCmd = new G4UIcmdWithAString("/snf/tape/volumes", this);
+        fVolumesCmd->SetGuidance("Pre-step volumes whose steps are recorded: all (default) or a list of");
+        fVolumesCmd->SetGuidance("Tile FiberClad FiberCore Sipm World Other. A replay of a partial tape");
+        fVolumesCmd->SetGuidance("reproduces the counts and histograms of those steps only.");
+        fVolumesCmd->SetParameterName("volumes", false);
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fEnableCmd, fVolumesCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+    }
+
+    TapeMessenger::~TapeMessenger()
+    {
+        delete fEnableCmd;
+        delete fVolumesCmd;
+        delete fTapeDirectory;
+    }
+
+    void TapeMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        TapeParameters& parameters = StepTape::Parameters();
+        if (command == fEnableCmd) {
+            parameters.enabled = fEnableCmd->GetNewBoolValue(newValue);
+        }
+        else if (command == fVolumesCmd) {
+            std::istringstream is(newValue);
+            std::uint32_t volumes = 0;
+            G4String name;
+            while (is >> name) {
+                if (name == "all") {
+                    volumes = ~0u;
+                    continue;
+                }
+                std::uint8_t code = StepCode::Volume(name);
+                if (code == StepCode::kOtherVolume && name != "Other") {
+                    G4Exception("TapeMessenger::SetNewValue", "Tape_W001", JustWarning,
+                        ("Unknown volume " + name + ", the selection is unchanged.").c_str());
+                    return;
+                }
+                volumes |= 1u << code;
+            }
+            parameters.volumes = volumes;
+        }
+    }
+}
@@ -0,0 +1,30 @@
+
+#ifndef G4_BREMS_TAPE_MESSENGER_H
+#define G4_BREMS_TAPE_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithAString;
+
+namespace G4_BREMS {
+
+    // /snf/tape/: optical photon step tape for G4_Brems_replay (master only, see StepTape)
+    class TapeMessenger : public G4UImessenger
+    {
+    public:
+        TapeMessenger();
+        ~TapeMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fTapeDirectory;
+        G4UIcmdWithABool* fEnableCmd;
+        G4UIcmdWithAString* fVolumesCmd;
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+
+#include "TileSampler.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4RotationMatrix.hh"
+#include "Randomize.hh"
+#include <limits>
+
+namespace G4_BREMS {
+
+    namespace {
+        G4bool Contains(const G4LogicalVolume* volume, const G4String& name) {
+            if (volume->GetName() == name) return true;
+            for (std::size_t i = 0; i < volume->GetNoDaughters(); i++) {
+                if (Contains(volume->GetDaughter(i)->GetLogicalVolume(), name)) return true;
+            }
+            return false;
+        }
+    }
+
+    std::atomic<G4int> TileSampler::fGeometryGeneration(0);
+
+    TileSampler::TileSampler(const G4String& volumeName)
+        : fVolumeName(volumeName), fInitialized(false), fGeneration(0), fTried(0), fAccepted(0)
+    {
+    }
+
+    TileSampler::~TileSampler() = default;
+
+    G4bool TileSampler::Initialize()
+    {
+        G4VPhysicalVolume* world = G4TransportationManager::GetTransportationManager()
+            ->GetNavigatorForTracking()->GetWorldVolume();
+        if (!world) return false;
+        fGeneration = fGeometryGeneration;
+
+        const G4double huge = std::numeric_limits<G4double>::max();
+        fMin = G4ThreeVector(huge, huge, huge);
+        fMax = -fMin;
+
+        // Bounding box of the world daughters that hold the volume, corners transformed
+        const G4LogicalVolume* worldVolume = world->GetLogicalVolume();
+        for (std::size_t i = 0; i < worldVolume->GetNoDaughters(); i++) {
+            const G4VPhysicalVolume* daughter = worldVolume->GetDaughter(i);
+            if (!Contains(daughter->GetLogicalVolume(), fVolumeName)) continue;
+
+            G4ThreeVector pmin, pmax;
+            daughter->GetLogicalVolume()->GetSolid()->BoundingLimits(pmin, pmax);
+            G4RotationMatrix rotation = daughter->GetObjectRotationValue();
+            G4ThreeVector translation = daughter->GetObjectTranslation();
+            for (G4int corner = 0; corner < 8; corner++) {
+                G4ThreeVector local((corner & 1) ? pmax.x() : pmin.x(),
+                    (corner & 2) ? pmax.y() : pmin.y(),
+                    (corner & 4) ? pmax.z() : pmin.z());
+                G4ThreeVector global = rotation * local + translation;
+                fMin.set(std::min(fMin.x(), global.x()), std::min(fMin.y(), global.y()),
+                    std::min(fMin.z(), global.z()));
+                fMax.set(std::max(fMax.x(), global.x()), std::max(fMax.y(), global.y()),
+                    std::max(fMax.z(), global.z()));
+            }
+        }
+        if (fMin.x() > fMax.x()) {
+            G4ExceptionDescription msg;
+            msg << "No placement of volume " << fVolumeName << " found in the world";
+            G4Exception("TileSampler::Initialize()", "TileSampler_F001", FatalException, msg);
+            return false;
+        }
+
+        fNavigator = std::make_unique<G4Navigator>();
+        fNavigator->SetWorldVolume(world);
+        fInitialized = true;
+        return true;
+    }
+
+    G4bool TileSampler::Sample(G4double u0, G4double u1, G4double u2, G4ThreeVector& position)
+    {
+        if ((!fInitialized || fGeneration != fGeometryGeneration) && !Initialize()) return false;
+
+        position.set(fMin.x() + u0 * (fMax.x() - fMin.x()),
+            fMin.y() + u1 * (fMax.y() - fMin.y()),
+            fMin.z() + u2 * (fMax.z() - fMin.z()));
+        fTried++;
+
+        G4VPhysicalVolume* volume = fNavigator->LocateGlobalPointAndSetup(position, nullptr, false, true);
+        if (!volume || volume->GetLogicalVolume()->GetName() != fVolumeName) return false;
+        fAccepted++;
+        return true;
+    }
+
+    G4ThreeVector TileSampler::Sample()
+    {
+        G4ThreeVector position;
+        // Acceptance is well above 90% for the tile stack; the limit only guards broken geometry
+        for (G4int attempt = 0; attempt < 100000; attempt++) {
+            if (Sample(G4UniformRand(), G4UniformRand(), G4UniformRand(), position)) return position;
+            if (!fInitialized) break;
+        }
+        G4Exception("TileSampler::Sample()", "TileSampler_W001", JustWarning,
+            "No point found inside the sampled volume");
+        return position;
+    }
+
+    G4bool TileSampler::GetBounds(G4ThreeVector& min, G4ThreeVector& max)
+    {
+        if ((!fInitialized || fGeneration != fGeometryGeneration) && !Initialize()) return false;
+        min = fMin;
+        max = fMax;
+        return true;
+    }
+
+    G4double TileSampler::GetAcceptance() const
+    {
+        return (fTried > 0) ? static_cast<G4double>(fAccepted) / fTried : 0.;
+    }
+}
@@ -0,0 +1,54 @@
+
+#ifndef G4_BREMS_TILE_SAMPLER_H
+#define G4_BREMS_TILE_SAMPLER_H 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <atomic>
+#include <memory>
+
+class G4Navigator;
+class G4LogicalVolume;
+
+namespace G4_BREMS {
+
+    // Uniform points inside every placement of a logical volume (the scintillator tiles by
+    // default). Candidates are drawn in the bounding box of the top-level volumes that contain
+    // it and accepted when the thread's own navigator locates them in that volume, so replicas
+    // and boolean solids need no special treatment. The tile stack fills most of its box.
+    class TileSampler
+    {
+    public:
+        explicit TileSampler(const G4String& volumeName = "Tile");
+        ~TileSampler();
+
+        // One candidate from three uniforms in [0,1); false when it missed the volume
+        G4bool Sample(G4double u0, G4double u1, G4double u2, G4ThreeVector& position);
+        // Rejection loop on the engine of the current thread
+        G4ThreeVector Sample();
+
+        G4double GetAcceptance() const;
+
+        // Bounding box the candidates are drawn in; false before the geometry exists
+        G4bool GetBounds(G4ThreeVector& min, G4ThreeVector& max);
+
+        // Called after placements moved; every sampler recomputes its box before the next draw
+        static void GeometryChanged() { fGeometryGeneration++; }
+
+    private:
+        G4bool Initialize();
+
+        G4String fVolumeName;
+        std::unique_ptr<G4Navigator> fNavigator;
+        G4ThreeVector fMin;
+        G4ThreeVector fMax;
+        G4bool fInitialized;
+        G4int fGeneration;
+        G4long fTried;
+        G4long fAccepted;
+
+        static std::atomic<G4int> fGeometryGeneration;
+    };
+}
+
+#endif
@@ -0,0 +1,165 @@
+
+#include "TileScorer.hh"
+#include "G4AccumulableManager.hh"
+#include "G4AutoLock.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VTouchable.hh"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace G4_BREMS {
+
+    std::vector<TileScorer::Record> TileScorer::fShared;
+
+    namespace {
+        G4Mutex tileScorerMutex = G4MUTEX_INITIALIZER;
+
+        const char kTileMagic[8] = { 'S', 'N', 'F', 'T', 'I', 'L', 'E', '1' };
+
+        template <typename T>
+        void WriteValue(std::ofstream& out, const T& value) {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    TileScorer::TileScorer()
+        : fTileVolume(nullptr), fTouched(0),
+        fRunEdepCharged("TileEdepCharged", TileCell::kCells), fRunEdepGamma("TileEdepGamma", TileCell::kCells)
+    {
+        fEdepCharged.fill(0.);
+        fEdepGamma.fill(0.);
+        fEdepTime.fill(0.);
+        fFirstTime.fill(std::numeric_limits<G4double>::max());
+
+        auto accumulableManager = G4AccumulableManager::Instance();
+        accumulableManager->RegisterAccumulable(&fRunEdepCharged);
+        accumulableManager->RegisterAccumulable(&fRunEdepGamma);
+    }
+
+    void TileScorer::ResetShared()
+    {
+        G4AutoLock lock(&tileScorerMutex);
+        fShared.clear();
+    }
+
+    void TileScorer::BeginOfRun()
+    {
+        // The geometry may have been rebuilt or imported since the last run
+        fTileVolume = G4LogicalVolumeStore::GetInstance()->GetVolume("Tile", false);
+        fRecords.clear();
+        BeginOfEvent();
+    }
+
+    void TileScorer::BeginOfEvent()
+    {
+        for (G4int cell = 0; cell < TileCell::kCells && fTouched >> cell != 0; cell++) {
+            if (!(fTouched >> cell & 1u)) continue;
+            fEdepCharged[cell] = 0.;
+            fEdepGamma[cell] = 0.;
+            fEdepTime[cell] = 0.;
+            fFirstTime[cell] = std::numeric_limits<G4double>::max();
+        }
+        fTouched = 0;
+    }
+
+    void TileScorer::Score(const G4Step* step)
+    {
+        G4double edep = step->GetTotalEnergyDeposit();
+        if (edep <= 0.) return;
+
+        const G4ParticleDefinition* particle = step->GetTrack()->GetDefinition();
+        G4bool charged = particle->GetPDGCharge() != 0.;
+        if (!charged && particle != G4Gamma::Definition()) return;
+
+        const G4StepPoint* preStepPoint = step->GetPreStepPoint();
+        const G4VTouchable* touchable = preStepPoint->GetTouchable();
+        if (touchable->GetVolume()->GetLogicalVolume() != fTileVolume) return;
+
+        G4int layer = touchable->GetCopyNumber(2);
+        G4int row = touchable->GetCopyNumber(1);
+        G4int tile = touchable->GetCopyNumber(0);
+        if (layer < 0 || layer >= TileCell::kLayers || row < 0 || row >= TileCell::kRows
+            || tile < 0 || tile >= TileCell::kTiles) return;
+        G4int cell = TileCell::Id(layer, row, tile);
+
+        G4double time = 0.5 * (preStepPoint->GetGlobalTime() + step->GetPostStepPoint()->GetGlobalTime());
+        if (charged) fEdepCharged[cell] += edep;
+        else fEdepGamma[cell] += edep;
+        fEdepTime[cell] += edep * time;
+        fFirstTime[cell] = std::min(fFirstTime[cell], preStepPoint->GetGlobalTime());
+        fTouched |= 1u << cell;
+    }
+
+    void TileScorer::EndOfEvent(G4int eventID)
+    {
+        for (G4int cell = 0; cell < TileCell::kCells && fTouched >> cell != 0; cell++) {
+            if (!(fTouched >> cell & 1u)) continue;
+            G4double edep = fEdepCharged[cell] + fEdepGamma[cell];
+            fRecords.push_back({ static_cast<std::uint32_t>(eventID), static_cast<std::uint32_t>(cell),
+                static_cast<float>(fEdepCharged[cell] / MeV), static_cast<float>(fEdepGamma[cell] / MeV),
+                static_cast<float>(fFirstTime[cell] / ns), static_cast<float>(fEdepTime[cell] / edep / ns) });
+            fRunEdepCharged[cell] += fEdepCharged[cell];
+            fRunEdepGamma[cell] += fEdepGamma[cell];
+        }
+    }
+
+    void TileScorer::Flush()
+    {
+        if (fRecords.empty()) return;
+        G4AutoLock lock(&tileScorerMutex);
+        fShared.insert(fShared.end(), fRecords.begin(), fRecords.end());
+        fRecords.clear();
+    }
+
+    G4bool TileScorer::Write(const G4String& path)
+    {
+        // Same file whatever the number of threads
+        std::sort(fShared.begin(), fShared.end(), [](const Record& a, const Record& b) {
+            return a.event != b.event ? a.event < b.event : a.cell < b.cell;
+        });
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            G4cerr << "Error: Could not open " << path << " for writing" << G4endl;
+            return false;
+        }
+
+        out.write(kTileMagic, sizeof(kTileMagic));
+        WriteValue(out, static_cast<std::uint32_t>(TileCell::kLayers));
+        WriteValue(out, static_cast<std::uint32_t>(TileCell::kRows));
+        WriteValue(out, static_cast<std::uint32_t>(TileCell::kTiles));
+        WriteValue(out, static_cast<std::uint64_t>(fShared.size()));
+        for (const auto& record : fShared) {
+            WriteValue(out, record.event);
+            WriteValue(out, record.cell);
+            WriteValue(out, record.edepCharged);
+            WriteValue(out, record.edepGamma);
+            WriteValue(out, record.firstTime);
+            WriteValue(out, record.meanTime);
+        }
+        G4cout << "Wrote " << fShared.size() << " tile deposits to " << path << G4endl;
+        return static_cast<G4bool>(out);
+    }
+
+    void TileScorer::PrintSummary() const
+    {
+        std::array<G4double, TileCell::kLayers> charged{};
+        std::array<G4double, TileCell::kLayers> gamma{};
+        for (G4int cell = 0; cell < TileCell::kCells; cell++) {
+            charged[TileCell::Layer(cell)] += fRunEdepCharged[cell];
+            gamma[TileCell::Layer(cell)] += fRunEdepGamma[cell];
+        }
+
+        G4cout << "\nTile energy deposit per layer (charged / gamma, MeV):" << G4endl;
+        for (G4int layer = 0; layer < TileCell::kLayers; layer++) {
+            G4cout << "  Layer " << layer << ": " << charged[layer] / MeV << " / " << gamma[layer] / MeV << G4endl;
+        }
+    }
+}
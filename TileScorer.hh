@@ -0,0 +1,87 @@
+
+#ifndef G4_BREMS_TILE_SCORER_H
+#define G4_BREMS_TILE_SCORER_H 1
+
+#include "ArrayAccumulable.hh"
+#include "globals.hh"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class G4Step;
+class G4LogicalVolume;
+
+namespace G4_BREMS {
+
+    // Scintillator tile numbering from the touchable of a Tile step: layer is the copy number
+    // of the layer placement (as in SipmChannel), row and tile the Row_Replica and Tile_Replica
+    // numbers, counted in the frame of the layer (top layers are rotated by 90 deg).
+    //   cell = (layer * kRows + row) * kTiles + tile
+    namespace TileCell {
+        constexpr G4int kLayers = 8;
+        constexpr G4int kRows = 2;
+        constexpr G4int kTiles = 2;
+        constexpr G4int kCells = kLayers * kRows * kTiles;
+
+        constexpr G4int Id(G4int layer, G4int row, G4int tile) { return (layer * kRows + row) * kTiles + tile; }
+        constexpr G4int Layer(G4int cell) { return cell / (kRows * kTiles); }
+    }
+
+    // Energy deposited in the tiles by charged particles and by gammas (optical photons are not
+    // scored), with first and energy-weighted mean time per tile. Per-thread, owned by
+    // RunAction; the per-event sums live in dense arrays and only touched tiles are recorded.
+    //
+    // File layout (little endian), records sorted by event and cell:
+    //   char[8] "SNFTILE1", uint32 layers, rows, tiles, uint64 records,
+    //   per record: uint32 event, uint32 cell, float edepCharged[MeV], float edepGamma[MeV],
+    //               float firstTime[ns], float meanTime[ns]
+    class TileScorer
+    {
+    public:
+        TileScorer();
+        ~TileScorer() = default;
+
+        // Master clears the records of the previous run before the workers start
+        static void ResetShared();
+
+        void BeginOfRun();
+        void BeginOfEvent();
+        void Score(const G4Step* step);
+        void EndOfEvent(G4int eventID);
+        // Hands this thread's records to the master; called by every thread at end of run
+        void Flush();
+
+        // Master only, after the accumulables are merged
+        static G4bool Write(const G4String& path);
+        void PrintSummary() const;
+
+    private:
+        struct Record {
+            std::uint32_t event;
+            std::uint32_t cell;
+            float edepCharged;
+            float edepGamma;
+            float firstTime;
+            float meanTime;
+        };
+
+        static std::vector<Record> fShared;
+
+        const G4LogicalVolume* fTileVolume;
+
+        // Current event, indexed by cell; fTouched has one bit per cell
+        std::array<G4double, TileCell::kCells> fEdepCharged;
+        std::array<G4double, TileCell::kCells> fEdepGamma;
+        std::array<G4double, TileCell::kCells> fEdepTime;   // sum of edep * time
+        std::array<G4double, TileCell::kCells> fFirstTime;
+        std::uint32_t fTouched;
+        static_assert(TileCell::kCells <= 32, "fTouched holds one bit per cell");
+
+        std::vector<Record> fRecords;
+
+        ArrayAccumulable<G4double> fRunEdepCharged;   // [cell]
+        ArrayAccumulable<G4double> fRunEdepGamma;     // [cell]
+    };
+}
+
+#endif
@@ -0,0 +1,44 @@
+
+#include "TrackingAction.hh"
+#include "SteppingAction.hh"
+#include "G4Track.hh"
+#include "G4TrackVector.hh"
+#include "G4TrackingManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VProcess.hh"
+
+namespace G4_BREMS {
+
+    void PhotonTrackInfo::Print() const
+    {
+        G4cout << "PhotonTrackInfo: history " << provenance.history << ", " << provenance.WlsConversions()
+            << " WLS conversions" << G4endl;
+    }
+
+    void TrackingAction::PreUserTrackingAction(const G4Track* track)
+    {
+        fSteppingAction->BeginTrack(track);
+    }
+
+    void TrackingAction::PostUserTrackingAction(const G4Track* track)
+    {
+        fSteppingAction->EndTrack();
+        if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return;
+
+        G4TrackVector* secondaries = fpTrackingManager->GimmeSecondaries();
+        if (!secondaries || secondaries->empty()) return;
+
+        // The photons re-emitted where this one was absorbed by WLS continue its provenance
+        PhotonProvenance child = fSteppingAction->GetProvenance();
+        const G4VPhysicalVolume* volume = track->GetVolume();
+        child.AddWlsConversion(volume ? StepCode::Volume(volume->GetLogicalVolume()->GetName()) : PhotonProvenance::kNoVolume);
+        for (G4Track* secondary : *secondaries) {
+            const G4VProcess* creator = secondary->GetCreatorProcess();
+            if (creator && creator->GetProcessName() == "OpWLS" && !secondary->GetUserInformation()) {
+                secondary->SetUserInformation(new PhotonTrackInfo(child));
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+
+#ifndef G4_BREMS_TRACKING_ACTION_H
+#define G4_BREMS_TRACKING_ACTION_H 1
+
+#include "G4UserTrackingAction.hh"
+#include "G4VUserTrackInformation.hh"
+#include "PhotonProvenance.hh"
+#include "globals.hh"
+
+namespace G4_BREMS {
+
+    class SteppingAction;
+
+    // Provenance a WLS photon inherits from the photon it was re-emitted from
+    class PhotonTrackInfo : public G4VUserTrackInformation
+    {
+    public:
+        PhotonTrackInfo(const PhotonProvenance& parent) : provenance(parent) {}
+        ~PhotonTrackInfo() override = default;
+
+        void Print() const override;
+
+        PhotonProvenance provenance;
+    };
+
+    // Brackets every track for the stepping action, which keeps a summary and the provenance of
+    // the current photon, and passes the provenance on to the photons of a WLS conversion
+    class TrackingAction : public G4UserTrackingAction
+    {
+    public:
+        TrackingAction(SteppingAction* steppingAction) : fSteppingAction(steppingAction) {}
+        ~TrackingAction() override = default;
+
+        void PreUserTrackingAction(const G4Track* track) override;
+        void PostUserTrackingAction(const G4Track* track) override;
+
+    private:
+        SteppingAction* fSteppingAction;
+    };
+}
+
+#endif
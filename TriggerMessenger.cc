@@ -0,0 +1,111 @@
+
+#include "TriggerMessenger.hh"
+#include "CoincidenceTrigger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4SystemOfUnits.hh"
+#include <sstream>
+
+namespace G4_BREMS {
+
+    TriggerMessenger::TriggerMessenger()
+        : G4UImessenger()
+    {
+        fTriggerDirectory = new G4UIdirectory("/snf/trigger/", false);
+        fTriggerDirectory->SetGuidance("Layer coincidence trigger; failing events and channels are dropped before any output.");
+
+        fEnableCmd = new G4UIcmdWithABool("/snf/trigger/enable", this);
+        fEnableCmd->SetGuidance("Apply the trigger at end of every event (not in sub-event mode).");
+        fEnableCmd->SetParameterName("enable", true);
+        fEnableCmd->SetDefaultValue(true);
+
+        fLayersCmd = new G4UIcmdWithAnInteger("/snf/trigger/layers", this);
+        fLayersCmd->SetGuidance("Layers with a fired channel required within the window (default 2).");
+        fLayersCmd->SetParameterName("layers", false);
+        fLayersCmd->SetRange("layers >= 1 && layers <= 8");
+
+        fTopLayersCmd = new G4UIcmdWithAnInteger("/snf/trigger/topLayers", this);
+        fTopLayersCmd->SetGuidance("Of which at least this many top layers, fibers along x (default 0).");
+        fTopLayersCmd->SetParameterName("layers", false);
+        fTopLayersCmd->SetRange("layers >= 0 && layers <= 4");
+
+        fBottomLayersCmd = new G4UIcmdWithAnInteger("/snf/trigger/bottomLayers", this);
+        fBottomLayersCmd->SetGuidance("Of which at least this many bottom layers, fibers along y (default 0).");
+        fBottomLayersCmd->SetParameterName("layers", false);
+        fBottomLayersCmd->SetRange("layers >= 0 && layers <= 4");
+
+        fWindowCmd = new G4UIcmdWithADoubleAndUnit("/snf/trigger/window", this);
+        fWindowCmd->SetGuidance("Coincidence window, for the photoelectrons of a channel and between layers (default 20 ns).");
+        fWindowCmd->SetParameterName("window", false);
+        fWindowCmd->SetRange("window > 0");
+        fWindowCmd->SetUnitCategory("Time");
+        fWindowCmd->SetDefaultUnit("ns");
+
+        fThresholdCmd = new G4UIcommand("/snf/trigger/threshold", this);
+        fThresholdCmd->SetGuidance("Photoelectrons within the window for a channel to fire (default 1); 0 masks the channel.");
+        fThresholdCmd->SetGuidance("Without a channel the threshold applies to all of them.");
+        auto threshold = new G4UIparameter("photoelectrons", 'i', false);
+        threshold->SetParameterRange("photoelectrons >= 0");
+        fThresholdCmd->SetParameter(threshold);
+        auto channel = new G4UIparameter("channel", 'i', true);
+        channel->SetDefaultValue(-1);
+        channel->SetParameterRange("channel >= -1 && channel < 128");
+        fThresholdCmd->SetParameter(channel);
+
+        for (G4UIcommand* command : std::initializer_list<G4UIcommand*>{ fEnableCmd, fLayersCmd, fTopLayersCmd,
+            fBottomLayersCmd, fWindowCmd, fThresholdCmd }) {
+            command->AvailableForStates(G4State_PreInit, G4State_Idle);
+            command->SetToBeBroadcasted(false);
+        }
+    }
+
+    TriggerMessenger::~TriggerMessenger()
+    {
+        delete fEnableCmd;
+        delete fLayersCmd;
+        delete fTopLayersCmd;
+        delete fBottomLayersCmd;
+        delete fWindowCmd;
+        delete fThresholdCmd;
+        delete fTriggerDirectory;
+    }
+
+    void TriggerMessenger::SetNewValue(G4UIcommand* command, G4String newValue)
+    {
+        TriggerParameters& parameters = CoincidenceTrigger::Parameters();
+        if (command == fEnableCmd) {
+            parameters.enabled = fEnableCmd->GetNewBoolValue(newValue);
+        }
+        else if (command == fLayersCmd) {
+            parameters.layers = fLayersCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fTopLayersCmd) {
+            parameters.topLayers = fTopLayersCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fBottomLayersCmd) {
+            parameters.bottomLayers = fBottomLayersCmd->GetNewIntValue(newValue);
+        }
+        else if (command == fWindowCmd) {
+            parameters.window = fWindowCmd->GetNewDoubleValue(newValue) / ns;
+        }
+        else if (command == fThresholdCmd) {
+            std::istringstream is(newValue);
+            G4int photoelectrons = 1, channel = -1;
+            is >> photoelectrons >> channel;
+            if (channel < 0) parameters.thresholds.fill(photoelectrons);
+            else parameters.thresholds[channel] = photoelectrons;
+        }
+
+        if (parameters.topLayers + parameters.bottomLayers > parameters.layers) {
+            G4ExceptionDescription msg;
+            msg << "topLayers + bottomLayers (" << parameters.topLayers + parameters.bottomLayers
+                << ") exceeds layers (" << parameters.layers << "); effectively " << parameters.topLayers + parameters.bottomLayers
+                << " layers are required.";
+            G4Exception("TriggerMessenger::SetNewValue", "Trigger_W001", JustWarning, msg);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+
+#ifndef G4_BREMS_TRIGGER_MESSENGER_H
+#define G4_BREMS_TRIGGER_MESSENGER_H 1
+
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADoubleAndUnit;
+
+namespace G4_BREMS {
+
+    // /snf/trigger/: coincidence trigger and zero suppression (master only, see CoincidenceTrigger)
+    class TriggerMessenger : public G4UImessenger
+    {
+    public:
+        TriggerMessenger();
+        ~TriggerMessenger() override;
+
+        void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+    private:
+        G4UIdirectory* fTriggerDirectory;
+        G4UIcmdWithABool* fEnableCmd;
+        G4UIcmdWithAnInteger* fLayersCmd;
+        G4UIcmdWithAnInteger* fTopLayersCmd;
+        G4UIcmdWithAnInteger* fBottomLayersCmd;
+        G4UIcmdWithADoubleAndUnit* fWindowCmd;
+        G4UIcommand* fThresholdCmd;
+    };
+}
+
+#endif
@@ -0,0 +1,215 @@
+
+#include "VertexFit.hh"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace G4_BREMS {
+
+    namespace {
+        constexpr std::size_t kLanes = VertexFitter::kBatch;
+        constexpr G4int kChannelsPerLayer = SipmChannel::kGrooves * SipmChannel::kEnds;
+        constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+        // Light reaching a groove whatever the distance, relative to the groove at the vertex
+        constexpr G4double kShareFloor = 1.e-3;
+    }
+
+    void VertexResults::Resize(std::size_t events)
+    {
+        x.resize(events);
+        y.resize(events);
+        z.resize(events);
+        energy.resize(events);
+        time.resize(events);
+        vertexFraction.resize(events);
+        gammaClusters.resize(events);
+    }
+
+    void VertexFitter::Configure(const VertexGeometry& geometry, const VertexSettings& settings)
+    {
+        fSettings = settings;
+
+        G4double reach = 0.;
+        for (G4int layer = 0; layer < SipmChannel::kLayers; layer++) {
+            G4double z = 0.;
+            for (G4int channel = layer * kChannelsPerLayer; channel < (layer + 1) * kChannelsPerLayer; channel++) {
+                z += geometry.z[channel];
+                reach = std::max(reach, std::abs(static_cast<G4double>(geometry.coordinate[channel])));
+            }
+            fLayerZ[layer] = static_cast<float>(z / kChannelsPerLayer);
+        }
+
+        // The grid reaches a quarter beyond the outer grooves, towards the edge of the tiles
+        for (std::size_t g = 0; g < kGrid; g++) {
+            fGrid[g] = static_cast<float>(1.25 * reach * (2. * g / (kGrid - 1) - 1.));
+        }
+
+        fLogShare.assign(SipmChannel::kLayers * kGrid * SipmChannel::kGrooves, 0.f);
+        const G4double length = std::max(settings.shareLength, 1.e-3);
+        for (G4int layer = 0; layer < SipmChannel::kLayers; layer++) {
+            for (std::size_t g = 0; g < kGrid; g++) {
+                std::array<G4double, SipmChannel::kGrooves> share;
+                G4double sum = 0.;
+                for (G4int groove = 0; groove < SipmChannel::kGrooves; groove++) {
+                    G4double u = geometry.coordinate[SipmChannel::Id(layer, groove, 0)];
+                    share[groove] = std::exp(-std::abs(fGrid[g] - u) / length) + kShareFloor;
+                    sum += share[groove];
+                }
+                for (G4int groove = 0; groove < SipmChannel::kGrooves; groove++) {
+                    fLogShare[(layer * kGrid + g) * SipmChannel::kGrooves + groove] = static_cast<float>(std::log(share[groove] / sum));
+                }
+            }
+        }
+
+        fCharge.assign(SipmChannel::kChannels * kLanes, 0.f);
+        fTime.assign(SipmChannel::kChannels * kLanes, 0.f);
+        fLayerCharge.assign(SipmChannel::kLayers * kLanes, 0.f);
+        fWeight.assign(SipmChannel::kLayers * kLanes, 0.f);
+        fLikelihood.assign(kGrid * kLanes, 0.f);
+    }
+
+    void VertexFitter::Fit(const float* charge, const float* time, std::size_t events, VertexResults& results)
+    {
+        results.Resize(events);
+        if (fLogShare.empty()) return;
+
+        for (std::size_t first = 0; first < events; first += kLanes) {
+            const std::size_t lanes = std::min(kLanes, events - first);
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                const G4bool used = lane < lanes;
+                const float* q = charge + (first + lane) * SipmChannel::kChannels;
+                const float* t = time + (first + lane) * SipmChannel::kChannels;
+                for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+                    fCharge[channel * kLanes + lane] = used ? q[channel] : 0.f;
+                    fTime[channel * kLanes + lane] = used ? t[channel] : 0.f;
+                }
+            }
+            FitBatch(first, lanes, results);
+        }
+    }
+
+    void VertexFitter::FitBatch(std::size_t first, std::size_t lanes, VertexResults& results)
+    {
+        // Charge per layer, total, and the brightest layer
+        float total[kLanes] = {};
+        for (G4int layer = 0; layer < SipmChannel::kLayers; layer++) {
+            float* layerCharge = &fLayerCharge[layer * kLanes];
+            std::fill(layerCharge, layerCharge + kLanes, 0.f);
+            for (G4int channel = layer * kChannelsPerLayer; channel < (layer + 1) * kChannelsPerLayer; channel++) {
+                const float* q = &fCharge[channel * kLanes];
+                for (std::size_t lane = 0; lane < kLanes; lane++) layerCharge[lane] += q[lane];
+            }
+            for (std::size_t lane = 0; lane < kLanes; lane++) total[lane] += layerCharge[lane];
+        }
+
+        float brightest[kLanes], vertexLayer[kLanes];
+        std::copy(&fLayerCharge[0], &fLayerCharge[kLanes], brightest);
+        std::fill(vertexLayer, vertexLayer + kLanes, 0.f);
+        for (G4int layer = 1; layer < SipmChannel::kLayers; layer++) {
+            const float* layerCharge = &fLayerCharge[layer * kLanes];
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                const G4bool brighter = layerCharge[lane] > brightest[lane];
+                brightest[lane] = brighter ? layerCharge[lane] : brightest[lane];
+                vertexLayer[lane] = brighter ? static_cast<float>(layer) : vertexLayer[lane];
+            }
+        }
+
+        // Vertex layers: the brightest and its neighbours
+        float vertexCharge[kLanes] = {}, zSum[kLanes] = {};
+        for (G4int layer = 0; layer < SipmChannel::kLayers; layer++) {
+            const float* layerCharge = &fLayerCharge[layer * kLanes];
+            float* weight = &fWeight[layer * kLanes];
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                weight[lane] = std::abs(static_cast<float>(layer) - vertexLayer[lane]) < 1.5f ? 1.f : 0.f;
+                vertexCharge[lane] += weight[lane] * layerCharge[lane];
+                zSum[lane] += weight[lane] * layerCharge[lane] * fLayerZ[layer];
+            }
+        }
+
+        // Grid likelihood of the groove charges, bottom layers for x, top layers for y
+        float coordinate[2][kLanes];
+        for (G4int top = 0; top < 2; top++) {
+            std::fill(fLikelihood.begin(), fLikelihood.end(), 0.f);
+            float measured[kLanes] = {};
+            for (G4int layer = top; layer < SipmChannel::kLayers; layer += 2) {
+                const float* weight = &fWeight[layer * kLanes];
+                for (G4int groove = 0; groove < SipmChannel::kGrooves; groove++) {
+                    const float* q0 = &fCharge[SipmChannel::Id(layer, groove, 0) * kLanes];
+                    const float* q1 = &fCharge[SipmChannel::Id(layer, groove, 1) * kLanes];
+                    float grooveCharge[kLanes];
+                    for (std::size_t lane = 0; lane < kLanes; lane++) {
+                        grooveCharge[lane] = weight[lane] * (q0[lane] + q1[lane]);
+                        measured[lane] += grooveCharge[lane];
+                    }
+                    const float* logShare = &fLogShare[layer * kGrid * SipmChannel::kGrooves + groove];
+                    for (std::size_t g = 0; g < kGrid; g++) {
+                        const float share = logShare[g * SipmChannel::kGrooves];
+                        float* likelihood = &fLikelihood[g * kLanes];
+                        for (std::size_t lane = 0; lane < kLanes; lane++) likelihood[lane] += grooveCharge[lane] * share;
+                    }
+                }
+            }
+
+            float best[kLanes], bestIndex[kLanes];
+            std::copy(&fLikelihood[0], &fLikelihood[kLanes], best);
+            std::fill(bestIndex, bestIndex + kLanes, 0.f);
+            for (std::size_t g = 1; g < kGrid; g++) {
+                const float* likelihood = &fLikelihood[g * kLanes];
+                for (std::size_t lane = 0; lane < kLanes; lane++) {
+                    const G4bool better = likelihood[lane] > best[lane];
+                    best[lane] = better ? likelihood[lane] : best[lane];
+                    bestIndex[lane] = better ? static_cast<float>(g) : bestIndex[lane];
+                }
+            }
+
+            const float step = fGrid[1] - fGrid[0];
+            for (std::size_t lane = 0; lane < lanes; lane++) {
+                const std::size_t g = static_cast<std::size_t>(bestIndex[lane]);
+                float offset = 0.f;
+                if (g > 0 && g + 1 < kGrid) {
+                    const float below = fLikelihood[(g - 1) * kLanes + lane];
+                    const float above = fLikelihood[(g + 1) * kLanes + lane];
+                    const float curvature = below - 2.f * best[lane] + above;
+                    if (curvature < 0.f) offset = 0.5f * (below - above) / curvature;
+                }
+                coordinate[top][lane] = measured[lane] > 0.f ? fGrid[g] + offset * step : kNaN;
+            }
+        }
+
+        // Earliest lit channel
+        float earliest[kLanes];
+        std::fill(earliest, earliest + kLanes, std::numeric_limits<float>::infinity());
+        for (G4int channel = 0; channel < SipmChannel::kChannels; channel++) {
+            const float* q = &fCharge[channel * kLanes];
+            const float* t = &fTime[channel * kLanes];
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                earliest[lane] = ((q[lane] > 0.f) & (t[lane] < earliest[lane])) ? t[lane] : earliest[lane];
+            }
+        }
+
+        // Lit layers outside the vertex, adjacent ones counted once
+        float clusters[kLanes] = {}, previous[kLanes] = {};
+        const float threshold = static_cast<float>(fSettings.clusterThreshold);
+        for (G4int layer = 0; layer < SipmChannel::kLayers; layer++) {
+            const float* layerCharge = &fLayerCharge[layer * kLanes];
+            const float* weight = &fWeight[layer * kLanes];
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                const float lit = ((layerCharge[lane] > threshold) & (weight[lane] == 0.f)) ? 1.f : 0.f;
+                clusters[lane] += lit * (1.f - previous[lane]);
+                previous[lane] = lit;
+            }
+        }
+
+        const float lightYield = static_cast<float>(fSettings.lightYield);
+        for (std::size_t lane = 0; lane < lanes; lane++) {
+            const std::size_t event = first + lane;
+            results.x[event] = coordinate[0][lane];
+            results.y[event] = coordinate[1][lane];
+            results.z[event] = vertexCharge[lane] > 0.f ? zSum[lane] / vertexCharge[lane] : kNaN;
+            results.energy[event] = total[lane] / lightYield;
+            results.time[event] = std::isinf(earliest[lane]) ? kNaN : earliest[lane];
+            results.vertexFraction[event] = total[lane] > 0.f ? vertexCharge[lane] / total[lane] : 0.f;
+            results.gammaClusters[event] = clusters[lane];
+        }
+    }
+}
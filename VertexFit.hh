@@ -0,0 +1,80 @@
+
+#ifndef G4_BREMS_VERTEX_FIT_H
+#define G4_BREMS_VERTEX_FIT_H 1
+
+#include "SipmChannel.hh"
+#include "globals.hh"
+#include <array>
+#include <vector>
+
+namespace G4_BREMS {
+
+    // Readout geometry seen by the fit, per channel: the transverse coordinate the fiber
+    // measures (x for bottom layers, y for top layers) and its z, both in mm
+    struct VertexGeometry {
+        std::array<float, SipmChannel::kChannels> coordinate{};
+        std::array<float, SipmChannel::kChannels> z{};
+    };
+
+    struct VertexSettings {
+        G4double lightYield = 100.;      // photoelectrons per MeV deposited
+        G4double shareLength = 40.;      // mm, decay length of the light shared with further grooves
+        G4double clusterThreshold = 3.;  // photoelectrons for a layer outside the vertex to count
+    };
+
+    // Reconstructed events, one array per quantity. Coordinates are NaN when no light reached
+    // the fibers measuring them, time is NaN without any light.
+    struct VertexResults {
+        std::vector<float> x;                // mm, likelihood fit
+        std::vector<float> y;                // mm
+        std::vector<float> z;                // mm, charge-weighted over the vertex layers
+        std::vector<float> energy;           // MeV, all layers
+        std::vector<float> time;             // ns, earliest channel
+        std::vector<float> vertexFraction;   // of the charge in the vertex layers
+        std::vector<float> gammaClusters;    // separate groups of lit layers outside the vertex
+
+        void Resize(std::size_t events);
+        std::size_t size() const { return x.size(); }
+    };
+
+    // Vertex, energy and annihilation-topology fit of SiPM charge patterns. Events are fitted
+    // kBatch at a time, transposed to [channel][event] so that every step is the same
+    // arithmetic on all events of the batch: compilers vectorize these loops across the events
+    // without reassociating any sum, so results do not depend on the batch an event falls in.
+    //
+    // The vertex layers are the brightest layer and its neighbours, so both orientations are
+    // always among them. z is their charge-weighted mean. x and y maximise the multinomial
+    // likelihood of the groove charges of those layers over a grid of kGrid positions, with a
+    // light share per groove ~ exp(-|u - u_groove| / shareLength), refined by a parabola
+    // through the best grid point and its neighbours. Lit layers outside the vertex layers,
+    // grouped when adjacent, estimate how many annihilation gammas converted in the stack.
+    class VertexFitter
+    {
+    public:
+        static constexpr std::size_t kBatch = 16;
+        static constexpr std::size_t kGrid = 64;
+
+        void Configure(const VertexGeometry& geometry, const VertexSettings& settings);
+
+        // charge and time are [event][channel], in photoelectrons and ns
+        void Fit(const float* charge, const float* time, std::size_t events, VertexResults& results);
+
+    private:
+        void FitBatch(std::size_t first, std::size_t lanes, VertexResults& results);
+
+        VertexSettings fSettings;
+        std::array<float, SipmChannel::kLayers> fLayerZ{};
+        std::array<float, kGrid> fGrid{};
+        // ln of the light share, [layer][grid][groove]
+        std::vector<float> fLogShare;
+
+        // Current batch, [channel][lane] and [layer][lane]
+        std::vector<float> fCharge;
+        std::vector<float> fTime;
+        std::vector<float> fLayerCharge;
+        std::vector<float> fWeight;
+        std::vector<float> fLikelihood;      // [grid][lane]
+    };
+}
+
+#endif
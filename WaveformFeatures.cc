@@ -0,0 +1,82 @@
+
+#include "WaveformFeatures.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+namespace G4_BREMS {
+
+    void ChannelFeatures::Resize(std::size_t channels)
+    {
+        baseline.resize(channels);
+        time.resize(channels);
+        charge.resize(channels);
+        peak.resize(channels);
+        timeOverThreshold.resize(channels);
+    }
+
+    FeatureExtractor::Sums FeatureExtractor::Accumulate(const std::uint16_t* trace, std::size_t begin,
+        std::size_t end, std::uint32_t threshold)
+    {
+        // Integer reductions only: no reassociation or trapping-math flags are needed for the
+        // compiler to vectorize them, and the result does not depend on the vector width. The
+        // maximum is taken on sign-flipped 16-bit values, which SSE2 and NEON have an instruction
+        // for, and the index of the peak looked up afterwards.
+        std::uint32_t sum = 0;
+        std::int32_t above = 0;
+        std::int16_t flipped = INT16_MIN;
+        const std::int32_t limit = static_cast<std::int32_t>(threshold);
+        for (std::size_t s = begin; s < end; s++) {
+            const std::int32_t value = trace[s];
+            sum += static_cast<std::uint32_t>(value);
+            above += static_cast<std::int32_t>(value > limit);
+            flipped = std::max(flipped, static_cast<std::int16_t>(trace[s] ^ 0x8000u));
+        }
+        const std::uint16_t peak = static_cast<std::uint16_t>(flipped) ^ 0x8000u;
+        const std::size_t peakIndex = std::find(trace + begin, trace + end, peak) - trace;
+        return { sum, static_cast<std::uint32_t>(above), peak, static_cast<std::uint32_t>(peakIndex) };
+    }
+
+    void FeatureExtractor::Extract(const std::uint16_t* adc, std::size_t channels, std::size_t samples,
+        const FeatureSettings& settings, ChannelFeatures& features)
+    {
+        features.Resize(channels);
+        if (samples == 0) return;
+
+        const std::size_t baselineSamples = std::min<std::size_t>(std::max(settings.baselineSamples, 1), samples);
+        const G4double period = settings.samplingPeriod;
+
+        for (std::size_t channel = 0; channel < channels; channel++) {
+            const std::uint16_t* trace = adc + channel * samples;
+
+            std::uint32_t baselineSum = 0;
+            for (std::size_t s = 0; s < baselineSamples; s++) baselineSum += trace[s];
+            const G4double baseline = static_cast<G4double>(baselineSum) / baselineSamples;
+
+            // Integer samples: value - baseline > threshold <=> value > floor(baseline + threshold)
+            const G4double level = std::max(0., std::floor(baseline + settings.threshold));
+            const std::uint32_t threshold = static_cast<std::uint32_t>(std::min(level, 65535.));
+            const Sums sums = Accumulate(trace, baselineSamples, samples, threshold);
+            const G4double peak = sums.peak - baseline;
+
+            // Walk down the leading edge to the last sample below the constant-fraction level
+            G4double time = -1.;
+            if (peak > settings.threshold && sums.peakIndex < samples) {
+                const G4double fraction = settings.cfdFraction * peak;
+                for (std::size_t s = sums.peakIndex; s > baselineSamples; s--) {
+                    const G4double v0 = trace[s - 1] - baseline;
+                    if (v0 >= fraction) continue;
+                    const G4double v1 = trace[s] - baseline;
+                    time = settings.windowStart + (s - 1 + (fraction - v0) / (v1 - v0)) * period;
+                    break;
+                }
+            }
+
+            features.baseline[channel] = static_cast<float>(baseline);
+            features.time[channel] = static_cast<float>(time);
+            features.charge[channel] = static_cast<float>((sums.sum - baseline * (samples - baselineSamples)) * period);
+            features.peak[channel] = static_cast<float>(peak);
+            features.timeOverThreshold[channel] = static_cast<float>(sums.above * period);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+
+#ifndef G4_BREMS_WAVEFORM_FEATURES_H
+#define G4_BREMS_WAVEFORM_FEATURES_H 1
+
+#include "globals.hh"
+#include <cstdint>
+#include <vector>
+
+namespace G4_BREMS {
+
+    struct FeatureSettings {
+        G4int baselineSamples = 16;      // leading samples averaged for the baseline
+        G4double cfdFraction = 0.3;      // of the peak amplitude
+        G4double threshold = 10.;        // ADC counts above baseline, time-over-threshold and hit flag
+        G4double samplingPeriod = 2.;    // ns
+        G4double windowStart = 0.;       // ns, time of sample 0
+    };
+
+    // Features of a set of channels, one array per feature. Amplitudes are in ADC counts above
+    // the baseline, charge in ADC counts x ns, times in ns. Time is -1 below threshold or when the
+    // trace is already above the constant-fraction level after the baseline samples.
+    struct ChannelFeatures {
+        std::vector<float> baseline;
+        std::vector<float> time;         // last constant-fraction crossing before the peak
+        std::vector<float> charge;       // sum over the samples after the baseline ones
+        std::vector<float> peak;
+        std::vector<float> timeOverThreshold;
+
+        void Resize(std::size_t channels);
+        std::size_t size() const { return baseline.size(); }
+    };
+
+    // Waveform features of channel-major traces (adc[channel * samples + sample], as written by
+    // SipmDigitizer) into one array per feature. The pass over the samples of a channel works on
+    // the raw ADC values with integer sums, a count and a maximum, which compilers vectorize
+    // along the samples; only the peak lookup and the constant-fraction walk down the leading
+    // edge, a few samples long, are scalar.
+    class FeatureExtractor
+    {
+    public:
+        void Extract(const std::uint16_t* adc, std::size_t channels, std::size_t samples,
+            const FeatureSettings& settings, ChannelFeatures& features);
+
+    private:
+        struct Sums {
+            std::uint32_t sum;
+            std::uint32_t above;        // samples above the threshold
+            std::uint32_t peak;         // ADC counts
+            std::uint32_t peakIndex;    // first sample at the peak
+        };
+
+        static Sums Accumulate(const std::uint16_t* trace, std::size_t begin, std::size_t end,
+            std::uint32_t threshold);
+    };
+}
+
+#endif